@@ -7,12 +7,31 @@
 
 import UIKit
 
-class DummyViewController: UIViewController {
+class DummyViewController: AmountDetectionViewController {
 
     @IBOutlet var mVuforiaView: VuforiaView!
 
     override func viewDidAppear(_ animated: Bool) {
         super.viewDidAppear(animated)
         startVuforia(self)
+        observeRecognition(self)
+    }
+
+    override func viewWillDisappear(_ animated: Bool) {
+        super.viewWillDisappear(animated)
+        observeRecognition(nil)
+        hideAmountView()
+    }
+
+    func showRecognizedNote(_ name: String?) {
+        hideAmountView()
+        guard let name = name else { return }
+        // Names split into currency and amount like the ARKit reference images, others are shown whole
+        let slices = name.split(separator: "_")
+        if slices.count == 2 {
+            showAmountView(currency: "\(slices[0])", amount: "\(slices[1])")
+        } else {
+            showAmountView(currency: "", amount: name)
+        }
     }
 }
@@ -12,6 +12,7 @@ countries.
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <functional>
 #include <string>
 
@@ -30,6 +31,12 @@ constexpr char licenseKey[] = "";
 
 constexpr float NEAR_PLANE = 0.01f;
 constexpr float FAR_PLANE = 5.f;
+
+/// Image target database with a target for every banknote side
+constexpr char imageTargetDatabase[] = "banknotesReader.xml";
+
+/// Image target observers active at a time, the rest take turns
+constexpr size_t MAX_ACTIVE_TARGETS = 8;
 }
 
 
@@ -67,6 +74,14 @@ AppController::initAR(const InitConfig& initConfig, int target)
         return;
     }
 
+    // Frames are captured on the camera thread as states arrive, see handleVuforiaState
+    if (vuEngineRegisterStateHandler(mEngine, &onVuforiaState, this) != VU_SUCCESS)
+    {
+        LOG("Error registering state handler");
+        mErrorMessageCallback("Error registering state handler");
+        return;
+    }
+
     mInitDoneCallback();
 }
 
@@ -83,6 +98,8 @@ AppController::startAR()
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(mEngineMutex);
+
     // Bail out early if engine has already been started
     if (vuEngineIsRunning(mEngine))
     {
@@ -132,21 +149,30 @@ AppController::stopAR()
         return false;
     }
 
-    // Bail out early if engine has not been started yet
-    if (!vuEngineIsRunning(mEngine))
     {
-        LOG("Failed to stop Vuforia as it is currently not running");
-        return false;
-    }
+        // The state handler skips its states while this is held, so the stop cannot wait on it
+        std::lock_guard<std::mutex> lock(mEngineMutex);
 
-    mARStarted = false;
+        // Bail out early if engine has not been started yet
+        if (!vuEngineIsRunning(mEngine))
+        {
+            LOG("Failed to stop Vuforia as it is currently not running");
+            return false;
+        }
 
-    // Stop engine
-    if (vuEngineStop(mEngine) != VU_SUCCESS)
-    {
-        LOG("Failed to stop Vuforia");
-        return false;
+        mARStarted = false;
+
+        // Stop engine
+        if (vuEngineStop(mEngine) != VU_SUCCESS)
+        {
+            LOG("Failed to stop Vuforia");
+            return false;
+        }
+
+        // No state handler calls follow a stop, and a resumed session must not show old frames
+        releaseTrackedFrames();
     }
+    publishRecognition(-1, 0.f, mPublishedRecognition.timestamp);
 
     LOG("Successfully stopped Vuforia");
     return true;
@@ -165,8 +191,22 @@ AppController::deinitAR()
 
     stopAR();
 
+    std::lock_guard<std::mutex> lock(mEngineMutex);
+
+    if (vuEngineRegisterStateHandler(mEngine, nullptr, nullptr) != VU_SUCCESS)
+    {
+        LOG("Error unregistering state handler");
+    }
+    releaseTrackedFrames();
+
     destroyObservers();
 
+    if (mObservationList != nullptr && vuObservationListDestroy(mObservationList) != VU_SUCCESS)
+    {
+        LOG("Error destroying observation list");
+    }
+    mObservationList = nullptr;
+
     // Destroy engine instance
     if (vuEngineDestroy(mEngine) != VU_SUCCESS)
     {
@@ -186,6 +226,8 @@ AppController::deinitAR()
 void
 AppController::cameraPerformAutoFocus()
 {
+    std::lock_guard<std::mutex> lock(mEngineMutex);
+
     if (!mARStarted)
     {
         return;
@@ -208,6 +250,8 @@ AppController::cameraPerformAutoFocus()
 void
 AppController::cameraRestoreAutoFocus()
 {
+    std::lock_guard<std::mutex> lock(mEngineMutex);
+
     if (!mARStarted)
     {
         return;
@@ -230,6 +274,8 @@ AppController::cameraRestoreAutoFocus()
 bool
 AppController::configureRendering(int width, int height, void* orientation)
 {
+    std::lock_guard<std::mutex> lock(mEngineMutex);
+
     if (!mARStarted)
     {
         return false;
@@ -273,6 +319,8 @@ AppController::configureRendering(int width, int height, void* orientation)
 bool
 AppController::getVideoBackgroundTextureSize(VuVector2I& textureSize)
 {
+    std::lock_guard<std::mutex> lock(mEngineMutex);
+
     VuVideoBackgroundViewInfo vbViewInfo;
     if (vuRenderControllerGetVideoBackgroundViewInfo(mRenderController, &vbViewInfo) != VU_SUCCESS)
     {
@@ -288,43 +336,30 @@ AppController::getVideoBackgroundTextureSize(VuVector2I& textureSize)
 bool
 AppController::prepareToRender(double* viewport, VuRenderVideoBackgroundData* renderData)
 {
-    if (vuEngineAcquireLatestState(mEngine, &mVuforiaState) != VU_SUCCESS)
-    {
-        LOG("Error getting state");
-        return false;
-    }
-
-    if (vuStateHasCameraFrame(mVuforiaState) != VU_TRUE)
+    // Keeps the current frame if the camera thread has not published a newer one
+    mTrackedFrames.update();
+    TrackedFrame& frame = mTrackedFrames.getFront();
+    frame.snapshot.isValid = false;
+    if (frame.state == nullptr)
     {
         return false;
     }
 
-    if (vuStateGetRenderState(mVuforiaState, &mCurrentRenderState) != VU_SUCCESS)
-    {
-        LOG("Error getting render state");
-        return false;
-    }
-
-    if (!mCurrentRenderState.vbMesh)
-    {
-        return false;
-    }
-
-    viewport[0] = mCurrentRenderState.viewport.data[0];
-    viewport[1] = mCurrentRenderState.viewport.data[1];
-    viewport[2] = mCurrentRenderState.viewport.data[2];
-    viewport[3] = mCurrentRenderState.viewport.data[3];
+    viewport[0] = frame.renderState.viewport.data[0];
+    viewport[1] = frame.renderState.viewport.data[1];
+    viewport[2] = frame.renderState.viewport.data[2];
+    viewport[3] = frame.renderState.viewport.data[3];
     viewport[4] = 0.0f;
     viewport[5] = 1.0f;
 
-    if (vuRenderControllerUpdateVideoBackgroundTexture(mRenderController, mVuforiaState, renderData) != VU_SUCCESS)
+    std::lock_guard<std::mutex> lock(mEngineMutex);
+    if (vuRenderControllerUpdateVideoBackgroundTexture(mRenderController, frame.state, renderData) != VU_SUCCESS)
     {
         LOG("Error updating video background texture");
         return false;
     }
 
-    updateDevicePose();
-
+    frame.snapshot.isValid = true;
     return true;
 }
 
@@ -332,49 +367,18 @@ AppController::prepareToRender(double* viewport, VuRenderVideoBackgroundData* re
 void
 AppController::finishRender()
 {
-    // Check for device tracker relocalizing for too long and reset if needed
-    if (mLatestDevicePoseData.poseStatus == VU_OBSERVATION_POSE_STATUS_LIMITED &&
-        mLatestDevicePoseData.poseStatusInfo == VU_DEVICE_POSE_OBSERVATION_STATUS_INFO_RELOCALIZING)
-    {
-        using namespace std::chrono;
-
-        // Start timing if we have just entered relocalizing state
-        if (!mTimingRelocalizingState)
-        {
-            mEnteredRelocalizingState = steady_clock::now();
-        }
-        mTimingRelocalizingState = true;
-
-        // Check whether we have been relocalizing for longer than the threshold
-        auto relocalizingFor = duration_cast<seconds>(steady_clock::now() - mEnteredRelocalizingState);
-        if (relocalizingFor.count() > MAX_RELOCALIZING_SECONDS)
-        {
-            mTimingRelocalizingState = false;
-            VuResult resetResult = vuEngineResetWorldTracking(mEngine);
-            LOG("%s reset world tracking", resetResult == VU_SUCCESS ? "Successfully" : "Failed to");
-        }
-    }
-    else
-    {
-        mTimingRelocalizingState = false;
-    }
-
-    // Clean up and release the Vuforia state
-    if (mVuforiaState != nullptr && vuStateRelease(mVuforiaState) != VU_SUCCESS)
-    {
-        LOG("Error releasing the Vuforia state");
-    }
-    mVuforiaState = nullptr;
+    // Nothing to release, the camera thread releases the state of a frame once newer ones replace it
 }
 
 
 bool
 AppController::getOrigin(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMatrix)
 {
-    if (mLatestDevicePoseData.poseStatus != VU_OBSERVATION_POSE_STATUS_NO_POSE)
+    const FrameSnapshot& snapshot = getFrameSnapshot();
+    if (snapshot.devicePoseStatus != VU_OBSERVATION_POSE_STATUS_NO_POSE)
     {
-        projectionMatrix = mCurrentRenderState.projectionMatrix;
-        modelViewMatrix = mCurrentRenderState.viewMatrix;
+        projectionMatrix = snapshot.projectionMatrix;
+        modelViewMatrix = snapshot.viewMatrix;
         return true;
     }
 
@@ -382,174 +386,98 @@ AppController::getOrigin(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMa
 }
 
 
-bool
-AppController::getImageTargetResult(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMatrix, VuMatrix44F& scaledModelViewMatrix)
+const char*
+AppController::getTargetName(int targetIndex) const
 {
-    bool result = false;
-
-    if (mTarget != IMAGE_TARGET_ID)
+    if (targetIndex < 0 || targetIndex >= static_cast<int>(mTargetNames.size()))
     {
-        return false;
+        return nullptr;
     }
 
-    VuObservationList* observationList = nullptr;
-    REQUIRE_SUCCESS(vuObservationListCreate(&observationList));
+    return mTargetNames[targetIndex].c_str();
+}
+
 
-    if (vuStateGetImageTargetObservations(mVuforiaState, observationList) != VU_SUCCESS)
+void
+AppController::selectCurrency(const char* currency)
+{
+    if (!mObserverScheduler)
     {
-        LOG("Error getting image target observations");
-        REQUIRE_SUCCESS(vuObservationListDestroy(observationList));
-        return false;
+        return;
     }
 
-    int numObservations = 0;
-    REQUIRE_SUCCESS(vuObservationListGetSize(observationList, &numObservations));
-
-    if (numObservations > 0)
+    std::vector<bool> preferred(mTargets.size(), false);
+    if (currency != nullptr && currency[0] != '\0')
     {
-        VuObservation* observation = nullptr;
-        if (vuObservationListGetElement(observationList, 0, &observation) == VU_SUCCESS)
+        for (size_t i = 0; i < mTargetNames.size(); ++i)
         {
-            assert(observation);
-            assert(vuObservationIsType(observation, VU_OBSERVATION_IMAGE_TARGET_TYPE) == VU_TRUE);
-            assert(vuObservationHasPoseInfo(observation) == VU_TRUE);
-
-            VuPoseInfo poseInfo;
-            REQUIRE_SUCCESS(vuObservationGetPoseInfo(observation, &poseInfo));
-
-            VuImageTargetObservationTargetInfo imageTargetInfo;
-            REQUIRE_SUCCESS(vuImageTargetObservationGetTargetInfo(observation, &imageTargetInfo));
-
-            if (poseInfo.poseStatus != VU_OBSERVATION_POSE_STATUS_NO_POSE)
-            {
-                projectionMatrix = mCurrentRenderState.projectionMatrix;
-
-                // Compute model-view matrix
-                auto modelMatrix = poseInfo.pose;
-                modelViewMatrix = vuMatrix44FMultiplyMatrix(mCurrentRenderState.viewMatrix, modelMatrix);
-
-                // Calculate a scaled modelViewMatrix for rendering a unit bounding box
-                // z-dimension will be zero for planar target
-                // set it here to the larger dimension so that
-                // a 3D augmentation can be shown
-                VuVector3F scale;
-                scale.data[0] = imageTargetInfo.size.data[0];
-                scale.data[1] = imageTargetInfo.size.data[1];
-                scale.data[2] = std::max(scale.data[0], scale.data[1]);
-                scaledModelViewMatrix = vuMatrix44FScale(scale, modelViewMatrix);
-
-                result = true;
-            }
+            preferred[i] = mTargetNames[i].find(currency) != std::string::npos;
         }
     }
+    {
+        std::lock_guard<std::mutex> lock(mPreferredMutex);
+        mPendingPreferred.swap(preferred);
+    }
+    mPreferredChanged.store(true, std::memory_order_release);
+}
 
-    REQUIRE_SUCCESS(vuObservationListDestroy(observationList));
 
-    return result;
+void
+AppController::setRecognitionCallback(RecognitionCallback callback, void* userData)
+{
+    std::lock_guard<std::mutex> lock(mRecognitionCallbackMutex);
+    mRecognitionCallback = callback;
+    mRecognitionUserData = userData;
 }
 
 
 bool
-AppController::getModelTargetResult(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMatrix, VuMatrix44F& scaledModelViewMatrix)
+AppController::getImageTargetResult(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMatrix, VuMatrix44F& scaledModelViewMatrix)
 {
-    bool result = false;
-
-    if (mTarget != MODEL_TARGET_ID)
+    if (mTarget != IMAGE_TARGET_ID)
     {
         return false;
     }
 
-    VuObservationList* observationList = nullptr;
-    REQUIRE_SUCCESS(vuObservationListCreate(&observationList));
+    const FrameSnapshot& snapshot = getFrameSnapshot();
+    for (int i = 0; i < snapshot.numTargets; ++i)
+    {
+        const TargetSnapshot& target = snapshot.targets[i];
+        if (target.targetType == IMAGE_TARGET_ID && target.poseStatus != VU_OBSERVATION_POSE_STATUS_NO_POSE)
+        {
+            projectionMatrix = snapshot.projectionMatrix;
+            modelViewMatrix = target.modelViewMatrix;
+            scaledModelViewMatrix = target.scaledModelViewMatrix;
+            return true;
+        }
+    }
 
-    if (vuStateGetModelTargetObservations(mVuforiaState, observationList) != VU_SUCCESS)
+    return false;
+}
+
+
+bool
+AppController::getModelTargetResult(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMatrix, VuMatrix44F& scaledModelViewMatrix)
+{
+    if (mTarget != MODEL_TARGET_ID)
     {
-        LOG("Error getting model target observations");
-        REQUIRE_SUCCESS(vuObservationListDestroy(observationList));
         return false;
     }
 
-    int numObservations = 0;
-    REQUIRE_SUCCESS(vuObservationListGetSize(observationList, &numObservations));
-
-    if (numObservations > 0)
+    const FrameSnapshot& snapshot = getFrameSnapshot();
+    for (int i = 0; i < snapshot.numTargets; ++i)
     {
-        VuObservation* observation = nullptr;
-        if (vuObservationListGetElement(observationList, 0, &observation) == VU_SUCCESS)
+        const TargetSnapshot& target = snapshot.targets[i];
+        if (target.targetType == MODEL_TARGET_ID && target.poseStatus != VU_OBSERVATION_POSE_STATUS_NO_POSE)
         {
-            assert(observation);
-            assert(vuObservationIsType(observation, VU_OBSERVATION_MODEL_TARGET_TYPE) == VU_TRUE);
-            assert(vuObservationHasPoseInfo(observation) == VU_TRUE);
-
-            VuPoseInfo poseInfo;
-            REQUIRE_SUCCESS(vuObservationGetPoseInfo(observation, &poseInfo));
-
-            VuModelTargetObservationTargetInfo modelTargetInfo;
-            REQUIRE_SUCCESS(vuModelTargetObservationGetTargetInfo(observation, &modelTargetInfo));
-            if (poseInfo.poseStatus == VU_OBSERVATION_POSE_STATUS_NO_POSE)
-            {
-                VuGuideViewList* guideViewList;
-                REQUIRE_SUCCESS(vuGuideViewListCreate(&guideViewList));
-
-                if (vuModelTargetObserverGetGuideViews(mObjectObserver, guideViewList) != VU_SUCCESS)
-                {
-                    LOG("Error getting list of guide views");
-                }
-                else
-                {
-                    int32_t size;
-                    REQUIRE_SUCCESS(vuGuideViewListGetSize(guideViewList, &size));
-                    mGuideViewModelTarget = [&]() -> VuGuideView* {
-                        for (int i = 0; i < size; ++i)
-                        {
-                            VuGuideView* guideView = nullptr;
-                            REQUIRE_SUCCESS(vuGuideViewListGetElement(guideViewList, i, &guideView));
-                            const char* guideViewName = nullptr;
-                            REQUIRE_SUCCESS(vuGuideViewGetName(guideView, &guideViewName));
-
-                            // Note: We use the activeGuideViewName as we know there is a guide view for our dataset.
-                            //       When using Advanced Model Targets there may not be a guide view and
-                            //       activeGuideViewName will be NULL.
-                            if (strcmp(guideViewName, modelTargetInfo.activeGuideViewName) == 0)
-                            {
-                                return guideView;
-                            }
-                        }
-                        return nullptr;
-                    }();
-                    if (!mGuideViewModelTarget)
-                    {
-                        LOG("Error getting guide view details");
-                    }
-                }
-
-                REQUIRE_SUCCESS(vuGuideViewListDestroy(guideViewList));
-            }
-            else
-            {
-                mGuideViewModelTarget = nullptr;
-
-                projectionMatrix = mCurrentRenderState.projectionMatrix;
-
-                // Compute model-view matrix
-                auto modelMatrix = poseInfo.pose;
-                modelViewMatrix = vuMatrix44FMultiplyMatrix(mCurrentRenderState.viewMatrix, modelMatrix);
-
-                // Calculate a scaled modelViewMatrix for rendering a unit bounding box
-                VuMatrix44F scaleMatrix = vuMatrix44FScalingMatrix(modelTargetInfo.size);
-                VuMatrix44F translateMatrix = vuMatrix44FTranslationMatrix(modelTargetInfo.bbox.center);
-
-                scaledModelViewMatrix = vuMatrix44FMultiplyMatrix(translateMatrix, scaleMatrix);
-                scaledModelViewMatrix = vuMatrix44FMultiplyMatrix(modelViewMatrix, scaledModelViewMatrix);
-
-                result = true;
-            }
+            projectionMatrix = snapshot.projectionMatrix;
+            modelViewMatrix = target.modelViewMatrix;
+            scaledModelViewMatrix = target.scaledModelViewMatrix;
+            return true;
         }
     }
 
-    REQUIRE_SUCCESS(vuObservationListDestroy(observationList));
-
-    return result;
+    return false;
 }
 
 
@@ -557,25 +485,28 @@ bool
 AppController::getModelTargetGuideView(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMatrix, VuImageInfo& guideViewImageInfo,
                                        VuBool& guideViewImageHasChanged)
 {
-    if (mGuideViewModelTarget == nullptr)
+    const TrackedFrame& frame = mTrackedFrames.getFront();
+    if (frame.state == nullptr || frame.guideView == nullptr)
     {
         return false;
     }
 
     VuCameraIntrinsics cameraIntrinsics;
-    if (vuStateGetCameraIntrinsics(mVuforiaState, &cameraIntrinsics) != VU_SUCCESS)
+    if (vuStateGetCameraIntrinsics(frame.state, &cameraIntrinsics) != VU_SUCCESS)
     {
         return false;
     }
     auto fov = vuCameraIntrinsicsGetFov(&cameraIntrinsics);
 
-    if (vuGuideViewIsImageOutdated(mGuideViewModelTarget, &guideViewImageHasChanged) != VU_SUCCESS)
+    // Getting an outdated image renders a new one and destroys the old
+    std::unique_lock<std::mutex> lock(mEngineMutex);
+    if (vuGuideViewIsImageOutdated(frame.guideView, &guideViewImageHasChanged) != VU_SUCCESS)
     {
         return false;
     }
 
     VuImage* guideViewImage = nullptr;
-    if (vuGuideViewGetImage(mGuideViewModelTarget, &guideViewImage) != VU_SUCCESS)
+    if (vuGuideViewGetImage(frame.guideView, &guideViewImage) != VU_SUCCESS)
     {
         return false;
     }
@@ -585,6 +516,7 @@ AppController::getModelTargetGuideView(VuMatrix44F& projectionMatrix, VuMatrix44
         LOG("Error getting image info for guide view");
         return false;
     }
+    lock.unlock();
 
     float guideViewAspectRatio = (float)guideViewImageInfo.width / guideViewImageInfo.height;
 
@@ -923,18 +855,67 @@ AppController::createObservers()
         return false;
     }
 
-    auto imageTargetConfig = vuImageTargetConfigDefault();
-    imageTargetConfig.databasePath = "banknotesReader.xml";
-    imageTargetConfig.targetName = "hundred-dollars-note-b";
-    imageTargetConfig.activate = VU_TRUE;
+    // One observer per image target of the database, so every note in view is tracked at once
+    VuDatabaseTargetInfoList* targetInfoList = nullptr;
+    REQUIRE_SUCCESS(vuDatabaseTargetInfoListCreate(&targetInfoList));
+
+    VuDatabaseTargetInfoError targetInfoError;
+    if (vuEngineGetDatabaseTargetInfo(mEngine, imageTargetDatabase, targetInfoList, &targetInfoError) != VU_SUCCESS)
+    {
+        LOG("Error getting targets of database %s: 0x%02x", imageTargetDatabase, targetInfoError);
+        REQUIRE_SUCCESS(vuDatabaseTargetInfoListDestroy(targetInfoList));
+        mErrorMessageCallback("Error reading image target database");
+        return false;
+    }
+
+    int32_t numTargetInfos = 0;
+    REQUIRE_SUCCESS(vuDatabaseTargetInfoListGetSize(targetInfoList, &numTargetInfos));
+    mTargets.reserve(numTargetInfos);
+    mTargetByObserverId.reserve(numTargetInfos);
+    mTargetNames.reserve(numTargetInfos);
 
-    VuImageTargetCreationError imageTargetCreationError;
-    if (vuEngineCreateImageTargetObserver(mEngine, &mObjectObserver, &imageTargetConfig, &imageTargetCreationError) != VU_SUCCESS)
+    for (int32_t i = 0; i < numTargetInfos; ++i)
     {
-        LOG("Error creating image target observer: 0x%02x", imageTargetCreationError);
+        VuDatabaseTargetInfo targetInfo;
+        REQUIRE_SUCCESS(vuDatabaseTargetInfoListGetElement(targetInfoList, i, &targetInfo));
+        if (targetInfo.observerType != VU_OBSERVER_IMAGE_TARGET_TYPE)
+        {
+            continue;
+        }
+
+        auto imageTargetConfig = vuImageTargetConfigDefault();
+        imageTargetConfig.databasePath = imageTargetDatabase;
+        imageTargetConfig.targetName = targetInfo.name;
+        // Activated by the observer scheduler below
+        imageTargetConfig.activate = VU_FALSE;
+
+        VuObserver* observer = nullptr;
+        VuImageTargetCreationError imageTargetCreationError;
+        if (vuEngineCreateImageTargetObserver(mEngine, &observer, &imageTargetConfig, &imageTargetCreationError) != VU_SUCCESS)
+        {
+            LOG("Error creating image target observer for %s: 0x%02x", targetInfo.name, imageTargetCreationError);
+            continue;
+        }
+
+        mTargetByObserverId.emplace(vuObserverGetId(observer), static_cast<uint32_t>(mTargets.size()));
+        mTargets.push_back({ observer, VU_OBSERVATION_POSE_STATUS_NO_POSE });
+        mTargetNames.emplace_back(targetInfo.name);
+    }
+
+    REQUIRE_SUCCESS(vuDatabaseTargetInfoListDestroy(targetInfoList));
+
+    if (mTargets.empty())
+    {
+        LOG("Error creating image target observers, none of the %d targets of %s could be used", numTargetInfos, imageTargetDatabase);
         mErrorMessageCallback("Error creating image target observer");
         return false;
     }
+
+    ObserverSchedulerOptions schedulerOptions;
+    schedulerOptions.maxActive = MAX_ACTIVE_TARGETS;
+    mObserverScheduler = std::make_unique<ObserverScheduler>(mTargets.size(), schedulerOptions);
+    mDetectedTargets.reserve(mTargets.size());
+    scheduleObservers();
     
 //    if (mTarget == IMAGE_TARGET_ID)
 //    {
@@ -975,6 +956,18 @@ AppController::createObservers()
 void
 AppController::destroyObservers()
 {
+    for (TargetState& target : mTargets)
+    {
+        if (vuObserverDestroy(target.observer) != VU_SUCCESS)
+        {
+            LOG("Error destroying image target observer");
+        }
+    }
+    mTargets.clear();
+    mTargetByObserverId.clear();
+    mTargetNames.clear();
+    mObserverScheduler.reset();
+
     if (mObjectObserver != nullptr && vuObserverDestroy(mObjectObserver) != VU_SUCCESS)
     {
         LOG("Error destroying object observer");
@@ -990,48 +983,382 @@ AppController::destroyObservers()
 
 
 void
-AppController::updateDevicePose()
+AppController::onVuforiaState(const VuState* state, void* clientData)
 {
-    mLatestDevicePoseData.pose = vuIdentityMatrix44F();
-    mLatestDevicePoseData.poseStatus = VU_OBSERVATION_POSE_STATUS_NO_POSE;
-    mLatestDevicePoseData.poseStatusInfo = VU_DEVICE_POSE_OBSERVATION_STATUS_INFO_NORMAL;
+    AppController* appController = static_cast<AppController*>(clientData);
+    assert(appController);
+
+    // Delegate the state to the AppController instance for capturing
+    appController->handleVuforiaState(state);
+}
 
-    VuObservationList* observationList = nullptr;
-    REQUIRE_SUCCESS(vuObservationListCreate(&observationList));
 
-    if (vuStateGetDevicePoseObservations(mVuforiaState, observationList) == VU_SUCCESS)
+void
+AppController::handleVuforiaState(const VuState* state)
+{
+    if (vuStateHasCameraFrame(state) != VU_TRUE)
     {
-        int numObservations = 0;
-        REQUIRE_SUCCESS(vuObservationListGetSize(observationList, &numObservations));
+        return;
+    }
+
+    // Fails until configureRendering has set the render view
+    VuRenderState renderState;
+    if (vuStateGetRenderState(state, &renderState) != VU_SUCCESS || !renderState.vbMesh)
+    {
+        return;
+    }
+
+    // The back slot holds a frame the rendering thread has finished with or never took
+    TrackedFrame& frame = mTrackedFrames.getBack();
+    if (frame.state != nullptr && vuStateRelease(frame.state) != VU_SUCCESS)
+    {
+        LOG("Error releasing the Vuforia state");
+    }
+    frame.state = nullptr;
+
+    // The state passed to the handler is only valid during the call
+    if (vuStateAcquireReference(state, &frame.state) != VU_SUCCESS)
+    {
+        LOG("Error acquiring a reference to the Vuforia state");
+        frame.state = nullptr;
+        return;
+    }
+    frame.renderState = renderState;
+
+    captureFrame(state, frame);
+    checkRelocalizing(frame.snapshot);
+
+    int64_t timestamp = mPublishedRecognition.timestamp;
+    VuCameraFrame* cameraFrame = nullptr;
+    if (vuStateGetCameraFrame(state, &cameraFrame) == VU_SUCCESS)
+    {
+        REQUIRE_SUCCESS(vuCameraFrameGetTimestamp(cameraFrame, &timestamp));
+    }
+
+    mTrackedFrames.publish();
+    updateRecognition(timestamp);
+}
+
+
+void
+AppController::releaseTrackedFrames()
+{
+    mTrackedFrames.forEach([](TrackedFrame& frame) {
+        if (frame.state != nullptr && vuStateRelease(frame.state) != VU_SUCCESS)
+        {
+            LOG("Error releasing the Vuforia state");
+        }
+        frame = TrackedFrame{};
+    });
+
+    // Take whatever was published last, now empty, so nothing stale is rendered
+    mTrackedFrames.update();
+}
+
+
+void
+AppController::captureFrame(const VuState* state, TrackedFrame& frame)
+{
+    FrameSnapshot& snapshot = frame.snapshot;
+    snapshot.projectionMatrix = frame.renderState.projectionMatrix;
+    snapshot.viewMatrix = frame.renderState.viewMatrix;
+    snapshot.vbProjectionMatrix = frame.renderState.vbProjectionMatrix;
+    snapshot.devicePose = vuIdentityMatrix44F();
+    snapshot.devicePoseStatus = VU_OBSERVATION_POSE_STATUS_NO_POSE;
+    snapshot.devicePoseStatusInfo = VU_DEVICE_POSE_OBSERVATION_STATUS_INFO_NORMAL;
+    snapshot.numTargets = 0;
+    // Only prepareToRender on the rendering thread makes the frame valid
+    snapshot.isValid = false;
+
+    // Only the targets detected in the previous frame have a pose status to reset
+    for (uint32_t detected : mDetectedTargets)
+    {
+        mTargets[detected].poseStatus = VU_OBSERVATION_POSE_STATUS_NO_POSE;
+    }
+    mDetectedTargets.clear();
+
+    if (mObservationList == nullptr)
+    {
+        REQUIRE_SUCCESS(vuObservationListCreate(&mObservationList));
+    }
+
+    // One query for the observations of every observer, instead of one list and query per observer
+    if (vuStateGetObservations(state, mObservationList) != VU_SUCCESS)
+    {
+        LOG("Error getting observations");
+        frame.guideView = mGuideViewModelTarget;
+        return;
+    }
+
+    int numObservations = 0;
+    REQUIRE_SUCCESS(vuObservationListGetSize(mObservationList, &numObservations));
 
-        if (numObservations > 0)
+    for (int i = 0; i < numObservations; ++i)
+    {
+        VuObservation* observation = nullptr;
+        if (vuObservationListGetElement(mObservationList, i, &observation) != VU_SUCCESS)
         {
-            VuObservation* observation = nullptr;
-            if (vuObservationListGetElement(observationList, 0, &observation) == VU_SUCCESS)
+            continue;
+        }
+        assert(observation);
+
+        if (vuObservationHasPoseInfo(observation) != VU_TRUE)
+        {
+            continue;
+        }
+
+        VuPoseInfo poseInfo;
+        REQUIRE_SUCCESS(vuObservationGetPoseInfo(observation, &poseInfo));
+
+        if (vuObservationIsType(observation, VU_OBSERVATION_DEVICE_POSE_TYPE) == VU_TRUE)
+        {
+            if (poseInfo.poseStatus != VU_OBSERVATION_POSE_STATUS_NO_POSE)
             {
-                assert(observation);
-                assert(vuObservationIsType(observation, VU_OBSERVATION_DEVICE_POSE_TYPE) == VU_TRUE);
-                assert(vuObservationHasPoseInfo(observation) == VU_TRUE);
+                // Store latest tracked device pose and pose status
+                snapshot.devicePose = poseInfo.pose;
+                snapshot.devicePoseStatus = poseInfo.poseStatus;
 
-                VuPoseInfo poseInfo;
-                REQUIRE_SUCCESS(vuObservationGetPoseInfo(observation, &poseInfo));
+                // Retrieve device pose-specific status information
+                REQUIRE_SUCCESS(vuDevicePoseObservationGetStatusInfo(observation, &snapshot.devicePoseStatusInfo));
+            }
+            continue;
+        }
 
-                if (poseInfo.poseStatus != VU_OBSERVATION_POSE_STATUS_NO_POSE)
-                {
-                    // Store latest tracked device pose and pose status
-                    mLatestDevicePoseData.pose = poseInfo.pose;
-                    mLatestDevicePoseData.poseStatus = poseInfo.poseStatus;
+        const bool isImageTarget = vuObservationIsType(observation, VU_OBSERVATION_IMAGE_TARGET_TYPE) == VU_TRUE;
+        const bool isModelTarget = vuObservationIsType(observation, VU_OBSERVATION_MODEL_TARGET_TYPE) == VU_TRUE;
+        if (!isImageTarget && !isModelTarget)
+        {
+            continue;
+        }
 
-                    // Retrieve device pose-specific status information
-                    REQUIRE_SUCCESS(vuDevicePoseObservationGetStatusInfo(observation, &mLatestDevicePoseData.poseStatusInfo));
-                }
+        int targetIndex = -1;
+        if (isImageTarget)
+        {
+            const auto found = mTargetByObserverId.find(vuObservationGetObserverId(observation));
+
+            // Untracked notes stay out of the snapshot so they cannot crowd out tracked ones
+            if (found == mTargetByObserverId.end() || poseInfo.poseStatus == VU_OBSERVATION_POSE_STATUS_NO_POSE)
+            {
+                continue;
+            }
+            targetIndex = static_cast<int>(found->second);
+            mTargets[found->second].poseStatus = poseInfo.poseStatus;
+            mDetectedTargets.push_back(found->second);
+        }
+
+        if (snapshot.numTargets == MAX_SNAPSHOT_TARGETS)
+        {
+            continue;
+        }
+
+        TargetSnapshot& target = snapshot.targets[snapshot.numTargets++];
+        target.targetType = isImageTarget ? IMAGE_TARGET_ID : MODEL_TARGET_ID;
+        target.targetIndex = targetIndex;
+        target.name = isImageTarget ? mTargetNames[targetIndex].c_str() : "";
+        target.poseStatus = poseInfo.poseStatus;
+        target.modelViewMatrix = vuIdentityMatrix44F();
+        target.scaledModelViewMatrix = vuIdentityMatrix44F();
+
+        if (isImageTarget)
+        {
+            VuImageTargetObservationTargetInfo imageTargetInfo;
+            REQUIRE_SUCCESS(vuImageTargetObservationGetTargetInfo(observation, &imageTargetInfo));
+
+            // Compute model-view matrix
+            target.modelViewMatrix = vuMatrix44FMultiplyMatrix(frame.renderState.viewMatrix, poseInfo.pose);
+
+            // Calculate a scaled modelViewMatrix for rendering a unit bounding box
+            // z-dimension will be zero for planar target
+            // set it here to the larger dimension so that
+            // a 3D augmentation can be shown
+            VuVector3F scale;
+            scale.data[0] = imageTargetInfo.size.data[0];
+            scale.data[1] = imageTargetInfo.size.data[1];
+            scale.data[2] = std::max(scale.data[0], scale.data[1]);
+            target.scaledModelViewMatrix = vuMatrix44FScale(scale, target.modelViewMatrix);
+        }
+        else
+        {
+            VuModelTargetObservationTargetInfo modelTargetInfo;
+            REQUIRE_SUCCESS(vuModelTargetObservationGetTargetInfo(observation, &modelTargetInfo));
+
+            if (poseInfo.poseStatus == VU_OBSERVATION_POSE_STATUS_NO_POSE)
+            {
+                updateGuideView(modelTargetInfo);
+                continue;
             }
+            mGuideViewModelTarget = nullptr;
+
+            // Compute model-view matrix
+            target.modelViewMatrix = vuMatrix44FMultiplyMatrix(frame.renderState.viewMatrix, poseInfo.pose);
+
+            // Calculate a scaled modelViewMatrix for rendering a unit bounding box
+            VuMatrix44F scaleMatrix = vuMatrix44FScalingMatrix(modelTargetInfo.size);
+            VuMatrix44F translateMatrix = vuMatrix44FTranslationMatrix(modelTargetInfo.bbox.center);
+
+            target.scaledModelViewMatrix = vuMatrix44FMultiplyMatrix(translateMatrix, scaleMatrix);
+            target.scaledModelViewMatrix = vuMatrix44FMultiplyMatrix(target.modelViewMatrix, target.scaledModelViewMatrix);
+        }
+    }
+    frame.guideView = mGuideViewModelTarget;
+
+    scheduleObservers();
+}
+
+
+void
+AppController::scheduleObservers()
+{
+    if (!mObserverScheduler)
+    {
+        return;
+    }
+
+    if (mPreferredChanged.exchange(false, std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(mPreferredMutex);
+        mObserverScheduler->setPreferred(mPendingPreferred);
+    }
+
+    // The scheduler is only updated once its changes can be made, see mEngineMutex
+    std::unique_lock<std::mutex> lock(mEngineMutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        return;
+    }
+
+    mObserverChanges.clear();
+    mObserverScheduler->update(mDetectedTargets.data(), mDetectedTargets.size(), mObserverChanges);
+    for (const ObserverScheduler::Change& change : mObserverChanges)
+    {
+        VuObserver* observer = mTargets[change.target].observer;
+        if ((change.activate ? vuObserverActivate(observer) : vuObserverDeactivate(observer)) != VU_SUCCESS)
+        {
+            LOG("Error %s image target observer for %s", change.activate ? "activating" : "deactivating",
+                mTargetNames[change.target].c_str());
+        }
+    }
+}
+
+
+void
+AppController::updateRecognition(int64_t timestamp)
+{
+    // The note already recognized wins ties, so two notes in view do not make it flip
+    int targetIndex = -1;
+    float confidence = 0.f;
+    for (uint32_t detected : mDetectedTargets)
+    {
+        const VuObservationPoseStatus poseStatus = mTargets[detected].poseStatus;
+        const float detectedConfidence = poseStatus == VU_OBSERVATION_POSE_STATUS_TRACKED ? 1.f
+                                         : poseStatus == VU_OBSERVATION_POSE_STATUS_LIMITED ? 0.5f
+                                                                                            : 0.f;
+        if (detectedConfidence > confidence ||
+            (detectedConfidence == confidence && detectedConfidence > 0.f &&
+             static_cast<int>(detected) == mPublishedRecognition.targetIndex))
+        {
+            targetIndex = static_cast<int>(detected);
+            confidence = detectedConfidence;
+        }
+    }
+
+    publishRecognition(targetIndex, confidence, timestamp);
+}
+
+
+void
+AppController::publishRecognition(int targetIndex, float confidence, int64_t timestamp)
+{
+    const bool changed = targetIndex != mPublishedRecognition.targetIndex;
+    mPublishedRecognition.targetIndex = targetIndex;
+    mPublishedRecognition.confidence = confidence;
+    mPublishedRecognition.timestamp = timestamp;
+    mPublishedRecognition.changeCount += changed ? 1 : 0;
+    mRecognition.store(mPublishedRecognition);
+
+    // Only changes take the lock, so frames that recognize the same note never wait
+    if (changed)
+    {
+        std::lock_guard<std::mutex> lock(mRecognitionCallbackMutex);
+        if (mRecognitionCallback != nullptr)
+        {
+            mRecognitionCallback(mRecognitionUserData, mPublishedRecognition);
+        }
+    }
+}
+
+
+void
+AppController::checkRelocalizing(const FrameSnapshot& snapshot)
+{
+    // Check for device tracker relocalizing for too long and reset if needed
+    if (snapshot.devicePoseStatus == VU_OBSERVATION_POSE_STATUS_LIMITED &&
+        snapshot.devicePoseStatusInfo == VU_DEVICE_POSE_OBSERVATION_STATUS_INFO_RELOCALIZING)
+    {
+        using namespace std::chrono;
+
+        // Start timing if we have just entered relocalizing state
+        if (!mTimingRelocalizingState)
+        {
+            mEnteredRelocalizingState = steady_clock::now();
         }
+        mTimingRelocalizingState = true;
+
+        // Check whether we have been relocalizing for longer than the threshold
+        auto relocalizingFor = duration_cast<seconds>(steady_clock::now() - mEnteredRelocalizingState);
+        // Tried again at the next frame if the engine lock is taken, see mEngineMutex
+        std::unique_lock<std::mutex> lock(mEngineMutex, std::defer_lock);
+        if (relocalizingFor.count() > MAX_RELOCALIZING_SECONDS && lock.try_lock())
+        {
+            mTimingRelocalizingState = false;
+            VuResult resetResult = vuEngineResetWorldTracking(mEngine);
+            LOG("%s reset world tracking", resetResult == VU_SUCCESS ? "Successfully" : "Failed to");
+        }
+    }
+    else
+    {
+        mTimingRelocalizingState = false;
+    }
+}
+
+
+void
+AppController::updateGuideView(const VuModelTargetObservationTargetInfo& modelTargetInfo)
+{
+    VuGuideViewList* guideViewList;
+    REQUIRE_SUCCESS(vuGuideViewListCreate(&guideViewList));
+
+    if (vuModelTargetObserverGetGuideViews(mObjectObserver, guideViewList) != VU_SUCCESS)
+    {
+        LOG("Error getting list of guide views");
     }
     else
     {
-        LOG("Error getting device pose observations");
+        int32_t size;
+        REQUIRE_SUCCESS(vuGuideViewListGetSize(guideViewList, &size));
+        mGuideViewModelTarget = [&]() -> VuGuideView* {
+            for (int i = 0; i < size; ++i)
+            {
+                VuGuideView* guideView = nullptr;
+                REQUIRE_SUCCESS(vuGuideViewListGetElement(guideViewList, i, &guideView));
+                const char* guideViewName = nullptr;
+                REQUIRE_SUCCESS(vuGuideViewGetName(guideView, &guideViewName));
+
+                // Note: We use the activeGuideViewName as we know there is a guide view for our dataset.
+                //       When using Advanced Model Targets there may not be a guide view and
+                //       activeGuideViewName will be NULL.
+                if (strcmp(guideViewName, modelTargetInfo.activeGuideViewName) == 0)
+                {
+                    return guideView;
+                }
+            }
+            return nullptr;
+        }();
+        if (!mGuideViewModelTarget)
+        {
+            LOG("Error getting guide view details");
+        }
     }
 
-    REQUIRE_SUCCESS(vuObservationListDestroy(observationList));
+    REQUIRE_SUCCESS(vuGuideViewListDestroy(guideViewList));
 }
@@ -8,17 +8,35 @@ countries.
 #ifndef __APPCONTROLLER_H__
 #define __APPCONTROLLER_H__
 
+#include "ObserverScheduler.h"
+#include "SeqLock.h"
+#include "TripleBuffer.h"
+
 #include <VuforiaEngine/VuforiaEngine.h>
 
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 
 /// The AppController provides a platform-independent encapsulation of the Vuforia lifecycle
 /// and Observer operation.
+///
+/// Frames are captured on Vuforia's camera thread as its states arrive and handed to the
+/// rendering thread through a lock-free triple buffer. The rendering thread never waits for
+/// a frame to be tracked, and the camera thread never waits for the rendering thread.
+/// What the tracker recognizes is published from the camera thread too, see getRecognition.
+/// All other methods are called from the rendering thread.
+///
+/// The Vuforia Engine API is not thread-safe. The engine calls that change its state are made
+/// holding the engine lock, on either thread, see mEngineMutex. Captured states are immutable
+/// and are read without it.
 class AppController
 {
 
@@ -26,6 +44,8 @@ public:
     // Constants
     static constexpr int IMAGE_TARGET_ID = 0;
     static constexpr int MODEL_TARGET_ID = 1;
+    /// Most target observations a FrameSnapshot holds, any more in a frame are dropped
+    static constexpr int MAX_SNAPSHOT_TARGETS = 16;
 
     // Type definitions
     using ErrorMessageCallback = std::function<void(const char* errorString)>;
@@ -43,6 +63,59 @@ public:
         InitDoneCallback initDoneCallback{};
     };
 
+    /// One target observation of a frame
+    struct TargetSnapshot
+    {
+        /// IMAGE_TARGET_ID or MODEL_TARGET_ID
+        int targetType;
+        /// Index of an image target in the database, see getTargetName, -1 for the model target
+        int targetIndex;
+        /// Name of the target in its database, valid until deinitAR
+        const char* name;
+        VuObservationPoseStatus poseStatus;
+        /// The matrices are identity if poseStatus is VU_OBSERVATION_POSE_STATUS_NO_POSE
+        VuMatrix44F modelViewMatrix;
+        /// modelViewMatrix scaled to the target size, for rendering a unit bounding box
+        VuMatrix44F scaledModelViewMatrix;
+    };
+
+    /// Everything rendering a frame needs from the Vuforia state, copied out in one pass
+    /// over its observations so it stays valid after finishRender releases the state.
+    /// Image targets are only listed while they have a pose, all of them that do are.
+    struct FrameSnapshot
+    {
+        /// Set by each prepareToRender, false if it had no frame or failed to update the
+        /// video background. The rest is then empty or stale.
+        bool isValid;
+        VuMatrix44F projectionMatrix;
+        VuMatrix44F viewMatrix;
+        VuMatrix44F vbProjectionMatrix;
+        /// Identity if devicePoseStatus is VU_OBSERVATION_POSE_STATUS_NO_POSE
+        VuMatrix44F devicePose;
+        VuObservationPoseStatus devicePoseStatus;
+        VuDevicePoseObservationStatusInfo devicePoseStatusInfo;
+        int numTargets;
+        TargetSnapshot targets[MAX_SNAPSHOT_TARGETS];
+    };
+
+    /// The note the tracker recognizes, published by the camera thread at every frame
+    struct Recognition
+    {
+        /// Index of the recognized image target, see getTargetName, -1 if no note is recognized.
+        /// A note only extended tracked is out of view and not recognized.
+        int targetIndex{ -1 };
+        /// 1 while the note is tracked, 0.5 while its pose is limited, 0 if no note is recognized
+        float confidence{ 0.f };
+        /// Camera timestamp of the latest frame in nanoseconds, 0 before the first
+        int64_t timestamp{ 0 };
+        /// Incremented each time targetIndex changes, so a poller can tell it missed a change
+        uint32_t changeCount{ 0 };
+    };
+
+    /// Called on the camera thread each time the recognized note changes, and from stopAR.
+    /// The engine lock is not held, so the callback may call the AppController.
+    using RecognitionCallback = void (*)(void* userData, const Recognition& recognition);
+
 
     /// Initialize Vuforia. When the initialization is completed successfully the callback
     /// method initDoneCallback will be invoked.
@@ -81,7 +154,9 @@ public:
     bool isARStarted() { return mARStarted; }
 
     /// Call this method at the start of Vuforia rendering.
-    /// Gets the latest video background texture from Vuforia.
+    /// Takes the latest frame captured on the camera thread, or keeps the current one if no newer
+    /// one has arrived, and updates the video background texture from it. Never waits for tracking,
+    /// only for an observer change or world tracking reset the camera thread is making.
     /// Whatever the result of this call finishRender must be called before rendering completes.
     bool prepareToRender(double* viewport, VuRenderVideoBackgroundData* renderData);
 
@@ -91,14 +166,38 @@ public:
 
     /// Get the current RenderState
     /// The returned object is only valid after prepareToRender has been called
-    const VuRenderState& getRenderState() { return mCurrentRenderState; }
+    const VuRenderState& getRenderState() { return mTrackedFrames.getFront().renderState; }
+
+    /// Get the device and target poses of the current frame
+    /// The returned object is only valid after prepareToRender has been called
+    const FrameSnapshot& getFrameSnapshot() { return mTrackedFrames.getFront().snapshot; }
 
     /// Get rendering information for the world origin position.
     /// Returns false if the world origin position is not currently available.
     bool getOrigin(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMatrix);
 
-    /// Get rendering information for the Image Target.
-    /// Returns false if Vuforia isn't currently tracking the Image Target.
+    /// Get the number of image targets loaded from the database
+    int getTargetCount() const { return static_cast<int>(mTargets.size()); }
+
+    /// Get the name of the image target at targetIndex, nullptr if there is none
+    const char* getTargetName(int targetIndex) const;
+
+    /// Rotate the image targets whose name contains currency through the active observers
+    /// before the others, nullptr or an empty string treats all alike.
+    /// Takes effect from the next captured frame.
+    void selectCurrency(const char* currency);
+
+    /// Get the note the tracker recognizes in the latest frame.
+    /// Can be called from any thread at any rate, it never blocks the camera thread.
+    Recognition getRecognition() const { return mRecognition.load(); }
+
+    /// Set the callback for changes of the recognized note, nullptr for none. No call to the
+    /// previous callback is in progress or follows once this returns, so it must not be
+    /// called from the callback itself.
+    void setRecognitionCallback(RecognitionCallback callback, void* userData);
+
+    /// Get rendering information for the first tracked Image Target, see getFrameSnapshot for all of them.
+    /// Returns false if Vuforia isn't currently tracking any Image Target.
     bool getImageTargetResult(VuMatrix44F& projectionMatrix, VuMatrix44F& modelViewMatrix, VuMatrix44F& scaledModelViewMatrix);
 
     /// Get rendering information for the Model Target.
@@ -112,8 +211,13 @@ public:
 
     /// Get the PlatformController handle.
     /// The result is only valid after initAR is called and before deinitAR is called.
+    /// Calls on it must hold the lock from lockEngine.
     VuController* getPlatformController() { return mPlatformController; }
 
+    /// Take the engine lock for engine calls made outside the AppController.
+    /// Must not be held when calling the AppController.
+    std::unique_lock<std::mutex> lockEngine() { return std::unique_lock<std::mutex>(mEngineMutex); }
+
 
 private: // methods
     /// Used by initAR to prepare and invoke Vuforia initialization.
@@ -136,8 +240,47 @@ private: // methods
     /// Clean up Observers created by createObservers
     void destroyObservers();
 
-    /// Called in prepareToRender to update the cached device pose information
-    void updateDevicePose();
+    /// State handler registered with Vuforia, clientData points to the AppController instance
+    static void onVuforiaState(const VuState* state, void* clientData);
+
+    /// Called by onVuforiaState on the camera thread to capture and publish a frame
+    void handleVuforiaState(const VuState* state);
+
+    /// Release the states of every captured frame, only while no state handler call can run
+    void releaseTrackedFrames();
+
+    /// A frame captured from a Vuforia state, with a reference to the state that keeps its
+    /// video frame and render state valid while the frame is in use
+    struct TrackedFrame
+    {
+        VuState* state;
+        VuRenderState renderState;
+        FrameSnapshot snapshot;
+        /// If a Model Target Guide View should be displayed this points to the object providing
+        /// details of what the App should render.
+        VuGuideView* guideView;
+    };
+
+    /// Called in handleVuforiaState to copy all observations of the Vuforia state to frame
+    void captureFrame(const VuState* state, TrackedFrame& frame);
+
+    /// Called in captureFrame to activate and deactivate image target observers for the next frames.
+    /// Does nothing if another thread holds the engine lock, the next frame makes the changes.
+    void scheduleObservers();
+
+    /// Called in handleVuforiaState to publish the best tracked target of the frame, whose
+    /// camera timestamp is timestamp
+    void updateRecognition(int64_t timestamp);
+
+    /// Publish a recognition, calling the recognition callback if the target changed
+    void publishRecognition(int targetIndex, float confidence, int64_t timestamp);
+
+    /// Reset world tracking if the device has been relocalizing for too long, at a later frame
+    /// if another thread holds the engine lock
+    void checkRelocalizing(const FrameSnapshot& snapshot);
+
+    /// Find the guide view to render for a Model Target that has no pose
+    void updateGuideView(const VuModelTargetObservationTargetInfo& modelTargetInfo);
 
 private: // data members
     /// Callback to inform the user of synchronous Vuforia Engine creation errors
@@ -151,6 +294,12 @@ private: // data members
     /// Vuforia Engine instance
     VuEngine* mEngine{ nullptr };
 
+    /// Held for the engine calls that change its state: lifecycle, render configuration, the
+    /// video background update, guide view images, observer activation and world tracking
+    /// resets. Engine calls on other threads can wait for the state handler to return, so the
+    /// camera thread only tries it and leaves what it could not do for a later frame.
+    std::mutex mEngineMutex;
+
     /// Vuforia render controller object
     VuController* mRenderController{ nullptr };
 
@@ -168,27 +317,18 @@ private: // data members
     /// Flag that is true when Vuforia is running
     bool mARStarted = false;
 
-    /// Local copy of current RenderState
-    VuRenderState mCurrentRenderState;
     /// Remember the display aspect ratio for later configuration of Guide View rendering
     float mDisplayAspectRatio;
 
     /// The observer for device poses
     VuObserver* mDevicePoseObserver = nullptr;
 
-    /// Data structure with information about the last known device pose
-    struct DevicePoseData
-    {
-        /// Device pose
-        VuMatrix44F pose{};
+    /// Frames from the camera thread to the rendering thread, which renders the front one.
+    /// The camera thread releases the state of a frame when it reuses its slot.
+    TripleBuffer<TrackedFrame> mTrackedFrames;
 
-        /// Device pose status
-        VuObservationPoseStatus poseStatus{ VU_OBSERVATION_POSE_STATUS_NO_POSE };
-
-        /// Device pose status info
-        VuDevicePoseObservationStatusInfo poseStatusInfo{ VU_DEVICE_POSE_OBSERVATION_STATUS_INFO_UNKNOWN };
-    };
-    DevicePoseData mLatestDevicePoseData{};
+    /// Observation list reused by every captureFrame, so frames do not allocate one
+    VuObservationList* mObservationList = nullptr;
 
     /// Flag set when the tracker is relocalizing
     bool mTimingRelocalizingState{ false };
@@ -197,14 +337,46 @@ private: // data members
     /// The maximum length of time in the RELOCALIZING state before tracking is reset
     static constexpr int MAX_RELOCALIZING_SECONDS{ 15 };
 
-    /// The observer for either the Image or Model target depending on which target was specified
-    VuObserver* mObjectObserver = nullptr;
+    /// State of one image target of the database
+    struct TargetState
+    {
+        VuObserver* observer;
+        /// Pose status of the latest frame, VU_OBSERVATION_POSE_STATUS_NO_POSE unless it is in mDetectedTargets
+        VuObservationPoseStatus poseStatus;
+    };
 
-    /// Between calls to prepareToRender and finishRender this holds a copy of the Vuforia state.
-    VuState* mVuforiaState = nullptr;
+    /// An observer per image target of the database, in database order
+    std::vector<TargetState> mTargets;
+    /// Index in mTargets of each vuObserverGetId, so an observation finds its target without
+    /// a walk over the database
+    std::unordered_map<int32_t, uint32_t> mTargetByObserverId;
+    /// Names of mTargets, kept apart as only the wrapper and UI read them
+    std::vector<std::string> mTargetNames;
+
+    /// Keeps the number of active image target observers bounded however many targets there are
+    std::unique_ptr<ObserverScheduler> mObserverScheduler;
+    /// Indices of the targets detected in the latest frame, the only ones whose pose status the
+    /// next frame resets, and the observers to activate or deactivate for it, reused across frames
+    std::vector<uint32_t> mDetectedTargets;
+    std::vector<ObserverScheduler::Change> mObserverChanges;
+    /// Preferred targets from selectCurrency, applied by the camera thread at its next frame
+    std::mutex mPreferredMutex;
+    std::vector<bool> mPendingPreferred;
+    std::atomic<bool> mPreferredChanged{ false };
+
+    /// Latest recognition for any thread, and its copy kept by the thread publishing it
+    SeqLock<Recognition> mRecognition;
+    Recognition mPublishedRecognition;
+    /// Held while the recognition callback is called or replaced, only when the target changes
+    std::mutex mRecognitionCallbackMutex;
+    RecognitionCallback mRecognitionCallback{ nullptr };
+    void* mRecognitionUserData{ nullptr };
+
+    /// The observer for the Model target when MODEL_TARGET_ID was specified
+    VuObserver* mObjectObserver = nullptr;
 
-    /// If a Model Target Guide View should be displayed this points to the object providing
-    /// details of what the App should render.
+    /// Guide view of the latest Model Target observation without a pose, copied to each
+    /// captured frame. Only used on the camera thread.
     VuGuideView* mGuideViewModelTarget = nullptr;
 };
 
@@ -0,0 +1,127 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __MEMORYMAPPEDFILE_H__
+#define __MEMORYMAPPEDFILE_H__
+
+#include <cstddef>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// Read-only view of a whole file mapped into memory
+/// The mapping is released when the object goes out of scope. The contents are
+/// not NUL-terminated, always use size() to bound any access.
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile() = default;
+    explicit MemoryMappedFile(const char* path) { open(path); }
+    ~MemoryMappedFile() { close(); }
+
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+    /// Map the file at path, returns false if it cannot be opened or mapped
+    bool open(const char* path)
+    {
+        close();
+        if (path == nullptr)
+        {
+            return false;
+        }
+
+#if defined(_WIN32)
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            return false;
+        }
+        mFallback.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        if (!file.read(mFallback.data(), static_cast<std::streamsize>(mFallback.size())))
+        {
+            mFallback.clear();
+            return false;
+        }
+        mData = mFallback.data();
+        mSize = mFallback.size();
+        mIsOpen = true;
+        return true;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat fileInfo;
+        if (fstat(fd, &fileInfo) != 0 || !S_ISREG(fileInfo.st_mode))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        mSize = static_cast<size_t>(fileInfo.st_size);
+        if (mSize > 0)
+        {
+            void* mapping = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                ::close(fd);
+                mSize = 0;
+                return false;
+            }
+            // The whole file is parsed front to back exactly once
+            madvise(mapping, mSize, MADV_SEQUENTIAL);
+            mData = static_cast<const char*>(mapping);
+        }
+
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+        mIsOpen = true;
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        mFallback.clear();
+        mFallback.shrink_to_fit();
+#else
+        if (mData != nullptr)
+        {
+            munmap(const_cast<char*>(mData), mSize);
+        }
+#endif
+        mData = nullptr;
+        mSize = 0;
+        mIsOpen = false;
+    }
+
+    bool isOpen() const { return mIsOpen; }
+    const char* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    const char* mData{ nullptr };
+    size_t mSize{ 0 };
+    bool mIsOpen{ false };
+#if defined(_WIN32)
+    std::vector<char> mFallback;
+#endif
+};
+
+#endif // __MEMORYMAPPEDFILE_H__
@@ -0,0 +1,278 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "MeshBounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MESH_BOUNDS_NEON 1
+#elif defined(__SSE2__)
+#include <xmmintrin.h>
+#define MESH_BOUNDS_SSE2 1
+#endif
+
+
+namespace
+{
+
+#if defined(MESH_BOUNDS_NEON) || defined(MESH_BOUNDS_SSE2)
+
+/// Vertices the SIMD loops read at a time, one per lane
+constexpr size_t SIMD_VERTICES = 4;
+
+#if defined(MESH_BOUNDS_NEON)
+
+typedef float32x4_t Float4;
+
+
+/// x, y and z of the four xyz vertices at positions, one vertex per lane
+inline void
+loadVertices(const float* positions, Float4 xyz[3])
+{
+    const float32x4x3_t vertices = vld3q_f32(positions);
+    xyz[0] = vertices.val[0];
+    xyz[1] = vertices.val[1];
+    xyz[2] = vertices.val[2];
+}
+
+
+inline Float4 splat(float value) { return vdupq_n_f32(value); }
+inline Float4 min4(Float4 a, Float4 b) { return vminq_f32(a, b); }
+inline Float4 max4(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+inline Float4 sub4(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+inline Float4 mulAdd4(Float4 sum, Float4 a, Float4 b) { return vmlaq_f32(sum, a, b); }
+inline float reduceMin(Float4 value) { return vminvq_f32(value); }
+inline float reduceMax(Float4 value) { return vmaxvq_f32(value); }
+
+#else
+
+typedef __m128 Float4;
+
+
+/// x, y and z of the four xyz vertices at positions, one vertex per lane.
+/// The last vertex is loaded from one float earlier so nothing past the twelve values is read.
+inline void
+loadVertices(const float* positions, Float4 xyz[3])
+{
+    __m128 row0 = _mm_loadu_ps(positions);
+    __m128 row1 = _mm_loadu_ps(positions + 3);
+    __m128 row2 = _mm_loadu_ps(positions + 6);
+    __m128 row3 = _mm_loadu_ps(positions + 8);
+    row3 = _mm_shuffle_ps(row3, row3, _MM_SHUFFLE(3, 3, 2, 1));
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    xyz[0] = row0;
+    xyz[1] = row1;
+    xyz[2] = row2;
+}
+
+
+inline Float4 splat(float value) { return _mm_set1_ps(value); }
+inline Float4 min4(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+inline Float4 max4(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+inline Float4 sub4(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 mulAdd4(Float4 sum, Float4 a, Float4 b) { return _mm_add_ps(sum, _mm_mul_ps(a, b)); }
+
+
+inline float
+reduceMin(Float4 value)
+{
+    value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+    value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(value);
+}
+
+
+inline float
+reduceMax(Float4 value)
+{
+    value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+    value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(value);
+}
+
+#endif
+
+#endif
+
+
+/// Center the sphere on the box
+void
+setSphereCenter(MeshBounds& bounds)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bounds.center[axis] = (bounds.min[axis] + bounds.max[axis]) * 0.5f;
+    }
+}
+
+
+float
+getSquaredDistance(const float* position, const float center[3])
+{
+    const float dx = position[0] - center[0];
+    const float dy = position[1] - center[1];
+    const float dz = position[2] - center[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+} // namespace
+
+
+MeshBounds
+computeMeshBounds(const float* positions, size_t numVertices)
+{
+    MeshBounds bounds{};
+    if (numVertices == 0)
+    {
+        return bounds;
+    }
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bounds.min[axis] = positions[axis];
+        bounds.max[axis] = positions[axis];
+    }
+
+    size_t vertex = 0;
+#if defined(MESH_BOUNDS_NEON) || defined(MESH_BOUNDS_SSE2)
+    if (numVertices >= SIMD_VERTICES)
+    {
+        // Four running minima and maxima per axis, reduced to one at the end
+        Float4 lower[3];
+        loadVertices(positions, lower);
+        Float4 upper[3] = { lower[0], lower[1], lower[2] };
+        for (vertex = SIMD_VERTICES; vertex + SIMD_VERTICES <= numVertices; vertex += SIMD_VERTICES)
+        {
+            Float4 xyz[3];
+            loadVertices(positions + 3 * vertex, xyz);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                lower[axis] = min4(lower[axis], xyz[axis]);
+                upper[axis] = max4(upper[axis], xyz[axis]);
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            bounds.min[axis] = reduceMin(lower[axis]);
+            bounds.max[axis] = reduceMax(upper[axis]);
+        }
+    }
+#endif
+    for (; vertex < numVertices; ++vertex)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            bounds.min[axis] = std::min(bounds.min[axis], positions[3 * vertex + axis]);
+            bounds.max[axis] = std::max(bounds.max[axis], positions[3 * vertex + axis]);
+        }
+    }
+    setSphereCenter(bounds);
+
+    // The center is only known once the box is, so the radius takes a second pass
+    float radiusSquared = 0.f;
+    vertex = 0;
+#if defined(MESH_BOUNDS_NEON) || defined(MESH_BOUNDS_SSE2)
+    const Float4 center[3] = { splat(bounds.center[0]), splat(bounds.center[1]), splat(bounds.center[2]) };
+    Float4 furthest = splat(0.f);
+    for (; vertex + SIMD_VERTICES <= numVertices; vertex += SIMD_VERTICES)
+    {
+        Float4 xyz[3];
+        loadVertices(positions + 3 * vertex, xyz);
+        Float4 distanceSquared = splat(0.f);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const Float4 offset = sub4(xyz[axis], center[axis]);
+            distanceSquared = mulAdd4(distanceSquared, offset, offset);
+        }
+        furthest = max4(furthest, distanceSquared);
+    }
+    radiusSquared = reduceMax(furthest);
+#endif
+    for (; vertex < numVertices; ++vertex)
+    {
+        radiusSquared = std::max(radiusSquared, getSquaredDistance(positions + 3 * vertex, bounds.center));
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+    return bounds;
+}
+
+
+MeshBounds
+computeMeshBounds(const float* positions, const uint32_t* indices, size_t numIndices)
+{
+    MeshBounds bounds{};
+    if (numIndices == 0)
+    {
+        return bounds;
+    }
+
+    // Gathered through the indices, which SIMD loads cannot do any faster
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bounds.min[axis] = positions[3 * indices[0] + axis];
+        bounds.max[axis] = positions[3 * indices[0] + axis];
+    }
+    for (size_t i = 1; i < numIndices; ++i)
+    {
+        const float* position = positions + 3 * static_cast<size_t>(indices[i]);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            bounds.min[axis] = std::min(bounds.min[axis], position[axis]);
+            bounds.max[axis] = std::max(bounds.max[axis], position[axis]);
+        }
+    }
+    setSphereCenter(bounds);
+
+    float radiusSquared = 0.f;
+    for (size_t i = 0; i < numIndices; ++i)
+    {
+        radiusSquared = std::max(radiusSquared, getSquaredDistance(positions + 3 * static_cast<size_t>(indices[i]), bounds.center));
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+    return bounds;
+}
+
+
+bool
+isMeshBoundsVisible(const MeshBounds& bounds, const float modelView[16], const float projection[16])
+{
+    // Model to clip space
+    float clip[16];
+    for (int column = 0; column < 4; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            clip[column * 4 + row] = projection[row] * modelView[column * 4] + projection[4 + row] * modelView[column * 4 + 1] +
+                                     projection[8 + row] * modelView[column * 4 + 2] +
+                                     projection[12 + row] * modelView[column * 4 + 3];
+        }
+    }
+
+    // A point is inside where -w <= x, y, z <= w, each side is a plane made
+    // of the w row plus or minus another row
+    for (int plane = 0; plane < 6; ++plane)
+    {
+        const int row = plane / 2;
+        const float sign = plane % 2 == 0 ? 1.f : -1.f;
+
+        // The corner of the box furthest inside the plane, the box is outside if even that is not in
+        float distance = clip[15] + sign * clip[12 + row];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float normal = clip[axis * 4 + 3] + sign * clip[axis * 4 + row];
+            distance += normal * (normal >= 0.f ? bounds.max[axis] : bounds.min[axis]);
+        }
+        if (distance < 0.f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __MESHBOUNDS_H__
+#define __MESHBOUNDS_H__
+
+#include <cstddef>
+#include <cstdint>
+
+
+/// Axis aligned box and bounding sphere of a set of positions, in model units.
+/// The sphere is centered on the box and just reaches the furthest position.
+/// All zero for an empty set.
+struct MeshBounds
+{
+    float min[3];
+    float max[3];
+    float center[3];
+    float radius;
+};
+
+static_assert(sizeof(MeshBounds) == 40, "MeshBounds is stored as is in mesh caches");
+
+
+/// Bounds of numVertices xyz positions, with NEON or SSE2 reductions where available
+MeshBounds computeMeshBounds(const float* positions, size_t numVertices);
+
+/// Bounds of the positions numIndices indices reference, indices must be in range
+MeshBounds computeMeshBounds(const float* positions, const uint32_t* indices, size_t numIndices);
+
+/// False if bounds are entirely outside the view frustum, so whatever they
+/// bound can be skipped. Conservative: true whenever unsure, such as for
+/// bounds that straddle a corner of the frustum. The matrices are column
+/// major as for selectMeshLod, the near plane is taken at -w so either
+/// depth convention works.
+bool isMeshBoundsVisible(const MeshBounds& bounds, const float modelView[16], const float projection[16]);
+
+#endif // __MESHBOUNDS_H__
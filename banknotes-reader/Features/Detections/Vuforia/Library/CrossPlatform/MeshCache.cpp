@@ -0,0 +1,390 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+namespace
+{
+
+constexpr uint64_t HASH_PRIME_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t HASH_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t HASH_PRIME_3 = 0x165667B19E3779F9ULL;
+
+
+uint64_t
+rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+
+uint64_t
+readWord(const unsigned char* bytes)
+{
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+
+uint64_t
+alignOffset(uint64_t offset)
+{
+    return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+
+/// Check that a blob lies inside the file and is aligned for in place use
+bool
+isValidBlob(uint64_t offset, uint64_t length, uint64_t fileSize)
+{
+    return offset % MESH_CACHE_ALIGNMENT == 0 && offset <= fileSize && length <= fileSize - offset;
+}
+
+} // namespace
+
+
+uint64_t
+hashMeshCacheBytes(const void* data, size_t size)
+{
+    // Four independent lanes over 32 byte blocks keep the multipliers busy,
+    // this runs at close to memory bandwidth for large files
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const uint64_t totalSize = size;
+
+    uint64_t lanes[4] = { HASH_PRIME_1 + HASH_PRIME_2, HASH_PRIME_2, 0, 0 - HASH_PRIME_1 };
+    while (size >= 32)
+    {
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            lanes[lane] = rotateLeft(lanes[lane] + readWord(bytes + 8 * lane) * HASH_PRIME_2, 31) * HASH_PRIME_1;
+        }
+        bytes += 32;
+        size -= 32;
+    }
+
+    uint64_t hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+    hash += totalSize;
+
+    while (size >= 8)
+    {
+        hash ^= rotateLeft(readWord(bytes) * HASH_PRIME_2, 31) * HASH_PRIME_1;
+        hash = rotateLeft(hash, 27) * HASH_PRIME_1 + HASH_PRIME_3;
+        bytes += 8;
+        size -= 8;
+    }
+    while (size > 0)
+    {
+        hash ^= *bytes * HASH_PRIME_3;
+        hash = rotateLeft(hash, 11) * HASH_PRIME_1;
+        ++bytes;
+        --size;
+    }
+
+    // Final avalanche so every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+
+bool
+readMeshCache(const char* data, size_t size, MeshCacheView& view, std::string& error)
+{
+    view = MeshCacheView();
+
+    if (data == nullptr || size < sizeof(MeshCacheHeader))
+    {
+        error = "File is too small for a mesh cache header";
+        return false;
+    }
+
+    const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(data);
+    if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0)
+    {
+        error = "Not a mesh cache file";
+        return false;
+    }
+    if (header->byteOrder != MESH_CACHE_BYTE_ORDER)
+    {
+        error = "Mesh cache was written with a different byte order";
+        return false;
+    }
+    if (header->version != MESH_CACHE_VERSION || header->headerSize != sizeof(MeshCacheHeader))
+    {
+        error = "Mesh cache version " + std::to_string(header->version) + " is not supported";
+        return false;
+    }
+    if (header->fileSize != size)
+    {
+        error = "Mesh cache is truncated";
+        return false;
+    }
+
+    const bool indexed = (header->flags & MESH_CACHE_FLAG_INDEXED) != 0;
+    if (indexed ? (header->indexSize != sizeof(uint16_t) && header->indexSize != sizeof(uint32_t))
+                : (header->indexSize != 0 || header->numIndices != 0))
+    {
+        error = "Mesh cache has an invalid index size";
+        return false;
+    }
+
+    const bool hasNormals = (header->flags & MESH_CACHE_FLAG_NORMALS) != 0;
+    const bool hasTangents = (header->flags & MESH_CACHE_FLAG_TANGENTS) != 0;
+    const uint64_t numVertices = header->numVertices;
+    const uint64_t numIndices = header->numIndices;
+    if (header->numLods > MESH_MAX_LODS || (header->numLods > 0 && !indexed))
+    {
+        error = "Mesh cache has an invalid number of levels of detail";
+        return false;
+    }
+    if (!isValidBlob(header->positionsOffset, numVertices * 3 * sizeof(float), size) ||
+        !isValidBlob(header->textureCoordinatesOffset, numVertices * 2 * sizeof(float), size) ||
+        !isValidBlob(header->normalsOffset, hasNormals ? numVertices * 3 * sizeof(float) : 0, size) ||
+        !isValidBlob(header->tangentsOffset, hasTangents ? numVertices * 4 * sizeof(float) : 0, size) ||
+        !isValidBlob(header->indicesOffset, numIndices * header->indexSize, size) ||
+        !isValidBlob(header->lodsOffset, header->numLods * sizeof(MeshLod), size) ||
+        !isValidBlob(header->shapeBoundsOffset, static_cast<uint64_t>(header->numShapes) * sizeof(MeshBounds), size) ||
+        !isValidBlob(header->shapeNamesOffset, header->shapeNamesSize, size))
+    {
+        error = "Mesh cache has a blob outside the file";
+        return false;
+    }
+
+    if (hashMeshCacheBytes(data + sizeof(MeshCacheHeader), size - sizeof(MeshCacheHeader)) != header->contentHash)
+    {
+        error = "Mesh cache content hash does not match";
+        return false;
+    }
+
+    view.header = header;
+    view.positions = reinterpret_cast<const float*>(data + header->positionsOffset);
+    view.textureCoordinates = reinterpret_cast<const float*>(data + header->textureCoordinatesOffset);
+    view.normals = hasNormals ? reinterpret_cast<const float*>(data + header->normalsOffset) : nullptr;
+    view.tangents = hasTangents ? reinterpret_cast<const float*>(data + header->tangentsOffset) : nullptr;
+    view.indices = indexed ? data + header->indicesOffset : nullptr;
+    view.lods = header->numLods > 0 ? reinterpret_cast<const MeshLod*>(data + header->lodsOffset) : nullptr;
+    view.shapeBounds = header->numShapes > 0 ? reinterpret_cast<const MeshBounds*>(data + header->shapeBoundsOffset) : nullptr;
+    view.shapeNames = header->numShapes > 0 ? data + header->shapeNamesOffset : nullptr;
+
+    // Readers walk the names up to each terminator, there has to be one per shape and none past the last
+    uint32_t numNames = 0;
+    for (uint32_t i = 0; i < header->shapeNamesSize; ++i)
+    {
+        numNames += data[header->shapeNamesOffset + i] == '\0' ? 1 : 0;
+    }
+    if (numNames != header->numShapes ||
+        (header->shapeNamesSize > 0 && data[header->shapeNamesOffset + header->shapeNamesSize - 1] != '\0'))
+    {
+        view = MeshCacheView();
+        error = "Mesh cache has invalid shape names";
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->numLods; ++i)
+    {
+        const MeshLod& lod = view.lods[i];
+        if (lod.indexCount % 3 != 0 || lod.indexOffset > numIndices || lod.indexCount > numIndices - lod.indexOffset)
+        {
+            view = MeshCacheView();
+            error = "Mesh cache has a level of detail outside the indices";
+            return false;
+        }
+    }
+
+    // The content hash only catches damage, an index past the vertex streams would
+    // make the GPU read out of bounds so those are checked as well
+    for (uint64_t i = 0; i < numIndices; ++i)
+    {
+        const uint32_t index = header->indexSize == sizeof(uint16_t) ? static_cast<const uint16_t*>(view.indices)[i]
+                                                                     : static_cast<const uint32_t*>(view.indices)[i];
+        if (index >= numVertices)
+        {
+            view = MeshCacheView();
+            error = "Mesh cache has an index past the last vertex";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+uint32_t
+getMeshCacheOptimizeFlags(const MeshOptimizeOptions& options)
+{
+    return (options.vertexCache ? MESH_CACHE_FLAG_VERTEX_CACHE_OPTIMIZED : 0) |
+           (options.overdraw ? MESH_CACHE_FLAG_OVERDRAW_OPTIMIZED : 0) |
+           (options.vertexFetch ? MESH_CACHE_FLAG_VERTEX_FETCH_OPTIMIZED : 0);
+}
+
+
+uint32_t
+getMeshCacheNormalFlags(MeshNormalSource source)
+{
+    switch (source)
+    {
+        case MeshNormalSource::SmoothingGroups:
+            return MESH_CACHE_FLAG_SMOOTHING_GROUP_NORMALS;
+        case MeshNormalSource::Smooth:
+            return MESH_CACHE_FLAG_SMOOTH_NORMALS;
+        default:
+            return 0;
+    }
+}
+
+
+uint32_t
+getMeshCacheLodHash(const MeshLodOptions& options)
+{
+    if (options.numLevels < 2)
+    {
+        return 0;
+    }
+    // The options are plain numbers without padding, their bytes identify them
+    const uint64_t hash = hashMeshCacheBytes(&options, sizeof(options));
+    return static_cast<uint32_t>(hash ^ (hash >> 32)) | 1;
+}
+
+
+bool
+writeMeshCache(const char* path, const MeshData& mesh, uint64_t sourceSize, uint64_t sourceHash, uint32_t processFlags,
+               uint32_t lodOptionsHash, std::string& error)
+{
+    if (mesh.getVertexCount() > UINT32_MAX || mesh.indices.size() > UINT32_MAX || mesh.shapeBounds.size() > UINT32_MAX ||
+        mesh.shapeNames.size() != mesh.shapeBounds.size())
+    {
+        error = "Mesh is too large for a mesh cache";
+        return false;
+    }
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.byteOrder = MESH_CACHE_BYTE_ORDER;
+    header.version = MESH_CACHE_VERSION;
+    header.headerSize = sizeof(MeshCacheHeader);
+    header.numVertices = static_cast<uint32_t>(mesh.getVertexCount());
+    header.numIndices = static_cast<uint32_t>(mesh.indices.size());
+    if (mesh.isIndexed())
+    {
+        header.flags |= MESH_CACHE_FLAG_INDEXED;
+        header.indexSize = mesh.canUse16BitIndices() ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+    if (mesh.hasNormals())
+    {
+        header.flags |= MESH_CACHE_FLAG_NORMALS | (processFlags & MESH_CACHE_NORMAL_SOURCE_FLAGS);
+    }
+    if (mesh.hasTangents())
+    {
+        header.flags |= MESH_CACHE_FLAG_TANGENTS;
+    }
+    header.flags |= processFlags & MESH_CACHE_OPTIMIZE_FLAGS;
+    header.numLods = static_cast<uint32_t>(mesh.lods.size());
+    header.lodOptionsHash = lodOptionsHash;
+    header.sourceSize = sourceSize;
+    header.sourceHash = sourceHash;
+    header.bounds = mesh.bounds;
+    header.numShapes = static_cast<uint32_t>(mesh.shapeBounds.size());
+
+    // Names end at their first NUL in the cache, an OBJ name could hold one
+    std::string shapeNames;
+    for (const std::string& name : mesh.shapeNames)
+    {
+        shapeNames.append(name.c_str());
+        shapeNames.push_back('\0');
+    }
+    if (shapeNames.size() > UINT32_MAX)
+    {
+        error = "Mesh shape names are too large for a mesh cache";
+        return false;
+    }
+    header.shapeNamesSize = static_cast<uint32_t>(shapeNames.size());
+
+    header.positionsOffset = sizeof(MeshCacheHeader);
+    header.textureCoordinatesOffset = alignOffset(header.positionsOffset + mesh.positions.size() * sizeof(float));
+    header.normalsOffset = alignOffset(header.textureCoordinatesOffset + mesh.textureCoordinates.size() * sizeof(float));
+    header.indicesOffset = alignOffset(header.normalsOffset + mesh.normals.size() * sizeof(float));
+    header.lodsOffset = alignOffset(header.indicesOffset + static_cast<uint64_t>(header.numIndices) * header.indexSize);
+    header.tangentsOffset = alignOffset(header.lodsOffset + mesh.lods.size() * sizeof(MeshLod));
+    header.shapeBoundsOffset = alignOffset(header.tangentsOffset + mesh.tangents.size() * sizeof(float));
+    header.shapeNamesOffset = alignOffset(header.shapeBoundsOffset + mesh.shapeBounds.size() * sizeof(MeshBounds));
+    header.fileSize = alignOffset(header.shapeNamesOffset + shapeNames.size());
+
+    // Assemble the whole file first, the content hash covers everything after the header
+    std::vector<char> file(header.fileSize, 0);
+    if (header.numVertices > 0)
+    {
+        memcpy(file.data() + header.positionsOffset, mesh.positions.data(), mesh.positions.size() * sizeof(float));
+        memcpy(file.data() + header.textureCoordinatesOffset, mesh.textureCoordinates.data(),
+               mesh.textureCoordinates.size() * sizeof(float));
+    }
+    if (mesh.hasNormals())
+    {
+        memcpy(file.data() + header.normalsOffset, mesh.normals.data(), mesh.normals.size() * sizeof(float));
+    }
+    if (header.indexSize == sizeof(uint16_t))
+    {
+        uint16_t* indices = reinterpret_cast<uint16_t*>(file.data() + header.indicesOffset);
+        for (size_t i = 0; i < mesh.indices.size(); ++i)
+        {
+            indices[i] = static_cast<uint16_t>(mesh.indices[i]);
+        }
+    }
+    else if (header.indexSize == sizeof(uint32_t))
+    {
+        memcpy(file.data() + header.indicesOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    }
+    if (!mesh.lods.empty())
+    {
+        memcpy(file.data() + header.lodsOffset, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+    }
+    if (mesh.hasTangents())
+    {
+        memcpy(file.data() + header.tangentsOffset, mesh.tangents.data(), mesh.tangents.size() * sizeof(float));
+    }
+    if (!mesh.shapeBounds.empty())
+    {
+        memcpy(file.data() + header.shapeBoundsOffset, mesh.shapeBounds.data(), mesh.shapeBounds.size() * sizeof(MeshBounds));
+        memcpy(file.data() + header.shapeNamesOffset, shapeNames.data(), shapeNames.size());
+    }
+    header.contentHash = hashMeshCacheBytes(file.data() + sizeof(MeshCacheHeader), file.size() - sizeof(MeshCacheHeader));
+    memcpy(file.data(), &header, sizeof(header));
+
+    const std::string tempPath = std::string(path) + ".tmp";
+    FILE* output = fopen(tempPath.c_str(), "wb");
+    if (output == nullptr)
+    {
+        error = "Failed to create " + tempPath;
+        return false;
+    }
+
+    const bool written = fwrite(file.data(), 1, file.size(), output) == file.size();
+    if (fclose(output) != 0 || !written)
+    {
+        remove(tempPath.c_str());
+        error = "Failed to write " + tempPath;
+        return false;
+    }
+
+    if (rename(tempPath.c_str(), path) != 0)
+    {
+        remove(tempPath.c_str());
+        error = std::string("Failed to move the mesh cache to ") + path;
+        return false;
+    }
+
+    return true;
+}
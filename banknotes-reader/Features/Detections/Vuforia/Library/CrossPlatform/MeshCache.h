@@ -0,0 +1,145 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __MESHCACHE_H__
+#define __MESHCACHE_H__
+
+#include "MeshBounds.h"
+#include "MeshLod.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/// Binary mesh cache file layout
+///
+/// [MeshCacheHeader][positions][texture coordinates][normals][indices][levels of detail][tangents]
+/// [shape bounds][shape names]
+///
+/// Every blob starts on a MESH_CACHE_ALIGNMENT boundary so it can be used in
+/// place from a memory mapping. All values are little endian.
+constexpr char MESH_CACHE_MAGIC[4] = { 'V', 'M', 'S', 'H' };
+constexpr uint32_t MESH_CACHE_BYTE_ORDER = 0x01020304;
+/// Bump whenever the layout or the meaning of a field changes
+constexpr uint32_t MESH_CACHE_VERSION = 5;
+constexpr uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+/// Set if the mesh has an index buffer
+constexpr uint32_t MESH_CACHE_FLAG_INDEXED = 1 << 0;
+/// Set if the mesh has normals, the normals blob is empty otherwise
+constexpr uint32_t MESH_CACHE_FLAG_NORMALS = 1 << 1;
+/// Set for each optimizeMesh pass the mesh went through before it was written
+constexpr uint32_t MESH_CACHE_FLAG_VERTEX_CACHE_OPTIMIZED = 1 << 2;
+constexpr uint32_t MESH_CACHE_FLAG_OVERDRAW_OPTIMIZED = 1 << 3;
+constexpr uint32_t MESH_CACHE_FLAG_VERTEX_FETCH_OPTIMIZED = 1 << 4;
+constexpr uint32_t MESH_CACHE_OPTIMIZE_FLAGS =
+    MESH_CACHE_FLAG_VERTEX_CACHE_OPTIMIZED | MESH_CACHE_FLAG_OVERDRAW_OPTIMIZED | MESH_CACHE_FLAG_VERTEX_FETCH_OPTIMIZED;
+/// Set if the mesh has tangents, the tangents blob is empty otherwise
+constexpr uint32_t MESH_CACHE_FLAG_TANGENTS = 1 << 5;
+/// Set if the normals were generated rather than read, for MeshNormalSource::SmoothingGroups or Smooth
+constexpr uint32_t MESH_CACHE_FLAG_SMOOTHING_GROUP_NORMALS = 1 << 6;
+constexpr uint32_t MESH_CACHE_FLAG_SMOOTH_NORMALS = 1 << 7;
+constexpr uint32_t MESH_CACHE_NORMAL_SOURCE_FLAGS = MESH_CACHE_FLAG_SMOOTHING_GROUP_NORMALS | MESH_CACHE_FLAG_SMOOTH_NORMALS;
+
+struct MeshCacheHeader
+{
+    char magic[4];
+    /// MESH_CACHE_BYTE_ORDER as written by the producer
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t headerSize;
+
+    uint32_t flags;
+    uint32_t numVertices;
+    uint32_t numIndices;
+    /// Bytes per index, 2 or 4, 0 for a non-indexed mesh
+    uint32_t indexSize;
+
+    /// Size and hash of the OBJ file the cache was built from
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+
+    /// Hash of every byte after the header
+    uint64_t contentHash;
+    uint64_t fileSize;
+
+    /// Byte offsets of the blobs from the start of the file
+    uint64_t positionsOffset;
+    uint64_t textureCoordinatesOffset;
+    uint64_t indicesOffset;
+    uint64_t normalsOffset;
+
+    /// Bounds of all vertices
+    MeshBounds bounds;
+
+    /// MeshLod entries at lodsOffset, 0 without a LOD chain
+    uint32_t numLods;
+    /// getMeshCacheLodHash of the options the chain was generated with
+    uint32_t lodOptionsHash;
+    uint64_t lodsOffset;
+    uint64_t tangentsOffset;
+
+    /// numShapes MeshBounds entries at shapeBoundsOffset, and the names of
+    /// the shapes at shapeNamesOffset, NUL terminated and back to back
+    uint64_t shapeBoundsOffset;
+    uint64_t shapeNamesOffset;
+    uint32_t numShapes;
+    uint32_t shapeNamesSize;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(MeshCacheHeader) == 192, "MeshCacheHeader layout must not change within a version");
+static_assert(sizeof(MeshCacheHeader) % MESH_CACHE_ALIGNMENT == 0, "Blobs after the header must stay aligned");
+
+
+/// Validated view into a cache file held in memory, the pointers reference that memory
+struct MeshCacheView
+{
+    const MeshCacheHeader* header{ nullptr };
+    const float* positions{ nullptr };
+    const float* textureCoordinates{ nullptr };
+    /// nullptr unless the header has MESH_CACHE_FLAG_NORMALS
+    const float* normals{ nullptr };
+    /// xyzw per vertex, nullptr unless the header has MESH_CACHE_FLAG_TANGENTS
+    const float* tangents{ nullptr };
+    /// uint16_t or uint32_t according to header->indexSize, nullptr for a non-indexed mesh
+    const void* indices{ nullptr };
+    /// header->numLods levels of detail, nullptr without a LOD chain
+    const MeshLod* lods{ nullptr };
+    /// header->numShapes bounds and names, nullptr without shapes
+    const MeshBounds* shapeBounds{ nullptr };
+    const char* shapeNames{ nullptr };
+};
+
+
+/// MESH_CACHE_FLAG_*_OPTIMIZED bits for the passes options selects
+uint32_t getMeshCacheOptimizeFlags(const MeshOptimizeOptions& options);
+
+/// MESH_CACHE_FLAG_*_NORMALS bit for normals from source, 0 for the OBJ normals
+uint32_t getMeshCacheNormalFlags(MeshNormalSource source);
+
+/// Nonzero tag of the options a LOD chain is generated with, 0 if they generate none
+uint32_t getMeshCacheLodHash(const MeshLodOptions& options);
+
+/// Fast non-cryptographic 64-bit hash used for the source and content hashes
+uint64_t hashMeshCacheBytes(const void* data, size_t size);
+
+/// Check that data holds a complete, uncorrupted cache file of the current version.
+/// Returns false and sets error otherwise.
+bool readMeshCache(const char* data, size_t size, MeshCacheView& view, std::string& error);
+
+/// Write mesh to path as a cache file tagged with the size and hash of its OBJ source,
+/// the processFlags it was built with, MESH_CACHE_FLAG_*_OPTIMIZED and *_NORMALS bits,
+/// and the lodOptionsHash of its LOD chain.
+/// The file is written next to path and renamed into place so readers never see a partial file.
+bool writeMeshCache(const char* path, const MeshData& mesh, uint64_t sourceSize, uint64_t sourceHash, uint32_t processFlags,
+                    uint32_t lodOptionsHash, std::string& error);
+
+#endif // __MESHCACHE_H__
@@ -0,0 +1,574 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "MeshLoader.h"
+
+#include "MeshNormals.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+
+namespace
+{
+
+/// OBJ indices of the data of one output vertex, the optional texcoord and
+/// normal indices are stored plus one so that a missing index is 0
+struct VertexKey
+{
+    uint32_t position;
+    uint32_t texcoord;
+    uint32_t normal;
+
+    bool operator==(const VertexKey& other) const
+    {
+        return position == other.position && texcoord == other.texcoord && normal == other.normal;
+    }
+    bool operator!=(const VertexKey& other) const { return !(*this == other); }
+};
+
+
+/// Open addressing hash map from a VertexKey to the index of the output vertex
+class VertexKeyMap
+{
+public:
+    explicit VertexKeyMap(size_t expectedKeys) { resize(expectedKeys * 2); }
+
+    /// Return the vertex stored for key, or store and return newVertex if the key is new
+    uint32_t findOrInsert(const VertexKey& key, uint32_t newVertex, bool& inserted)
+    {
+        size_t slot = hash(key) & mMask;
+        while (mKeys[slot] != EMPTY_KEY)
+        {
+            if (mKeys[slot] == key)
+            {
+                inserted = false;
+                return mVertices[slot];
+            }
+            slot = (slot + 1) & mMask;
+        }
+
+        mKeys[slot] = key;
+        mVertices[slot] = newVertex;
+        inserted = true;
+
+        // Keep the load factor at or below 1/2
+        if (++mSize * 2 > mKeys.size())
+        {
+            resize(mKeys.size() * 2);
+        }
+        return newVertex;
+    }
+
+private:
+    // Not a valid key, OBJ indices are at most INT_MAX
+    static constexpr VertexKey EMPTY_KEY{ ~0u, ~0u, ~0u };
+
+    static size_t hash(const VertexKey& vertexKey)
+    {
+        uint64_t key = (static_cast<uint64_t>(vertexKey.position) << 32) | vertexKey.texcoord;
+        key ^= vertexKey.normal * 0x9E3779B97F4A7C15ULL;
+
+        // Finalizer of MurmurHash3, spreads consecutive indices over the table
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+
+    static size_t getCapacity(size_t minCapacity)
+    {
+        size_t capacity = 16;
+        while (capacity < minCapacity)
+        {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    void resize(size_t minCapacity)
+    {
+        const size_t capacity = getCapacity(minCapacity);
+
+        std::vector<VertexKey> oldKeys(capacity, EMPTY_KEY);
+        std::vector<uint32_t> oldVertices(capacity);
+        oldKeys.swap(mKeys);
+        oldVertices.swap(mVertices);
+        mMask = capacity - 1;
+
+        for (size_t i = 0; i < oldKeys.size(); ++i)
+        {
+            if (oldKeys[i] != EMPTY_KEY)
+            {
+                size_t slot = hash(oldKeys[i]) & mMask;
+                while (mKeys[slot] != EMPTY_KEY)
+                {
+                    slot = (slot + 1) & mMask;
+                }
+                mKeys[slot] = oldKeys[i];
+                mVertices[slot] = oldVertices[i];
+            }
+        }
+    }
+
+    std::vector<VertexKey> mKeys;
+    std::vector<uint32_t> mVertices;
+    size_t mMask{ 0 };
+    size_t mSize{ 0 };
+};
+
+
+/// Key of the corners of a triangle that keeps apart corners whose generated
+/// normals differ: the smoothing group, or for a flat face the triangle itself
+/// with the top bit set, above any group number the parser gives.
+uint32_t
+getSmoothingKey(MeshNormalSource source, unsigned int smoothingGroup, size_t triangle)
+{
+    if (source == MeshNormalSource::Smooth)
+    {
+        return 1;
+    }
+    return smoothingGroup != 0 ? smoothingGroup : 0x80000000u | static_cast<uint32_t>(triangle);
+}
+
+
+/// Appends face corners to a mesh. In indexed mode corners with the same
+/// position, texture coordinate and, if kept, normal share one vertex.
+class MeshBuilder
+{
+public:
+    MeshBuilder(const std::vector<tinyobj::real_t>& positions, const std::vector<tinyobj::real_t>& texcoords,
+                const std::vector<tinyobj::real_t>& normals, const MeshBuildOptions& options, size_t expectedVertices,
+                MeshData& mesh) :
+        mPositions(positions),
+        mTexcoords(texcoords),
+        mNormals(normals),
+        mOptions(options),
+        mObjNormals(options.normals && options.normalSource == MeshNormalSource::Obj),
+        mGenerateNormals(options.normals && options.normalSource != MeshNormalSource::Obj),
+        mVertexMap(options.indexed ? expectedVertices : 0),
+        mSmoothingMap(mGenerateNormals ? expectedVertices : 0),
+        mMesh(mesh)
+    {
+        if (mGenerateNormals)
+        {
+            mSmoothingVertices.reserve(expectedVertices);
+        }
+    }
+
+    /// Start a shape, the corners added from now on are its. Ends the shape
+    /// before it, which is only kept if it has a triangle.
+    void beginShape(const std::string& name)
+    {
+        endShape();
+        mShapeName = name;
+        mShapeStart = getCornerCount();
+    }
+
+    /// Returns false if the corner references a missing position, texture coordinate or normal.
+    /// smoothingKey is the getSmoothingKey of the triangle, only used for generated normals.
+    bool addCorner(const tinyobj::index_t& idx, uint32_t smoothingKey)
+    {
+        if (idx.vertex_index < 0 || static_cast<size_t>(idx.vertex_index) >= mPositions.size() / 3 ||
+            static_cast<size_t>(idx.texcoord_index + 1) > mTexcoords.size() / 2 ||
+            (mObjNormals && static_cast<size_t>(idx.normal_index + 1) > mNormals.size() / 3))
+        {
+            return false;
+        }
+
+        if (!mOptions.indexed)
+        {
+            appendVertex(idx, smoothingKey);
+            return true;
+        }
+
+        const uint32_t normalKey =
+            mGenerateNormals ? smoothingKey : (mObjNormals ? static_cast<uint32_t>(idx.normal_index + 1) : 0);
+        const VertexKey key{ static_cast<uint32_t>(idx.vertex_index), static_cast<uint32_t>(idx.texcoord_index + 1), normalKey };
+        bool inserted = false;
+        const uint32_t vertex = mVertexMap.findOrInsert(key, static_cast<uint32_t>(mMesh.getVertexCount()), inserted);
+        if (inserted)
+        {
+            appendVertex(idx, smoothingKey);
+        }
+        mMesh.indices.push_back(vertex);
+        return true;
+    }
+
+    /// Generate the normals and tangents the options ask for and the bounds
+    /// of the mesh and its shapes once all corners are added
+    void finish()
+    {
+        endShape();
+        const size_t numCorners = getCornerCount();
+        mMesh.bounds = computeMeshBounds(mMesh.positions.data(), mMesh.getVertexCount());
+        mMesh.shapeBounds.reserve(mShapeCorners.size());
+        for (const auto& corners : mShapeCorners)
+        {
+            const size_t count = corners.second - corners.first;
+            if (count == numCorners)
+            {
+                // Every vertex is made for some corner, so a shape of all corners draws all of them
+                mMesh.shapeBounds.push_back(mMesh.bounds);
+            }
+            else if (mOptions.indexed)
+            {
+                mMesh.shapeBounds.push_back(computeMeshBounds(mMesh.positions.data(), mMesh.indices.data() + corners.first, count));
+            }
+            else
+            {
+                mMesh.shapeBounds.push_back(computeMeshBounds(mMesh.positions.data() + 3 * corners.first, count));
+            }
+        }
+
+        if (mGenerateNormals)
+        {
+            generateNormals(mMesh, mSmoothingVertices.data(), mNumSmoothingVertices);
+        }
+        if (mOptions.normals && mOptions.tangents)
+        {
+            generateTangents(mMesh);
+        }
+    }
+
+private:
+    /// Indices added so far, or vertices for a non-indexed mesh
+    size_t getCornerCount() const { return mOptions.indexed ? mMesh.indices.size() : mMesh.getVertexCount(); }
+
+    void endShape()
+    {
+        const size_t end = getCornerCount();
+        if (end > mShapeStart)
+        {
+            mShapeCorners.emplace_back(mShapeStart, end);
+            mMesh.shapeNames.push_back(mShapeName);
+        }
+        mShapeStart = end;
+    }
+
+    void appendVertex(const tinyobj::index_t& idx, uint32_t smoothingKey)
+    {
+        mMesh.positions.push_back(mPositions[3 * idx.vertex_index + 0]);
+        mMesh.positions.push_back(mPositions[3 * idx.vertex_index + 1]);
+        mMesh.positions.push_back(mPositions[3 * idx.vertex_index + 2]);
+
+        // The model may not have texture coordinates for every vertex
+        // If a texture coordinate is missing we just set it to 0,0
+        // This may not be suitable for rendering some OBJ model files
+        if (idx.texcoord_index < 0)
+        {
+            mMesh.textureCoordinates.push_back(0.f);
+            mMesh.textureCoordinates.push_back(0.f);
+        }
+        else
+        {
+            mMesh.textureCoordinates.push_back(mTexcoords[2 * idx.texcoord_index + 0]);
+            mMesh.textureCoordinates.push_back(mTexcoords[2 * idx.texcoord_index + 1]);
+        }
+
+        if (mGenerateNormals)
+        {
+            // Vertices of one position and smoothing group share their normal, whatever their texture coordinate
+            const VertexKey key{ static_cast<uint32_t>(idx.vertex_index), 0, smoothingKey };
+            bool inserted = false;
+            mSmoothingVertices.push_back(
+                mSmoothingMap.findOrInsert(key, static_cast<uint32_t>(mNumSmoothingVertices), inserted));
+            mNumSmoothingVertices += inserted ? 1 : 0;
+        }
+        if (!mObjNormals)
+        {
+            return;
+        }
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            mMesh.normals.push_back(idx.normal_index < 0 ? 0.f : mNormals[3 * idx.normal_index + axis]);
+        }
+    }
+
+    const std::vector<tinyobj::real_t>& mPositions;
+    const std::vector<tinyobj::real_t>& mTexcoords;
+    const std::vector<tinyobj::real_t>& mNormals;
+    const MeshBuildOptions mOptions;
+    const bool mObjNormals;
+    const bool mGenerateNormals;
+    VertexKeyMap mVertexMap;
+    /// Numbers the pairs of position and smoothing key for generated normals
+    VertexKeyMap mSmoothingMap;
+    std::vector<uint32_t> mSmoothingVertices;
+    size_t mNumSmoothingVertices{ 0 };
+    /// Corners of the shapes kept so far, and the name and first corner of the current one
+    std::vector<std::pair<size_t, size_t>> mShapeCorners;
+    std::string mShapeName;
+    size_t mShapeStart{ 0 };
+    MeshData& mMesh;
+};
+
+
+/// User data of the LoadObjWithCallbackFromBuffer callbacks in buildMeshFromObj.
+/// The OBJ values are reserved at the sizes the prescan counted.
+struct StreamingMeshState
+{
+    StreamingMeshState(const MeshBuildOptions& options, const tinyobj::obj_counts_t& counts, MeshData& mesh) :
+        keepNormals(options.normals && options.normalSource == MeshNormalSource::Obj),
+        normalSource(options.normalSource),
+        builder(positions, texcoords, normals, options, counts.num_vertices, mesh)
+    {
+        positions.reserve(3 * counts.num_vertices);
+        texcoords.reserve(2 * counts.num_texcoords);
+        if (keepNormals)
+        {
+            normals.reserve(3 * counts.num_normals);
+        }
+    }
+
+    /// 'v', 'vt' and 'vn' values laid out like attrib_t, faces are resolved against them.
+    /// Normals are only collected if the mesh keeps those of the OBJ.
+    std::vector<tinyobj::real_t> positions;
+    std::vector<tinyobj::real_t> texcoords;
+    std::vector<tinyobj::real_t> normals;
+    const bool keepNormals;
+    const MeshNormalSource normalSource;
+    MeshBuilder builder;
+
+    /// Group of the faces being read, and the triangles added so far
+    unsigned int smoothingGroup{ 0 };
+    size_t numTriangles{ 0 };
+
+    std::vector<tinyobj::index_t> polygon;
+    std::vector<tinyobj::index_t> triangles;
+    bool isValid{ true };
+};
+
+
+/// Make an OBJ index zero based the same way tinyobj does, 0 (not given) becomes -1
+int
+resolveIndex(int idx, size_t count)
+{
+    if (idx > 0)
+    {
+        return idx - 1;
+    }
+    if (idx < 0)
+    {
+        // Relative to the last element read so far
+        return static_cast<int>(count) + idx;
+    }
+    return -1;
+}
+
+
+void
+onVertex(void* userData, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t /* w */)
+{
+    StreamingMeshState& state = *static_cast<StreamingMeshState*>(userData);
+    state.positions.push_back(x);
+    state.positions.push_back(y);
+    state.positions.push_back(z);
+}
+
+
+void
+onTexcoord(void* userData, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t /* z */)
+{
+    StreamingMeshState& state = *static_cast<StreamingMeshState*>(userData);
+    state.texcoords.push_back(x);
+    state.texcoords.push_back(y);
+}
+
+
+void
+onNormal(void* userData, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z)
+{
+    StreamingMeshState& state = *static_cast<StreamingMeshState*>(userData);
+    if (state.keepNormals)
+    {
+        state.normals.push_back(x);
+        state.normals.push_back(y);
+        state.normals.push_back(z);
+    }
+}
+
+
+void
+onSmoothingGroup(void* userData, unsigned int smoothingGroup)
+{
+    static_cast<StreamingMeshState*>(userData)->smoothingGroup = smoothingGroup;
+}
+
+
+void
+onGroup(void* userData, const char** names, int numNames)
+{
+    // LoadObj joins the names of a group the same way
+    std::string name;
+    for (int i = 0; i < numNames; ++i)
+    {
+        name += (i > 0 ? " " : "") + std::string(names[i]);
+    }
+    static_cast<StreamingMeshState*>(userData)->builder.beginShape(name);
+}
+
+
+void
+onObject(void* userData, const char* name)
+{
+    static_cast<StreamingMeshState*>(userData)->builder.beginShape(name);
+}
+
+
+void
+onFace(void* userData, tinyobj::index_t* indices, int numIndices)
+{
+    StreamingMeshState& state = *static_cast<StreamingMeshState*>(userData);
+    if (!state.isValid)
+    {
+        return;
+    }
+
+    state.polygon.resize(numIndices);
+    for (int i = 0; i < numIndices; ++i)
+    {
+        tinyobj::index_t& idx = state.polygon[i];
+        idx.vertex_index = resolveIndex(indices[i].vertex_index, state.positions.size() / 3);
+        idx.texcoord_index = resolveIndex(indices[i].texcoord_index, state.texcoords.size() / 2);
+        idx.normal_index = state.keepNormals ? resolveIndex(indices[i].normal_index, state.normals.size() / 3) : -1;
+
+        // Triangulation reads the positions, so check them before that
+        if (idx.vertex_index < 0 || static_cast<size_t>(idx.vertex_index) >= state.positions.size() / 3)
+        {
+            state.isValid = false;
+            return;
+        }
+    }
+
+    state.triangles.clear();
+    tinyobj::TriangulateFace(state.polygon.data(), state.polygon.size(), state.positions.data(), state.positions.size(),
+                             &state.triangles);
+    for (size_t i = 0; i < state.triangles.size(); ++i)
+    {
+        const uint32_t smoothingKey = getSmoothingKey(state.normalSource, state.smoothingGroup, state.numTriangles + i / 3);
+        if (!state.builder.addCorner(state.triangles[i], smoothingKey))
+        {
+            state.isValid = false;
+            return;
+        }
+    }
+    state.numTriangles += state.triangles.size() / 3;
+}
+
+} // namespace
+
+
+bool
+buildMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, const MeshBuildOptions& options,
+          MeshData& mesh)
+{
+    const bool indexed = options.indexed;
+    mesh = MeshData();
+
+    size_t numCorners = 0;
+    for (const auto& shape : shapes)
+    {
+        numCorners += shape.mesh.indices.size();
+    }
+
+    // Most OBJ positions are shared by a handful of corners with the same
+    // texture coordinate, so the unique count is close to the position count
+    const size_t expectedVertices = indexed ? attrib.vertices.size() / 3 : numCorners;
+    mesh.positions.reserve(expectedVertices * 3);
+    mesh.textureCoordinates.reserve(expectedVertices * 2);
+    if (options.normals)
+    {
+        mesh.normals.reserve(expectedVertices * 3);
+    }
+    if (options.normals && options.tangents)
+    {
+        mesh.tangents.reserve(expectedVertices * 4);
+    }
+    if (indexed)
+    {
+        mesh.indices.reserve(numCorners);
+    }
+
+    MeshBuilder builder(attrib.vertices, attrib.texcoords, attrib.normals, options, expectedVertices, mesh);
+    size_t triangle = 0;
+    for (const auto& shape : shapes)
+    {
+        builder.beginShape(shape.name);
+
+        // Triangulated shapes have a smoothing group per triangle
+        const std::vector<unsigned int>& smoothingGroups = shape.mesh.smoothing_group_ids;
+        for (size_t i = 0; i < shape.mesh.indices.size(); ++i)
+        {
+            const unsigned int smoothingGroup = i / 3 < smoothingGroups.size() ? smoothingGroups[i / 3] : 0;
+            if (!builder.addCorner(shape.mesh.indices[i], getSmoothingKey(options.normalSource, smoothingGroup, triangle + i / 3)))
+            {
+                return false;
+            }
+        }
+        triangle += shape.mesh.indices.size() / 3;
+    }
+
+    builder.finish();
+    return true;
+}
+
+
+bool
+buildMeshFromObj(const char* data, size_t dataSize, const MeshBuildOptions& options, MeshData& mesh, std::string& err)
+{
+    mesh = MeshData();
+
+    // A quick count of the lines lets every container be allocated once at its final size
+    tinyobj::obj_counts_t counts;
+    tinyobj::CountObjElements(data, dataSize, &counts);
+
+    // A polygon of n corners becomes n - 2 triangles
+    const size_t triangleCorners =
+        counts.num_face_corners > 2 * counts.num_faces ? 3 * (counts.num_face_corners - 2 * counts.num_faces) : 0;
+    const size_t expectedVertices = options.indexed ? counts.num_vertices : triangleCorners;
+    mesh.positions.reserve(3 * expectedVertices);
+    mesh.textureCoordinates.reserve(2 * expectedVertices);
+    if (options.normals)
+    {
+        mesh.normals.reserve(3 * expectedVertices);
+    }
+    if (options.normals && options.tangents)
+    {
+        mesh.tangents.reserve(4 * expectedVertices);
+    }
+    if (options.indexed)
+    {
+        mesh.indices.reserve(triangleCorners);
+    }
+
+    tinyobj::callback_t callback;
+    callback.vertex_cb = onVertex;
+    callback.texcoord_cb = onTexcoord;
+    callback.normal_cb = onNormal;
+    callback.index_cb = onFace;
+    callback.smoothing_group_cb = onSmoothingGroup;
+    callback.group_cb = onGroup;
+    callback.object_cb = onObject;
+
+    StreamingMeshState state(options, counts, mesh);
+    std::string warn;
+    if (!tinyobj::LoadObjWithCallbackFromBuffer(data, dataSize, callback, &state, nullptr, &warn, &err) || !err.empty())
+    {
+        return false;
+    }
+
+    if (!state.isValid)
+    {
+        err = "A face references a position, texture coordinate or normal that is not defined before it";
+        return false;
+    }
+
+    state.builder.finish();
+    return true;
+}
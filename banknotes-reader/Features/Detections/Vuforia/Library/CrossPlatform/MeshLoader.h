@@ -0,0 +1,120 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __MESHLOADER_H__
+#define __MESHLOADER_H__
+
+#include "MeshBounds.h"
+#include "tiny_obj_loader.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/// Most levels of detail a mesh can have, the full detail level included
+constexpr int MESH_MAX_LODS = 4;
+
+
+/// Part of the index buffer that draws one level of detail
+struct MeshLod
+{
+    uint32_t indexOffset{ 0 };
+    uint32_t indexCount{ 0 };
+    /// Largest distance of the simplified surface from the full detail one, in model units
+    float error{ 0.f };
+};
+
+static_assert(sizeof(MeshLod) == 12, "MeshLod is stored as is in mesh caches");
+
+
+/// Renderable triangle mesh built from a parsed OBJ file
+struct MeshData
+{
+    /// xyz per vertex
+    std::vector<float> positions;
+    /// uv per vertex, (0,0) where the OBJ has no texture coordinate
+    std::vector<float> textureCoordinates;
+    /// xyz per vertex if normals were requested, (0,0,0) where the OBJ has no normal
+    std::vector<float> normals;
+    /// xyzw per vertex if tangents were requested. w is the handedness, the
+    /// bitangent is w * cross(normal, tangent).
+    std::vector<float> tangents;
+    /// Triangle list into the vertex streams, empty for a non-indexed mesh
+    std::vector<uint32_t> indices;
+    /// Levels of detail stored back to back in indices, finest first. Empty
+    /// unless a LOD chain was generated, all indices are then one level.
+    std::vector<MeshLod> lods;
+    /// Bounds of all positions, set by buildMesh and buildMeshFromObj
+    MeshBounds bounds{};
+    /// Bounds of the positions each OBJ shape draws and the name of its 'g' or
+    /// 'o' line, in file order. Shapes without triangles are left out.
+    std::vector<MeshBounds> shapeBounds;
+    std::vector<std::string> shapeNames;
+
+    size_t getVertexCount() const { return positions.size() / 3; }
+    bool isIndexed() const { return !indices.empty(); }
+    bool hasNormals() const { return !normals.empty(); }
+    bool hasTangents() const { return !tangents.empty(); }
+
+    /// True if every index fits a 16-bit index buffer.
+    /// 0xFFFF is left out as it is the primitive restart value in Metal.
+    bool canUse16BitIndices() const { return getVertexCount() < 0xFFFF; }
+};
+
+
+/// Where the normals of a mesh come from
+enum class MeshNormalSource
+{
+    /// The vn values of the OBJ
+    Obj,
+    /// Generated from the faces and shared by the faces of a smoothing group
+    /// that use the same OBJ position. Faces outside any group ('s off', or
+    /// before the first 's' line) are flat.
+    SmoothingGroups,
+    /// Generated from the faces and shared by all faces that use the same
+    /// OBJ position, for OBJ files without smoothing groups
+    Smooth,
+};
+
+
+/// Options for buildMesh and buildMeshFromObj
+struct MeshBuildOptions
+{
+    /// Share vertices between faces and produce an index buffer
+    bool indexed{ true };
+    /// Add normals. Indexed vertices are then also split where the normal
+    /// differs, without normals the normal indices are ignored.
+    bool normals{ false };
+    MeshNormalSource normalSource{ MeshNormalSource::Obj };
+    /// Generate tangents from the normals and texture coordinates, only with normals
+    bool tangents{ false };
+};
+
+
+/// Build a mesh from the triangulated faces of all shapes, each shape with
+/// triangles becomes one of mesh.shapeBounds.
+/// Non-indexed: one vertex per face corner, in face order.
+/// Indexed: one vertex per unique (vertex_index, texcoord_index, normal_index) triple,
+/// in order of first use, and an index buffer referencing them. Generated
+/// normals take the place of normal_index with the smoothing group of the
+/// face, every triangle of a flat face gets its own vertices.
+/// Returns false if a face references a missing position, texture coordinate or normal.
+bool buildMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, const MeshBuildOptions& options,
+               MeshData& mesh);
+
+/// Build the same mesh as buildMesh on the output of LoadObjFromBuffer, in a
+/// single pass over the OBJ text. Faces are resolved and triangulated as they
+/// are read, straight into the mesh, so only the raw positions and texture
+/// coordinates are kept besides the result. As the OBJ format requires, faces
+/// must only reference vertices defined before them. Shapes start at every
+/// 'g' and 'o' line, as LoadObj starts them.
+/// Containers are sized from a prescan of the text, so each is allocated once.
+/// Returns false and sets err if the OBJ cannot be parsed or a face references a missing vertex.
+bool buildMeshFromObj(const char* data, size_t dataSize, const MeshBuildOptions& options, MeshData& mesh, std::string& err);
+
+#endif // __MESHLOADER_H__
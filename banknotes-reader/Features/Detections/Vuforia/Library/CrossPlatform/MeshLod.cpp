@@ -0,0 +1,426 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "MeshLod.h"
+
+#include "MeshBounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+
+/// A level is only kept if it drops at least this fraction of the triangles of the level before
+constexpr float MIN_LOD_REDUCTION = 0.1f;
+
+
+/// Weighted sum of squared distances to a set of planes, as p^T A p + 2 b^T p + c
+struct Quadric
+{
+    double a00{ 0 }, a01{ 0 }, a02{ 0 }, a11{ 0 }, a12{ 0 }, a22{ 0 };
+    double b0{ 0 }, b1{ 0 }, b2{ 0 };
+    double c{ 0 };
+    double weight{ 0 };
+
+    void addPlane(double nx, double ny, double nz, double d, double weight)
+    {
+        a00 += weight * nx * nx;
+        a01 += weight * nx * ny;
+        a02 += weight * nx * nz;
+        a11 += weight * ny * ny;
+        a12 += weight * ny * nz;
+        a22 += weight * nz * nz;
+        b0 += weight * nx * d;
+        b1 += weight * ny * d;
+        b2 += weight * nz * d;
+        c += weight * d * d;
+        this->weight += weight;
+    }
+
+    void add(const Quadric& other)
+    {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a11 += other.a11;
+        a12 += other.a12;
+        a22 += other.a22;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+    }
+
+    /// Mean squared distance of p to the planes
+    double evaluate(const float* p) const
+    {
+        if (weight == 0.)
+        {
+            return 0.;
+        }
+        const double x = p[0], y = p[1], z = p[2];
+        const double error = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                             2 * (b0 * x + b1 * y + b2 * z) + c;
+        return std::max(error / weight, 0.);
+    }
+};
+
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+
+void
+getTriangleNormal(const float* p0, const float* p1, const float* p2, double normal[3])
+{
+    const double e1[3] = { double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2] };
+    const double e2[3] = { double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2] };
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+
+/// Give vertices that share a position the same id, the first of them
+std::vector<uint32_t>
+getPositionIds(const std::vector<float>& positions)
+{
+    const size_t numVertices = positions.size() / 3;
+    std::vector<uint32_t> order(numVertices);
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        order[v] = static_cast<uint32_t>(v);
+    }
+    const auto less = [&positions](uint32_t a, uint32_t b)
+    { return std::lexicographical_compare(&positions[a * 3], &positions[a * 3 + 3], &positions[b * 3], &positions[b * 3 + 3]); };
+    std::sort(order.begin(), order.end(), less);
+
+    std::vector<uint32_t> ids(numVertices);
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        const bool same = i > 0 && !less(order[i - 1], order[i]);
+        ids[order[i]] = same ? ids[order[i - 1]] : order[i];
+    }
+    return ids;
+}
+
+
+/// Moving a onto b must not turn any remaining triangle of a over
+bool
+flipsTriangles(uint32_t a, uint32_t b, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& triangleOffsets,
+               const std::vector<uint32_t>& triangleList, const std::vector<float>& positions)
+{
+    for (uint32_t i = triangleOffsets[a]; i < triangleOffsets[a + 1]; ++i)
+    {
+        const uint32_t* triangle = &indices[triangleList[i] * 3];
+        if (triangle[0] == b || triangle[1] == b || triangle[2] == b)
+        {
+            // Collapses to nothing
+            continue;
+        }
+
+        const float* corners[3];
+        const float* moved[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            corners[k] = &positions[triangle[k] * 3];
+            moved[k] = triangle[k] == a ? &positions[b * 3] : corners[k];
+        }
+
+        double before[3];
+        double after[3];
+        getTriangleNormal(corners[0], corners[1], corners[2], before);
+        getTriangleNormal(moved[0], moved[1], moved[2], after);
+        if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+
+float
+simplifyMesh(const std::vector<uint32_t>& indices, const std::vector<float>& positions, size_t targetIndexCount, float targetError,
+             std::vector<uint32_t>& result)
+{
+    result = indices;
+    const size_t numVertices = positions.size() / 3;
+    if (result.size() <= targetIndexCount || numVertices == 0)
+    {
+        return 0.f;
+    }
+
+    // Vertices at one position are the same point of the surface, the error
+    // is tracked per point and texture seams between them are not moved
+    const std::vector<uint32_t> positionIds = getPositionIds(positions);
+    std::vector<bool> locked(numVertices, false);
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        if (positionIds[v] != v)
+        {
+            locked[v] = true;
+            locked[positionIds[v]] = true;
+        }
+    }
+
+    // An edge with a single triangle is on an open border, collapsing it would shrink the hole
+    std::vector<uint64_t> edges;
+    edges.reserve(result.size());
+    for (size_t t = 0; t < result.size(); t += 3)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint64_t p0 = positionIds[result[t + k]];
+            const uint64_t p1 = positionIds[result[t + (k + 1) % 3]];
+            edges.push_back(std::min(p0, p1) << 32 | std::max(p0, p1));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();)
+    {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j] == edges[i])
+        {
+            ++j;
+        }
+        if (j - i == 1)
+        {
+            locked[edges[i] >> 32] = true;
+            locked[edges[i] & 0xFFFFFFFF] = true;
+        }
+        i = j;
+    }
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        locked[v] = locked[v] || locked[positionIds[v]];
+    }
+
+    // Planes of the triangles around every point, weighted by area
+    std::vector<Quadric> quadrics(numVertices);
+    for (size_t t = 0; t < result.size(); t += 3)
+    {
+        const float* p0 = &positions[result[t] * 3];
+        double normal[3];
+        getTriangleNormal(p0, &positions[result[t + 1] * 3], &positions[result[t + 2] * 3], normal);
+        const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length == 0.)
+        {
+            continue;
+        }
+        const double nx = normal[0] / length, ny = normal[1] / length, nz = normal[2] / length;
+        const double d = -(nx * p0[0] + ny * p0[1] + nz * p0[2]);
+        for (int k = 0; k < 3; ++k)
+        {
+            quadrics[positionIds[result[t + k]]].addPlane(nx, ny, nz, d, length * 0.5);
+        }
+    }
+
+    const double errorLimit = double(targetError) * targetError;
+    double reachedError = 0.;
+    std::vector<uint32_t> triangleOffsets(numVertices + 1);
+    std::vector<uint32_t> triangleList;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(numVertices);
+    std::vector<bool> touched(numVertices);
+
+    // Every pass collapses the cheapest edges that do not share a neighbourhood,
+    // then rebuilds the triangles, until the target or the error limit is hit
+    while (result.size() > targetIndexCount)
+    {
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (const uint32_t index : result)
+        {
+            ++triangleOffsets[index + 1];
+        }
+        for (size_t v = 0; v < numVertices; ++v)
+        {
+            triangleOffsets[v + 1] += triangleOffsets[v];
+        }
+        triangleList.resize(result.size());
+        std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            triangleList[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                const uint32_t a = result[t + k];
+                const uint32_t b = result[t + (k + 1) % 3];
+                Quadric quadric = quadrics[positionIds[a]];
+                quadric.add(quadrics[positionIds[b]]);
+                if (!locked[a])
+                {
+                    collapses.push_back({ a, b, quadric.evaluate(&positions[b * 3]) });
+                }
+                if (!locked[b])
+                {
+                    collapses.push_back({ b, a, quadric.evaluate(&positions[a * 3]) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        // Stop the pass once enough triangles are gone for the target
+        const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        for (size_t v = 0; v < numVertices; ++v)
+        {
+            remap[v] = static_cast<uint32_t>(v);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.error > errorLimit || removed >= trianglesToRemove)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] ||
+                flipsTriangles(collapse.from, collapse.to, result, triangleOffsets, triangleList, positions))
+            {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[positionIds[collapse.to]].add(quadrics[collapse.from]);
+            reachedError = std::max(reachedError, collapse.error);
+
+            // Neighbours keep their position this pass, so the flip checks above stay valid
+            for (uint32_t i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; ++i)
+            {
+                const uint32_t* triangle = &result[triangleList[i] * 3];
+                removed += triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to;
+                for (int k = 0; k < 3; ++k)
+                {
+                    touched[triangle[k]] = true;
+                }
+            }
+        }
+
+        if (removed == 0)
+        {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            const uint32_t a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+            if (a != b && b != c && a != c)
+            {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    return static_cast<float>(std::sqrt(reachedError));
+}
+
+
+void
+generateLodChain(MeshData& mesh, const MeshLodOptions& options)
+{
+    mesh.lods.clear();
+    const int numLevels = std::min(options.numLevels, MESH_MAX_LODS);
+    if (!mesh.isIndexed() || numLevels < 2)
+    {
+        return;
+    }
+
+    // Not mesh.bounds, the chain also serves meshes that were not built from an OBJ
+    const MeshBounds bounds = computeMeshBounds(mesh.positions.data(), mesh.getVertexCount());
+    const float extent = std::sqrt((bounds.max[0] - bounds.min[0]) * (bounds.max[0] - bounds.min[0]) +
+                                   (bounds.max[1] - bounds.min[1]) * (bounds.max[1] - bounds.min[1]) +
+                                   (bounds.max[2] - bounds.min[2]) * (bounds.max[2] - bounds.min[2]));
+
+    const std::vector<uint32_t> fullDetail = mesh.indices;
+    MeshLod full;
+    full.indexCount = static_cast<uint32_t>(fullDetail.size());
+    mesh.lods.push_back(full);
+
+    // Every level starts from the full detail mesh, so its error is measured
+    // against the real surface rather than the level before
+    std::vector<uint32_t> simplified;
+    for (int level = 1; level < numLevels; ++level)
+    {
+        const size_t target = static_cast<size_t>(fullDetail.size() / 3 * options.triangleRatio[level - 1]) * 3;
+        const float error = simplifyMesh(fullDetail, mesh.positions, target, options.targetError[level - 1] * extent, simplified);
+
+        const MeshLod& previous = mesh.lods.back();
+        if (simplified.empty() || simplified.size() > previous.indexCount * (1.f - MIN_LOD_REDUCTION))
+        {
+            continue;
+        }
+
+        MeshLod lod;
+        lod.indexOffset = static_cast<uint32_t>(mesh.indices.size());
+        lod.indexCount = static_cast<uint32_t>(simplified.size());
+        lod.error = std::max(error, previous.error);
+        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+        mesh.lods.push_back(lod);
+    }
+
+    if (mesh.lods.size() < 2)
+    {
+        mesh.lods.clear();
+    }
+}
+
+
+int
+selectMeshLod(const MeshLod* lods, size_t numLods, const float center[3], float radius, const float modelView[16],
+              const float projection[16], float viewportHeight, float maxPixelError)
+{
+    if (numLods < 2)
+    {
+        return 0;
+    }
+
+    // The longest column of the rotation part is the largest scale of the model
+    float scale = 0.f;
+    for (int column = 0; column < 3; ++column)
+    {
+        const float* c = &modelView[column * 4];
+        scale = std::max(scale, std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]));
+    }
+
+    const float depth =
+        std::fabs(modelView[2] * center[0] + modelView[6] * center[1] + modelView[10] * center[2] + modelView[14]);
+    const float distance = depth - radius * scale;
+    if (distance <= 0.f)
+    {
+        return 0;
+    }
+
+    // Pixels covered by one model unit at the near side of the bounding sphere
+    const float pixelsPerUnit = std::fabs(projection[5]) * 0.5f * viewportHeight * scale / distance;
+    for (size_t level = numLods - 1; level > 0; --level)
+    {
+        if (lods[level].error * pixelsPerUnit <= maxPixelError)
+        {
+            return static_cast<int>(level);
+        }
+    }
+    return 0;
+}
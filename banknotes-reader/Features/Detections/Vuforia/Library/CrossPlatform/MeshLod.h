@@ -0,0 +1,52 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __MESHLOD_H__
+#define __MESHLOD_H__
+
+#include "MeshLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/// Options for generateLodChain
+struct MeshLodOptions
+{
+    /// Levels in the chain including the full detail mesh, 1 turns generation off
+    int numLevels{ 1 };
+    /// Triangles each coarser level aims for, as a fraction of the full detail mesh
+    float triangleRatio[MESH_MAX_LODS - 1]{ 0.5f, 0.25f, 0.1f };
+    /// Largest error each coarser level may reach, as a fraction of the bounds diagonal.
+    /// A level stops short of its triangle count rather than exceed it.
+    float targetError[MESH_MAX_LODS - 1]{ 0.005f, 0.01f, 0.02f };
+};
+
+
+/// Simplify the triangles of indices by quadric error edge collapses until at
+/// most targetIndexCount indices are left or the next collapse would move the
+/// surface further than targetError, in model units. Vertices are only moved
+/// onto other vertices, so the result indexes the same vertex streams.
+/// Texture seams and open borders are kept in place.
+/// Returns the error reached, in model units.
+float simplifyMesh(const std::vector<uint32_t>& indices, const std::vector<float>& positions, size_t targetIndexCount,
+                   float targetError, std::vector<uint32_t>& result);
+
+/// Append coarser levels to the indices of an indexed mesh and describe all
+/// levels in mesh.lods. Levels that would barely differ from the one before
+/// are left out, so the chain can be shorter than requested.
+void generateLodChain(MeshData& mesh, const MeshLodOptions& options);
+
+/// Pick the coarsest level whose error covers at most maxPixelError pixels at
+/// the projected size of the bounding sphere. The matrices are column major,
+/// modelView includes the model scale. Returns 0 without a chain or when the
+/// camera is inside the sphere.
+int selectMeshLod(const MeshLod* lods, size_t numLods, const float center[3], float radius, const float modelView[16],
+                  const float projection[16], float viewportHeight, float maxPixelError);
+
+#endif // __MESHLOD_H__
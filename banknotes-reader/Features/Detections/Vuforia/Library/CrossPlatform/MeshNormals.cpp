@@ -0,0 +1,419 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "MeshNormals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+/// Fewest elements worth a thread of their own, below that starting it costs more than it saves
+constexpr size_t MIN_ELEMENTS_PER_THREAD = 16 * 1024;
+
+constexpr uint32_t NO_VERTEX = UINT32_MAX;
+
+
+/// Run function(begin, end) on contiguous ranges covering [0, count), on the
+/// calling thread and up to numThreads - 1 more
+template <typename Function>
+void
+parallelFor(size_t count, unsigned int numThreads, const Function& function)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    const size_t numRanges = std::max<size_t>(std::min<size_t>(numThreads, count / MIN_ELEMENTS_PER_THREAD), 1);
+    const size_t rangeSize = (count + numRanges - 1) / numRanges;
+
+    std::vector<std::thread> threads;
+    threads.reserve(numRanges - 1);
+    for (size_t range = 1; range < numRanges; ++range)
+    {
+        const size_t begin = std::min(range * rangeSize, count);
+        const size_t end = std::min(begin + rangeSize, count);
+        threads.emplace_back([&function, begin, end]() { function(begin, end); });
+    }
+    function(0, std::min(rangeSize, count));
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+
+struct Vector3
+{
+    float x{ 0.f };
+    float y{ 0.f };
+    float z{ 0.f };
+};
+
+
+Vector3
+load(const float* values)
+{
+    return { values[0], values[1], values[2] };
+}
+
+
+void
+store(const Vector3& v, float* values)
+{
+    values[0] = v.x;
+    values[1] = v.y;
+    values[2] = v.z;
+}
+
+
+Vector3
+operator+(const Vector3& a, const Vector3& b)
+{
+    return { a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+
+Vector3
+operator-(const Vector3& a, const Vector3& b)
+{
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+
+Vector3
+operator*(const Vector3& a, float s)
+{
+    return { a.x * s, a.y * s, a.z * s };
+}
+
+
+float
+dot(const Vector3& a, const Vector3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+
+Vector3
+cross(const Vector3& a, const Vector3& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+
+/// Unit vector along v, or (0,0,0) if v has no usable length
+Vector3
+normalize(const Vector3& v)
+{
+    const float length = std::sqrt(dot(v, v));
+    return length > 0.f && length < INFINITY ? v * (1.f / length) : Vector3();
+}
+
+
+/// Angle between two edges, atan2 stays accurate for nearly parallel edges where acos does not
+float
+getAngle(const Vector3& a, const Vector3& b)
+{
+    const Vector3 c = cross(a, b);
+    return std::atan2(std::sqrt(dot(c, c)), dot(a, b));
+}
+
+
+/// Triangle corners of a mesh, the index buffer or the vertices themselves for a non-indexed mesh
+class Corners
+{
+public:
+    explicit Corners(const MeshData& mesh) :
+        mIndices(mesh.isIndexed() ? mesh.indices.data() : nullptr),
+        mCount(mesh.isIndexed() ? mesh.indices.size() : mesh.getVertexCount() / 3 * 3)
+    {
+    }
+
+    size_t size() const { return mCount; }
+    uint32_t operator[](size_t corner) const { return mIndices != nullptr ? mIndices[corner] : static_cast<uint32_t>(corner); }
+
+private:
+    const uint32_t* mIndices;
+    size_t mCount;
+};
+
+
+/// Corners sorted by the element they contribute to, the corners of element e
+/// are corners[offsets[e]] to corners[offsets[e + 1]]. With them each element
+/// sums its own corners, so the sums need no atomics or per thread copies.
+struct CornerLists
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> corners;
+};
+
+
+template <typename ElementOf>
+CornerLists
+groupCorners(size_t numCorners, size_t numElements, const ElementOf& elementOf)
+{
+    CornerLists lists;
+    lists.offsets.assign(numElements + 1, 0);
+    for (size_t corner = 0; corner < numCorners; ++corner)
+    {
+        ++lists.offsets[elementOf(corner) + 1];
+    }
+    for (size_t element = 0; element < numElements; ++element)
+    {
+        lists.offsets[element + 1] += lists.offsets[element];
+    }
+
+    lists.corners.resize(numCorners);
+    std::vector<uint32_t> next(lists.offsets.begin(), lists.offsets.end() - 1);
+    for (size_t corner = 0; corner < numCorners; ++corner)
+    {
+        lists.corners[next[elementOf(corner)]++] = static_cast<uint32_t>(corner);
+    }
+    return lists;
+}
+
+
+/// Number the vertices so that vertices with the same position, normal and
+/// texture coordinate get the same number, in order of first appearance.
+/// Returns the count of numbers.
+size_t
+weldVertices(const MeshData& mesh, std::vector<uint32_t>& welded, unsigned int numThreads)
+{
+    const size_t numVertices = mesh.getVertexCount();
+    const float* positions = mesh.positions.data();
+    const float* normals = mesh.normals.data();
+    const float* textureCoordinates = mesh.textureCoordinates.data();
+
+    auto isSame = [&](uint32_t a, uint32_t b) {
+        return memcmp(positions + 3 * a, positions + 3 * b, 3 * sizeof(float)) == 0 &&
+               memcmp(normals + 3 * a, normals + 3 * b, 3 * sizeof(float)) == 0 &&
+               memcmp(textureCoordinates + 2 * a, textureCoordinates + 2 * b, 2 * sizeof(float)) == 0;
+    };
+
+    // Hashing is most of the work and independent per vertex
+    std::vector<uint64_t> hashes(numVertices);
+    parallelFor(numVertices, numThreads, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v)
+        {
+            uint32_t bits[8];
+            memcpy(bits, positions + 3 * v, 3 * sizeof(float));
+            memcpy(bits + 3, normals + 3 * v, 3 * sizeof(float));
+            memcpy(bits + 6, textureCoordinates + 2 * v, 2 * sizeof(float));
+
+            uint64_t hash = 0;
+            for (uint32_t word : bits)
+            {
+                hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+            }
+            hashes[v] = hash ^ (hash >> 29);
+        }
+    });
+
+    // Open addressing with a load factor of at most 1/2, slots hold the first vertex of a group
+    size_t capacity = 16;
+    while (capacity < 2 * numVertices)
+    {
+        capacity <<= 1;
+    }
+    std::vector<uint32_t> slots(capacity, NO_VERTEX);
+
+    welded.resize(numVertices);
+    size_t numWelded = 0;
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        size_t slot = hashes[v] & (capacity - 1);
+        while (slots[slot] != NO_VERTEX && !(hashes[slots[slot]] == hashes[v] && isSame(slots[slot], static_cast<uint32_t>(v))))
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        if (slots[slot] == NO_VERTEX)
+        {
+            slots[slot] = static_cast<uint32_t>(v);
+            welded[v] = static_cast<uint32_t>(numWelded++);
+        }
+        else
+        {
+            welded[v] = welded[slots[slot]];
+        }
+    }
+    return numWelded;
+}
+
+
+/// Some unit vector perpendicular to normal
+Vector3
+getAnyTangent(const Vector3& normal)
+{
+    // Crossing with the axis least aligned with the normal keeps the result well conditioned
+    const Vector3 axis = std::fabs(normal.x) < 0.5f ? Vector3{ 1.f, 0.f, 0.f } : Vector3{ 0.f, 1.f, 0.f };
+    const Vector3 tangent = normalize(cross(axis, normal));
+    return dot(tangent, tangent) > 0.f ? tangent : Vector3{ 1.f, 0.f, 0.f };
+}
+
+} // namespace
+
+
+void
+generateNormals(MeshData& mesh, const uint32_t* smoothingVertices, size_t numSmoothingVertices, unsigned int numThreads)
+{
+    const size_t numVertices = mesh.getVertexCount();
+    const Corners corners(mesh);
+    const size_t numTriangles = corners.size() / 3;
+    const float* positions = mesh.positions.data();
+
+    // Every corner's share of its vertex normal, the unit triangle normal times the corner angle
+    std::vector<float> cornerNormals(3 * corners.size());
+    parallelFor(numTriangles, numThreads, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t)
+        {
+            const Vector3 p0 = load(positions + 3 * corners[3 * t + 0]);
+            const Vector3 p1 = load(positions + 3 * corners[3 * t + 1]);
+            const Vector3 p2 = load(positions + 3 * corners[3 * t + 2]);
+            const Vector3 e01 = p1 - p0;
+            const Vector3 e02 = p2 - p0;
+            const Vector3 e12 = p2 - p1;
+            const Vector3 normal = normalize(cross(e01, e02));
+
+            store(normal * getAngle(e01, e02), &cornerNormals[9 * t + 0]);
+            store(normal * getAngle(e12, p0 - p1), &cornerNormals[9 * t + 3]);
+            store(normal * getAngle(p0 - p2, p1 - p2), &cornerNormals[9 * t + 6]);
+        }
+    });
+
+    const CornerLists lists =
+        groupCorners(corners.size(), numSmoothingVertices, [&](size_t corner) { return smoothingVertices[corners[corner]]; });
+
+    std::vector<float> smoothNormals(3 * numSmoothingVertices);
+    parallelFor(numSmoothingVertices, numThreads, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s)
+        {
+            Vector3 sum;
+            for (uint32_t i = lists.offsets[s]; i < lists.offsets[s + 1]; ++i)
+            {
+                sum = sum + load(&cornerNormals[3 * lists.corners[i]]);
+            }
+            store(normalize(sum), &smoothNormals[3 * s]);
+        }
+    });
+
+    mesh.normals.resize(3 * numVertices);
+    parallelFor(numVertices, numThreads, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v)
+        {
+            memcpy(&mesh.normals[3 * v], &smoothNormals[3 * smoothingVertices[v]], 3 * sizeof(float));
+        }
+    });
+}
+
+
+void
+generateTangents(MeshData& mesh, unsigned int numThreads)
+{
+    const size_t numVertices = mesh.getVertexCount();
+    if (!mesh.hasNormals() || mesh.normals.size() != 3 * numVertices || mesh.textureCoordinates.size() != 2 * numVertices)
+    {
+        mesh.tangents.clear();
+        return;
+    }
+
+    const Corners corners(mesh);
+    const size_t numTriangles = corners.size() / 3;
+    const float* positions = mesh.positions.data();
+    const float* normals = mesh.normals.data();
+    const float* textureCoordinates = mesh.textureCoordinates.data();
+
+    // Every corner's share of the tangent and bitangent of its vertex. As in
+    // MikkTSpace the texture space directions of the triangle are unit length
+    // and oriented by the sign of its texture area, then made perpendicular
+    // to the vertex normal and weighted by the corner angle.
+    std::vector<float> cornerTangents(3 * corners.size());
+    std::vector<float> cornerBitangents(3 * corners.size());
+    parallelFor(numTriangles, numThreads, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t)
+        {
+            uint32_t v[3];
+            Vector3 p[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                v[k] = corners[3 * t + k];
+                p[k] = load(positions + 3 * v[k]);
+            }
+            const float* uv0 = textureCoordinates + 2 * v[0];
+            const float* uv1 = textureCoordinates + 2 * v[1];
+            const float* uv2 = textureCoordinates + 2 * v[2];
+            const float du1 = uv1[0] - uv0[0];
+            const float dv1 = uv1[1] - uv0[1];
+            const float du2 = uv2[0] - uv0[0];
+            const float dv2 = uv2[1] - uv0[1];
+            const Vector3 e1 = p[1] - p[0];
+            const Vector3 e2 = p[2] - p[0];
+
+            const float orientation = du1 * dv2 - dv1 * du2 > 0.f ? 1.f : -1.f;
+            const Vector3 triangleTangent = normalize(e1 * dv2 - e2 * dv1) * orientation;
+            const Vector3 triangleBitangent = normalize(e2 * du1 - e1 * du2) * orientation;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                const Vector3 normal = load(normals + 3 * v[k]);
+                const Vector3 tangent = normalize(triangleTangent - normal * dot(normal, triangleTangent));
+                const Vector3 bitangent = normalize(triangleBitangent - normal * dot(normal, triangleBitangent));
+                const float angle = getAngle(p[(k + 1) % 3] - p[k], p[(k + 2) % 3] - p[k]);
+                store(tangent * angle, &cornerTangents[3 * (3 * t + k)]);
+                store(bitangent * angle, &cornerBitangents[3 * (3 * t + k)]);
+            }
+        }
+    });
+
+    std::vector<uint32_t> welded;
+    const size_t numWelded = weldVertices(mesh, welded, numThreads);
+    const CornerLists lists = groupCorners(corners.size(), numWelded, [&](size_t corner) { return welded[corners[corner]]; });
+
+    // xyzw of each welded vertex, and a vertex to read its normal from
+    std::vector<float> weldedTangents(4 * numWelded);
+    std::vector<uint32_t> weldedVertices(numWelded);
+    for (size_t v = numVertices; v-- > 0;)
+    {
+        weldedVertices[welded[v]] = static_cast<uint32_t>(v);
+    }
+
+    parallelFor(numWelded, numThreads, [&](size_t begin, size_t end) {
+        for (size_t w = begin; w < end; ++w)
+        {
+            Vector3 tangentSum;
+            Vector3 bitangentSum;
+            for (uint32_t i = lists.offsets[w]; i < lists.offsets[w + 1]; ++i)
+            {
+                tangentSum = tangentSum + load(&cornerTangents[3 * lists.corners[i]]);
+                bitangentSum = bitangentSum + load(&cornerBitangents[3 * lists.corners[i]]);
+            }
+
+            const Vector3 normal = load(normals + 3 * weldedVertices[w]);
+            Vector3 tangent = normalize(tangentSum - normal * dot(normal, tangentSum));
+            if (dot(tangent, tangent) == 0.f)
+            {
+                tangent = getAnyTangent(normal);
+            }
+            store(tangent, &weldedTangents[4 * w]);
+            weldedTangents[4 * w + 3] = dot(cross(normal, tangent), bitangentSum) < 0.f ? -1.f : 1.f;
+        }
+    });
+
+    mesh.tangents.resize(4 * numVertices);
+    parallelFor(numVertices, numThreads, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v)
+        {
+            memcpy(&mesh.tangents[4 * v], &weldedTangents[4 * welded[v]], 4 * sizeof(float));
+        }
+    });
+}
@@ -0,0 +1,38 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __MESHNORMALS_H__
+#define __MESHNORMALS_H__
+
+#include "MeshLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+
+
+/// Set mesh.normals to smooth normals, the average of the normals of the
+/// triangles around a vertex weighted by the angle of their corner there.
+/// Vertices with the same smoothingVertices entry average over the triangles
+/// of all of them and share the result, so splitting a vertex along a
+/// texture seam does not show in the shading. smoothingVertices has an entry
+/// below numSmoothingVertices for every vertex. Vertices with only
+/// degenerate triangles get (0,0,0).
+/// Large meshes are split over numThreads threads, 0 uses every hardware thread.
+void generateNormals(MeshData& mesh, const uint32_t* smoothingVertices, size_t numSmoothingVertices,
+                     unsigned int numThreads = 0);
+
+/// Set mesh.tangents from its normals and texture coordinates with the
+/// conventions of MikkTSpace, so normal maps baked against it shade without
+/// seams: each corner contributes its texture space tangent projected onto
+/// the vertex normal and weighted by its angle, and the handedness in w makes
+/// the shader's bitangent w * cross(normal, tangent). Vertices with the same
+/// position, normal and texture coordinate share a tangent. A vertex without
+/// a usable texture mapping gets a unit tangent perpendicular to its normal.
+/// Clears the tangents of a mesh without normals.
+void generateTangents(MeshData& mesh, unsigned int numThreads = 0);
+
+#endif // __MESHNORMALS_H__
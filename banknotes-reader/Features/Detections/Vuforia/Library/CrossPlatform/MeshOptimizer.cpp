@@ -0,0 +1,457 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+
+/// LRU cache the vertex cache optimizer scores against, larger than the
+/// hardware FIFO so that the order also suits GPUs with a bigger cache
+constexpr int SCORE_CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+constexpr uint32_t NO_TRIANGLE = UINT32_MAX;
+
+
+/// Forsyth's vertex score: high for vertices near the front of the cache and
+/// for vertices with few triangles left, so they are finished off early
+float
+getVertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.f;
+    }
+
+    float score = 0.f;
+    if (cachePosition >= 0)
+    {
+        // The last triangle's vertices get a fixed score, otherwise the
+        // optimizer would prefer strips that thrash a small cache
+        if (cachePosition < 3)
+        {
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            const float scale = 1.f / (SCORE_CACHE_SIZE - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+    return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+}
+
+
+struct Vector3
+{
+    float x{ 0.f };
+    float y{ 0.f };
+    float z{ 0.f };
+};
+
+
+Vector3
+getPosition(const std::vector<float>& positions, uint32_t vertex)
+{
+    return { positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2] };
+}
+
+} // namespace
+
+
+float
+computeAcmr(const std::vector<uint32_t>& indices, size_t numVertices, unsigned int cacheSize)
+{
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+    {
+        return 0.f;
+    }
+
+    // A vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(numVertices, 0);
+    size_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (const uint32_t index : indices)
+    {
+        if (time - loadedAt[index] > cacheSize)
+        {
+            loadedAt[index] = time++;
+            ++misses;
+        }
+    }
+    return static_cast<float>(misses) / numTriangles;
+}
+
+
+void
+optimizeVertexCache(std::vector<uint32_t>& indices, size_t numVertices)
+{
+    const size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // Triangles of every vertex in one array, the first remaining[v] entries
+    // of a vertex's range are the triangles it still has to be drawn with
+    std::vector<uint32_t> offsets(numVertices + 1, 0);
+    for (const uint32_t index : indices)
+    {
+        ++offsets[index + 1];
+    }
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> remaining(numVertices, 0);
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            adjacency[offsets[v] + remaining[v]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        vertexScore[v] = getVertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(numTriangles);
+    uint32_t bestTriangle = 0;
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        triangleScore[t] =
+            vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[bestTriangle])
+        {
+            bestTriangle = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(SCORE_CACHE_SIZE + 3);
+    newCache.reserve(SCORE_CACHE_SIZE + 3);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    size_t inputCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < numTriangles; ++emittedCount)
+    {
+        // Nothing in the cache has triangles left, continue in input order
+        if (bestTriangle == NO_TRIANGLE)
+        {
+            while (emitted[inputCursor])
+            {
+                ++inputCursor;
+            }
+            bestTriangle = static_cast<uint32_t>(inputCursor);
+        }
+
+        const uint32_t* triangle = &indices[bestTriangle * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        newCache.clear();
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = triangle[k];
+            uint32_t* begin = &adjacency[offsets[v]];
+            uint32_t* end = begin + remaining[v];
+            uint32_t* found = std::find(begin, end, bestTriangle);
+            if (found != end)
+            {
+                std::swap(*found, *(end - 1));
+                --remaining[v];
+            }
+
+            if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+            {
+                newCache.push_back(v);
+            }
+        }
+        for (const uint32_t v : cache)
+        {
+            if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        // Rescore everything that moved in or out of the cache, the triangle
+        // scores follow the change of their vertices
+        for (size_t i = 0; i < newCache.size(); ++i)
+        {
+            const uint32_t v = newCache[i];
+            cachePosition[v] = i < SCORE_CACHE_SIZE ? static_cast<int>(i) : -1;
+            const float score = getVertexScore(cachePosition[v], remaining[v]);
+            const float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; ++a)
+            {
+                triangleScore[adjacency[a]] += delta;
+            }
+        }
+
+        // Only triangles of cached vertices changed, the best one is among them
+        bestTriangle = NO_TRIANGLE;
+        float bestScore = -1.f;
+        if (newCache.size() > SCORE_CACHE_SIZE)
+        {
+            newCache.resize(SCORE_CACHE_SIZE);
+        }
+        for (const uint32_t v : newCache)
+        {
+            for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; ++a)
+            {
+                if (triangleScore[adjacency[a]] > bestScore)
+                {
+                    bestScore = triangleScore[adjacency[a]];
+                    bestTriangle = adjacency[a];
+                }
+            }
+        }
+        cache.swap(newCache);
+    }
+
+    indices.swap(result);
+}
+
+
+void
+optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& positions)
+{
+    const size_t numTriangles = indices.size() / 3;
+    const size_t numVertices = positions.size() / 3;
+    if (numTriangles < 2)
+    {
+        return;
+    }
+
+    // A triangle whose corners all miss the cache is where the cache order
+    // started over, so moving the runs between them around costs little reuse
+    std::vector<size_t> clusterStarts;
+    std::vector<size_t> loadedAt(numVertices, 0);
+    size_t time = MESH_OPTIMIZE_FIFO_SIZE + 1;
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            if (time - loadedAt[v] > MESH_OPTIMIZE_FIFO_SIZE)
+            {
+                loadedAt[v] = time++;
+                ++misses;
+            }
+        }
+        if (misses == 3 || t == 0)
+        {
+            clusterStarts.push_back(t);
+        }
+    }
+    const size_t numClusters = clusterStarts.size();
+    clusterStarts.push_back(numTriangles);
+    if (numClusters < 2)
+    {
+        return;
+    }
+
+    // Area weighted centroid and normal of every cluster and of the whole mesh
+    std::vector<Vector3> clusterCentroids(numClusters);
+    std::vector<Vector3> clusterNormals(numClusters);
+    Vector3 meshCentroid;
+    float meshArea = 0.f;
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        float clusterArea = 0.f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            const Vector3 p0 = getPosition(positions, indices[t * 3]);
+            const Vector3 p1 = getPosition(positions, indices[t * 3 + 1]);
+            const Vector3 p2 = getPosition(positions, indices[t * 3 + 2]);
+            const Vector3 e1{ p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+            const Vector3 e2{ p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+            const Vector3 normal{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+            const float area = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+
+            clusterNormals[c].x += normal.x;
+            clusterNormals[c].y += normal.y;
+            clusterNormals[c].z += normal.z;
+            clusterCentroids[c].x += (p0.x + p1.x + p2.x) * area;
+            clusterCentroids[c].y += (p0.y + p1.y + p2.y) * area;
+            clusterCentroids[c].z += (p0.z + p1.z + p2.z) * area;
+            clusterArea += area;
+        }
+
+        meshCentroid.x += clusterCentroids[c].x;
+        meshCentroid.y += clusterCentroids[c].y;
+        meshCentroid.z += clusterCentroids[c].z;
+        meshArea += clusterArea;
+
+        const float scale = clusterArea > 0.f ? 1.f / (3.f * clusterArea) : 0.f;
+        clusterCentroids[c].x *= scale;
+        clusterCentroids[c].y *= scale;
+        clusterCentroids[c].z *= scale;
+    }
+    const float meshScale = meshArea > 0.f ? 1.f / (3.f * meshArea) : 0.f;
+    meshCentroid.x *= meshScale;
+    meshCentroid.y *= meshScale;
+    meshCentroid.z *= meshScale;
+
+    // Clusters far out along their normal are likely in front of the rest,
+    // drawing them first lets the depth test reject what is behind them
+    std::vector<float> sortKeys(numClusters);
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        const Vector3& n = clusterNormals[c];
+        const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+        const Vector3 offset{ clusterCentroids[c].x - meshCentroid.x, clusterCentroids[c].y - meshCentroid.y,
+                              clusterCentroids[c].z - meshCentroid.z };
+        sortKeys[c] = length > 0.f ? (offset.x * n.x + offset.y * n.y + offset.z * n.z) / length : 0.f;
+    }
+
+    std::vector<size_t> order(numClusters);
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const size_t c : order)
+    {
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+
+void
+optimizeVertexFetch(MeshData& mesh)
+{
+    const size_t numVertices = mesh.getVertexCount();
+    const uint32_t unused = UINT32_MAX;
+
+    std::vector<uint32_t> remap(numVertices, unused);
+    uint32_t next = 0;
+    for (const uint32_t index : mesh.indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = next++;
+        }
+    }
+    // Vertices no triangle uses are kept at the end
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        if (remap[v] == unused)
+        {
+            remap[v] = next++;
+        }
+    }
+
+    const auto remapStream = [&remap, numVertices](std::vector<float>& stream, size_t components)
+    {
+        if (stream.empty())
+        {
+            return;
+        }
+        std::vector<float> reordered(stream.size());
+        for (size_t v = 0; v < numVertices; ++v)
+        {
+            std::copy_n(&stream[v * components], components, &reordered[remap[v] * components]);
+        }
+        stream.swap(reordered);
+    };
+    remapStream(mesh.positions, 3);
+    remapStream(mesh.textureCoordinates, 2);
+    remapStream(mesh.normals, 3);
+    remapStream(mesh.tangents, 4);
+
+    for (uint32_t& index : mesh.indices)
+    {
+        index = remap[index];
+    }
+}
+
+
+void
+optimizeMesh(MeshData& mesh, const MeshOptimizeOptions& options, MeshOptimizeStats* stats)
+{
+    if (stats != nullptr)
+    {
+        *stats = MeshOptimizeStats();
+    }
+    if (!mesh.isIndexed())
+    {
+        return;
+    }
+
+    // Levels of detail are drawn on their own, so each is ordered on its own
+    std::vector<MeshLod> ranges = mesh.lods;
+    if (ranges.empty())
+    {
+        ranges.resize(1);
+        ranges[0].indexCount = static_cast<uint32_t>(mesh.indices.size());
+    }
+
+    // The stats are for the full detail level
+    const size_t numVertices = mesh.getVertexCount();
+    const auto getRange = [&mesh](const MeshLod& range)
+    {
+        const auto begin = mesh.indices.begin() + range.indexOffset;
+        return std::vector<uint32_t>(begin, begin + range.indexCount);
+    };
+    if (stats != nullptr)
+    {
+        stats->acmrBefore = computeAcmr(getRange(ranges[0]), numVertices);
+    }
+
+    if (options.vertexCache || options.overdraw)
+    {
+        for (const MeshLod& range : ranges)
+        {
+            std::vector<uint32_t> indices = getRange(range);
+            if (options.vertexCache)
+            {
+                optimizeVertexCache(indices, numVertices);
+            }
+            if (options.overdraw)
+            {
+                optimizeOverdraw(indices, mesh.positions);
+            }
+            std::copy(indices.begin(), indices.end(), mesh.indices.begin() + range.indexOffset);
+        }
+    }
+    // Last, so the vertex order follows the final triangle order of the full detail level
+    if (options.vertexFetch)
+    {
+        optimizeVertexFetch(mesh);
+    }
+
+    if (stats != nullptr)
+    {
+        stats->acmrAfter = computeAcmr(getRange(ranges[0]), numVertices);
+    }
+}
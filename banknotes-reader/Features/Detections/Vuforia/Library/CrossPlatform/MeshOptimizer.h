@@ -0,0 +1,65 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __MESHOPTIMIZER_H__
+#define __MESHOPTIMIZER_H__
+
+#include "MeshLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/// Post-load passes for optimizeMesh, all of them only apply to indexed meshes
+struct MeshOptimizeOptions
+{
+    /// Reorder triangles so that vertices are reused while they are still in
+    /// the post-transform cache (Forsyth's linear-speed algorithm)
+    bool vertexCache{ true };
+    /// Reorder vertices in order of first use by the triangles, so vertex
+    /// fetch walks the streams front to back
+    bool vertexFetch{ true };
+    /// Split the cache-ordered triangles into clusters and draw the clusters
+    /// facing out of the mesh first, so fewer hidden fragments get shaded
+    bool overdraw{ false };
+
+    bool any() const { return vertexCache || vertexFetch || overdraw; }
+};
+
+
+/// Average cache miss ratio before and after optimizeMesh, 0 for a non-indexed mesh
+struct MeshOptimizeStats
+{
+    float acmrBefore{ 0.f };
+    float acmrAfter{ 0.f };
+};
+
+
+/// Size of the FIFO post-transform cache computeAcmr simulates, a
+/// conservative figure for the mobile GPUs the app runs on
+constexpr unsigned int MESH_OPTIMIZE_FIFO_SIZE = 16;
+
+/// Average number of vertices transformed per triangle for a FIFO cache of
+/// cacheSize entries. 3 is the worst case, about 0.5 the best for large meshes.
+float computeAcmr(const std::vector<uint32_t>& indices, size_t numVertices, unsigned int cacheSize = MESH_OPTIMIZE_FIFO_SIZE);
+
+/// Reorder the triangles of indices for post-transform cache reuse
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t numVertices);
+
+/// Reorder cache-optimized triangles so that clusters facing outwards are drawn first
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& positions);
+
+/// Reorder the vertex streams of mesh in order of first use and remap its indices
+void optimizeVertexFetch(MeshData& mesh);
+
+/// Run the passes selected in options on an indexed mesh, a non-indexed mesh is left as it is.
+/// The rendered result does not change, only the order of triangles and vertices.
+/// Triangles stay within their level of detail.
+void optimizeMesh(MeshData& mesh, const MeshOptimizeOptions& options, MeshOptimizeStats* stats = nullptr);
+
+#endif // __MESHOPTIMIZER_H__
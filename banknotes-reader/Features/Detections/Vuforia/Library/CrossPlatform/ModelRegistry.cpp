@@ -0,0 +1,279 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "ModelRegistry.h"
+
+#include "MeshCache.h"
+
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
+
+
+namespace
+{
+
+/// Identifies a resident model by what it was prepared from
+struct ModelKey
+{
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t optionsHash;
+
+    bool operator<(const ModelKey& other) const
+    {
+        if (sourceHash != other.sourceHash)
+        {
+            return sourceHash < other.sourceHash;
+        }
+        if (sourceSize != other.sourceSize)
+        {
+            return sourceSize < other.sourceSize;
+        }
+        return optionsHash < other.optionsHash;
+    }
+};
+
+
+ModelKey
+makeModelKey(const char* data, size_t dataSize, const ModelLoadOptions& options)
+{
+    // Only the options that change the prepared data, hashed from a packed
+    // copy so that padding does not reach the hash
+    uint32_t fields[5 + 2 * VERTEX_ATTRIBUTE_COUNT];
+    size_t numFields = 0;
+    fields[numFields++] = options.indexed ? 1 : 0;
+    fields[numFields++] = (static_cast<uint32_t>(options.layout.numElements) << 1) | (options.layout.interleaved ? 1 : 0);
+    fields[numFields++] = options.layout.strideAlignment;
+    for (int i = 0; i < options.layout.numElements && i < VERTEX_ATTRIBUTE_COUNT; ++i)
+    {
+        fields[numFields++] = static_cast<uint32_t>(options.layout.elements[i].attribute);
+        fields[numFields++] = static_cast<uint32_t>(options.layout.elements[i].format);
+    }
+    fields[numFields++] = getMeshCacheOptimizeFlags(options.optimize) ^ getMeshCacheLodHash(options.lods);
+    fields[numFields++] = getMeshCacheNormalFlags(options.normalSource);
+
+    return ModelKey{ hashMeshCacheBytes(data, dataSize), dataSize, hashMeshCacheBytes(fields, numFields * sizeof(uint32_t)) };
+}
+
+} // namespace
+
+
+ResidentModel::ResidentModel(std::unique_ptr<PreparedModel> prepared)
+{
+    mVertexCount = prepared->getVertexCount();
+    mIndexCount = prepared->getIndexCount();
+    mIndexSize = prepared->getIndexSize();
+    mBounds = prepared->getBounds();
+    mShapeBounds = prepared->getShapeBounds();
+    mShapeNames = prepared->getShapeNames();
+    mLods = prepared->getLods();
+    mLayout = prepared->getLayout();
+    mPositionQuantization = prepared->getPositionQuantization();
+
+    const int numArrays = mLayout.interleaved ? 1 : mLayout.numElements;
+    mResidentBytes = mIndexCount * mIndexSize;
+    for (int i = 0; i < numArrays; ++i)
+    {
+        mResidentBytes += mLayout.getStride(mLayout.elements[i].attribute) * mVertexCount;
+    }
+
+    if (prepared->canUseMappedStreams())
+    {
+        // The cache is already in the layout, keep it mapped instead of copying it
+        mVertices[static_cast<int>(VertexAttribute::Position)] = prepared->getMappedPositions();
+        mVertices[static_cast<int>(VertexAttribute::TextureCoordinate)] = prepared->getMappedTextureCoordinates();
+        mIndices = prepared->getMappedIndices();
+        mMapped = std::move(prepared);
+        return;
+    }
+
+    void* buffers[VERTEX_ATTRIBUTE_COUNT] = { nullptr, nullptr, nullptr };
+    for (int i = 0; i < numArrays; ++i)
+    {
+        const VertexAttribute attribute = mLayout.elements[i].attribute;
+        const int array = mLayout.interleaved ? 0 : static_cast<int>(attribute);
+        mBuffers[array].resize(mLayout.getStride(attribute) * mVertexCount);
+        buffers[array] = mBuffers[array].data();
+    }
+    mIndexBuffer.resize(mIndexCount * mIndexSize);
+    prepared->write(buffers, mIndexCount > 0 ? mIndexBuffer.data() : nullptr);
+
+    for (int i = 0; i < VERTEX_ATTRIBUTE_COUNT; ++i)
+    {
+        mVertices[i] = buffers[i];
+    }
+    mIndices = mIndexCount > 0 ? mIndexBuffer.data() : nullptr;
+}
+
+
+/// Shared with the handles, which release their model through it
+struct ModelRegistry::State
+{
+    struct Entry
+    {
+        /// nullptr while the first acquire prepares it
+        std::unique_ptr<const ResidentModel> model;
+        int references{ 0 };
+        /// Position in idle, only valid while the model is resident and unreferenced
+        std::list<ModelKey>::iterator idlePosition;
+    };
+
+    /// Unreferenced models down to budget bytes, least recently released first.
+    /// A budget of 0 keeps none, even empty ones. Called with the mutex held.
+    void evict(size_t budget)
+    {
+        while ((residentBytes > budget || budget == 0) && !idle.empty())
+        {
+            auto entry = entries.find(idle.front());
+            residentBytes -= entry->second.model->getResidentBytes();
+            entries.erase(entry);
+            idle.pop_front();
+        }
+    }
+
+    ModelHandle makeHandle(const std::shared_ptr<State>& self, const ModelKey& key, const ResidentModel* model)
+    {
+        return ModelHandle(model, [self, key](const ResidentModel*) { self->release(key); });
+    }
+
+    void release(const ModelKey& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = entries.find(key)->second;
+        if (--entry.references == 0)
+        {
+            entry.idlePosition = idle.insert(idle.end(), key);
+            evict(budget);
+        }
+    }
+
+    mutable std::mutex mutex;
+    /// Signalled when a model finishes preparing, successfully or not
+    std::condition_variable prepared;
+    std::map<ModelKey, Entry> entries;
+    std::list<ModelKey> idle;
+    size_t budget{ 0 };
+    size_t residentBytes{ 0 };
+};
+
+
+ModelRegistry::ModelRegistry(size_t memoryBudget) : mState(std::make_shared<State>())
+{
+    mState->budget = memoryBudget;
+}
+
+
+ModelRegistry::~ModelRegistry()
+{
+    // Referenced models are freed with their last handle
+    trim();
+}
+
+
+ModelHandle
+ModelRegistry::acquire(const char* data, size_t dataSize, const ModelLoadOptions& options, std::string& warn,
+                       std::string& err)
+{
+    const ModelKey key = makeModelKey(data, dataSize, options);
+
+    std::unique_lock<std::mutex> lock(mState->mutex);
+    for (;;)
+    {
+        auto found = mState->entries.find(key);
+        if (found == mState->entries.end())
+        {
+            break;
+        }
+
+        State::Entry& entry = found->second;
+        if (entry.model != nullptr)
+        {
+            if (entry.references++ == 0)
+            {
+                mState->idle.erase(entry.idlePosition);
+            }
+            return mState->makeHandle(mState, key, entry.model.get());
+        }
+
+        // Another caller is preparing it, if that fails the entry is gone and this one tries
+        mState->prepared.wait(lock);
+    }
+
+    // Placeholder for concurrent acquires of the same model, prepared without the lock
+    mState->entries[key];
+    lock.unlock();
+
+    std::unique_ptr<const ResidentModel> model;
+    std::unique_ptr<PreparedModel> prepared(new PreparedModel());
+    if (prepared->prepare(data, dataSize, options, warn, err))
+    {
+        model.reset(new ResidentModel(std::move(prepared)));
+    }
+
+    lock.lock();
+    mState->prepared.notify_all();
+    if (model == nullptr)
+    {
+        mState->entries.erase(key);
+        return nullptr;
+    }
+
+    State::Entry& entry = mState->entries[key];
+    entry.references = 1;
+    entry.model = std::move(model);
+    mState->residentBytes += entry.model->getResidentBytes();
+    mState->evict(mState->budget);
+    return mState->makeHandle(mState, key, entry.model.get());
+}
+
+
+void
+ModelRegistry::setMemoryBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    mState->budget = bytes;
+    mState->evict(bytes);
+}
+
+
+size_t
+ModelRegistry::getMemoryBudget() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->budget;
+}
+
+
+size_t
+ModelRegistry::getResidentBytes() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->residentBytes;
+}
+
+
+size_t
+ModelRegistry::getModelCount() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    size_t count = 0;
+    for (const auto& entry : mState->entries)
+    {
+        count += entry.second.model != nullptr ? 1 : 0;
+    }
+    return count;
+}
+
+
+void
+ModelRegistry::trim()
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    mState->evict(0);
+}
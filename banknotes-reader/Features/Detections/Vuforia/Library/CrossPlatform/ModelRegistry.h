@@ -0,0 +1,124 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __MODELREGISTRY_H__
+#define __MODELREGISTRY_H__
+
+#include "MeshBounds.h"
+#include "MeshLod.h"
+#include "PreparedModel.h"
+#include "VertexLayout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/// Model data held in memory in the layout it was prepared with, either the
+/// streams of a mapped cache used in place or buffers written from them.
+class ResidentModel
+{
+public:
+    /// Takes over prepared, which is kept only if its mapped streams are used in place
+    explicit ResidentModel(std::unique_ptr<PreparedModel> prepared);
+
+    ResidentModel(const ResidentModel&) = delete;
+    ResidentModel& operator=(const ResidentModel&) = delete;
+
+    size_t getVertexCount() const { return mVertexCount; }
+    size_t getIndexCount() const { return mIndexCount; }
+    /// Bytes per index, 2 or 4, 0 for a non-indexed model
+    size_t getIndexSize() const { return mIndexSize; }
+    const MeshBounds& getBounds() const { return mBounds; }
+    /// Bounds and names of the OBJ shapes with triangles, in file order
+    const std::vector<MeshBounds>& getShapeBounds() const { return mShapeBounds; }
+    const std::vector<std::string>& getShapeNames() const { return mShapeNames; }
+    const std::vector<MeshLod>& getLods() const { return mLods; }
+    const VertexLayout& getLayout() const { return mLayout; }
+    const PositionQuantization& getPositionQuantization() const { return mPositionQuantization; }
+
+    /// Array holding attribute, indexed like writeVertices. An interleaved
+    /// layout only has the Position array, nullptr if the layout has no such array.
+    const void* getVertices(VertexAttribute attribute) const { return mVertices[static_cast<int>(attribute)]; }
+    /// nullptr for a non-indexed model
+    const void* getIndices() const { return mIndices; }
+
+    /// Bytes of vertex and index data, mapped or not
+    size_t getResidentBytes() const { return mResidentBytes; }
+
+private:
+    size_t mVertexCount{ 0 };
+    size_t mIndexCount{ 0 };
+    size_t mIndexSize{ 0 };
+    MeshBounds mBounds{};
+    std::vector<MeshBounds> mShapeBounds;
+    std::vector<std::string> mShapeNames;
+    std::vector<MeshLod> mLods;
+    VertexLayout mLayout;
+    PositionQuantization mPositionQuantization;
+    const void* mVertices[VERTEX_ATTRIBUTE_COUNT]{};
+    const void* mIndices{ nullptr };
+    size_t mResidentBytes{ 0 };
+
+    /// Owners of the data above, the mapping or the written buffers
+    std::unique_ptr<PreparedModel> mMapped;
+    std::vector<char> mBuffers[VERTEX_ATTRIBUTE_COUNT];
+    std::vector<char> mIndexBuffer;
+};
+
+
+/// Shared reference to a resident model, the registry keeps the model while any copy is alive
+typedef std::shared_ptr<const ResidentModel> ModelHandle;
+
+
+/// Resident models keyed by the content of their OBJ source and the options
+/// they were prepared with, so loading the same model again, for example when
+/// returning to a detection screen, reuses the decoded mesh instead of parsing it.
+///
+/// Models stay resident while handles to them are alive. Unreferenced models
+/// are kept too, and evicted least recently used first whenever the resident
+/// bytes exceed the memory budget. Referenced models are never evicted, so the
+/// budget can be exceeded while they are in use.
+///
+/// All methods are thread safe. Concurrent acquires of the same model prepare
+/// it once, the other callers wait for it. Handles may outlive the registry.
+class ModelRegistry
+{
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+    explicit ModelRegistry(size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+    ~ModelRegistry();
+
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+    /// Handle to the model prepared from OBJ text with options, preparing it
+    /// on a miss. The cache path of options is only used for preparing
+    /// and is not part of the key. Returns nullptr on failure.
+    ModelHandle acquire(const char* data, size_t dataSize, const ModelLoadOptions& options, std::string& warn,
+                        std::string& err);
+
+    /// Evicts unreferenced models until the resident bytes fit the new budget
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+    /// Bytes of all resident models, referenced or not
+    size_t getResidentBytes() const;
+    size_t getModelCount() const;
+
+    /// Evict every unreferenced model
+    void trim();
+
+private:
+    struct State;
+
+    std::shared_ptr<State> mState;
+};
+
+#endif // __MODELREGISTRY_H__
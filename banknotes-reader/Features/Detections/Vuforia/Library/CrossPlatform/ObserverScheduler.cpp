@@ -0,0 +1,153 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "ObserverScheduler.h"
+
+#include <algorithm>
+
+
+ObserverScheduler::ObserverScheduler(size_t numTargets, const ObserverSchedulerOptions& options) :
+    mOptions(options), mTargets(numTargets, Target{ State::Inactive, false, 0 })
+{
+    mOptions.maxActive = std::max<size_t>(mOptions.maxActive, 1);
+    mActive.reserve(mOptions.maxActive);
+    mLeaving.reserve(mOptions.maxActive);
+    mOthers.targets.resize(numTargets);
+    for (size_t i = 0; i < numTargets; ++i)
+    {
+        mOthers.targets[i] = static_cast<uint32_t>(i);
+    }
+}
+
+
+void
+ObserverScheduler::setPreferred(const std::vector<bool>& preferred)
+{
+    mPreferred.targets.clear();
+    mOthers.targets.clear();
+    for (size_t i = 0; i < mTargets.size(); ++i)
+    {
+        mTargets[i].preferred = i < preferred.size() && preferred[i];
+        (mTargets[i].preferred ? mPreferred : mOthers).targets.push_back(static_cast<uint32_t>(i));
+    }
+    mPreferred.next = 0;
+    mOthers.next = 0;
+}
+
+
+void
+ObserverScheduler::update(const uint32_t* detected, size_t numDetected, std::vector<Change>& changes)
+{
+    ++mFrame;
+
+    for (size_t i = 0; i < numDetected; ++i)
+    {
+        if (detected[i] < mTargets.size() && mTargets[detected[i]].state != State::Inactive)
+        {
+            mTargets[detected[i]].state = State::Pinned;
+            mTargets[detected[i]].since = mFrame;
+        }
+    }
+
+    // Targets lost this frame are held, those whose dwell or hold ended may leave
+    mLeaving.clear();
+    size_t numStayingRotating = 0;
+    size_t numStayingOthers = 0;
+    for (size_t i = 0; i < mActive.size();)
+    {
+        Target& target = mTargets[mActive[i]];
+        if (target.state == State::Pinned && target.since != mFrame)
+        {
+            target.state = State::Held;
+        }
+
+        const uint32_t age = mFrame - target.since;
+        if ((target.state == State::Held && age > mOptions.holdFrames) ||
+            (target.state == State::Rotating && age >= mOptions.dwellFrames))
+        {
+            mLeaving.push_back(mActive[i]);
+            mActive[i] = mActive.back();
+            mActive.pop_back();
+            continue;
+        }
+        if (target.state == State::Rotating)
+        {
+            ++numStayingRotating;
+            numStayingOthers += target.preferred ? 0 : 1;
+        }
+        ++i;
+    }
+
+    // Leaving targets are still marked active, so the rotations pass over them
+    // and only replace them with targets that are really inactive
+    const size_t numSlots = mOptions.maxActive - mActive.size();
+    const size_t rotatingCapacity = numStayingRotating + numSlots;
+    size_t numPicked = 0;
+    const size_t numChanges = changes.size();
+    for (; numPicked < numSlots; ++numPicked)
+    {
+        const bool wantOther = mPreferred.targets.empty() ||
+                               (numStayingOthers == 0 && (rotatingCapacity > 1 || !mLastPickedOther));
+        uint32_t target;
+        const bool found = wantOther ? takeNext(mOthers, target) || takeNext(mPreferred, target)
+                                     : takeNext(mPreferred, target) || takeNext(mOthers, target);
+        if (!found)
+        {
+            break;
+        }
+        activate(target, changes);
+        numStayingOthers += mTargets[target].preferred ? 0 : 1;
+        mLastPickedOther = !mTargets[target].preferred;
+    }
+
+    // With too few inactive targets to replace them, leaving targets stay for another dwell
+    // rather than being deactivated and activated again. The rest are deactivated before the
+    // activations above, so no more than maxActive observers are ever active.
+    size_t numKept = std::min(numSlots - numPicked, mLeaving.size());
+    for (size_t i = 0; i < mLeaving.size(); ++i)
+    {
+        Target& target = mTargets[mLeaving[i]];
+        if (i < numKept)
+        {
+            target.state = State::Rotating;
+            target.since = mFrame;
+            mActive.push_back(mLeaving[i]);
+        }
+        else
+        {
+            target.state = State::Inactive;
+            changes.insert(changes.begin() + numChanges + (i - numKept), Change{ mLeaving[i], false });
+        }
+    }
+}
+
+
+bool
+ObserverScheduler::takeNext(Rotation& rotation, uint32_t& target)
+{
+    // At most maxActive targets are active, so this finds one within maxActive + 1 steps
+    for (size_t i = 0; i < rotation.targets.size(); ++i)
+    {
+        target = rotation.targets[rotation.next];
+        rotation.next = rotation.next + 1 < rotation.targets.size() ? rotation.next + 1 : 0;
+        if (mTargets[target].state == State::Inactive)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void
+ObserverScheduler::activate(uint32_t target, std::vector<Change>& changes)
+{
+    mTargets[target].state = State::Rotating;
+    mTargets[target].since = mFrame;
+    mActive.push_back(target);
+    changes.push_back(Change{ target, true });
+}
@@ -0,0 +1,108 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __OBSERVERSCHEDULER_H__
+#define __OBSERVERSCHEDULER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+struct ObserverSchedulerOptions
+{
+    /// Most targets whose observers are active at a time
+    size_t maxActive{ 8 };
+    /// Frames a target rotated in stays active without being detected, long
+    /// enough for the observer to detect a note that is in view
+    uint32_t dwellFrames{ 10 };
+    /// Frames a target stays active after it is lost, so a note that briefly
+    /// leaves the view is found again without waiting for its turn
+    uint32_t holdFrames{ 30 };
+};
+
+
+/// Decides which of a set of targets have their observers active, so a
+/// database of hundreds of targets costs no more per frame than maxActive.
+///
+/// Targets that are detected are pinned until they are lost, then held for
+/// holdFrames. The remaining slots rotate round-robin through the other
+/// targets, each staying dwellFrames. While targets are preferred, such as
+/// those of the selected currency, all rotating slots but one go to them and
+/// the last keeps visiting the rest. The work per frame depends on maxActive
+/// and the targets detected, not on the number of targets.
+class ObserverScheduler
+{
+public:
+    struct Change
+    {
+        uint32_t target;
+        bool activate;
+    };
+
+    ObserverScheduler(size_t numTargets, const ObserverSchedulerOptions& options);
+
+    /// Rotate preferred targets in before the others, the flags are indexed by target.
+    /// An empty vector prefers none.
+    void setPreferred(const std::vector<bool>& preferred);
+
+    /// Advance one frame given the targets detected in it, and append the
+    /// observers to activate or deactivate to changes. Targets that are not
+    /// active cannot have been detected and are ignored. The first update
+    /// activates the first targets.
+    void update(const uint32_t* detected, size_t numDetected, std::vector<Change>& changes);
+
+    bool isActive(uint32_t target) const { return mTargets[target].state != State::Inactive; }
+    size_t getActiveCount() const { return mActive.size(); }
+
+private:
+    enum class State : uint8_t
+    {
+        Inactive,
+        /// Rotated in, active until its dwell ends
+        Rotating,
+        /// Lost after being detected, active until its hold ends
+        Held,
+        /// Detected in the latest frame
+        Pinned,
+    };
+
+    struct Target
+    {
+        State state;
+        bool preferred;
+        /// Frame the target was activated or last detected, whichever is later
+        uint32_t since;
+    };
+
+    /// Targets visited in turn, with where the next visit starts
+    struct Rotation
+    {
+        std::vector<uint32_t> targets;
+        size_t next{ 0 };
+    };
+
+    /// The next inactive target of rotation, or false if all of them are active
+    bool takeNext(Rotation& rotation, uint32_t& target);
+
+    void activate(uint32_t target, std::vector<Change>& changes);
+
+    ObserverSchedulerOptions mOptions;
+    std::vector<Target> mTargets;
+    /// Active targets in no particular order, at most maxActive
+    std::vector<uint32_t> mActive;
+    /// The preferred targets, and the others. Without preferred targets all are in mOthers.
+    Rotation mPreferred;
+    Rotation mOthers;
+    /// Whether the only rotating slot last went to a target that is not preferred
+    bool mLastPickedOther{ false };
+    uint32_t mFrame{ 0 };
+    /// Active targets whose dwell or hold ended this update, reused to not allocate per frame
+    std::vector<uint32_t> mLeaving;
+};
+
+#endif // __OBSERVERSCHEDULER_H__
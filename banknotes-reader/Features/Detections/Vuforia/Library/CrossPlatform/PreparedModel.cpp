@@ -0,0 +1,307 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "PreparedModel.h"
+
+#include <cstring>
+
+
+bool
+PreparedModel::prepare(const char* data, size_t dataSize, const ModelLoadOptions& options, std::string& warn, std::string& err)
+{
+    mMesh = MeshData();
+    mOptimizeStats = MeshOptimizeStats();
+    mCacheFile.reset();
+    mCacheView = MeshCacheView();
+    mLayout = options.layout;
+    if (!mLayout.isValid(err))
+    {
+        return false;
+    }
+    // Tangents are generated from normals, so they need them even if the layout does not
+    const bool tangents = mLayout.contains(VertexAttribute::Tangent);
+    const bool normals = tangents || mLayout.contains(VertexAttribute::Normal);
+    // The passes do nothing to a non-indexed mesh, so its cache never has them
+    const uint32_t processFlags = (options.indexed ? getMeshCacheOptimizeFlags(options.optimize) : 0) |
+                                  (normals ? getMeshCacheNormalFlags(options.normalSource) : 0);
+    const uint32_t lodOptionsHash = options.indexed ? getMeshCacheLodHash(options.lods) : 0;
+
+    // A cache built from exactly these bytes skips parsing altogether
+    uint64_t sourceHash = 0;
+    if (options.cachePath != nullptr)
+    {
+        sourceHash = hashMeshCacheBytes(data, dataSize);
+
+        std::string cacheErr;
+        if (mapCache(options.cachePath, cacheErr))
+        {
+            const MeshCacheHeader& header = *mCacheView.header;
+            // An empty mesh is stored without flags, it is the same either way
+            const bool indexed = (header.flags & MESH_CACHE_FLAG_INDEXED) != 0;
+            const bool hasNormals = (header.flags & MESH_CACHE_FLAG_NORMALS) != 0;
+            const bool hasTangents = (header.flags & MESH_CACHE_FLAG_TANGENTS) != 0;
+            if (header.sourceSize == dataSize && header.sourceHash == sourceHash &&
+                ((indexed == options.indexed && hasNormals == normals && hasTangents == tangents &&
+                  (header.flags & (MESH_CACHE_OPTIMIZE_FLAGS | MESH_CACHE_NORMAL_SOURCE_FLAGS)) == processFlags &&
+                  header.lodOptionsHash == lodOptionsHash) ||
+                 header.numVertices == 0))
+            {
+                return true;
+            }
+
+            warn += std::string("Ignoring stale mesh cache ") + options.cachePath + "\n";
+            mCacheFile.reset();
+            mCacheView = MeshCacheView();
+        }
+        else if (!cacheErr.empty())
+        {
+            warn += std::string("Ignoring mesh cache ") + options.cachePath + ": " + cacheErr + "\n";
+        }
+    }
+
+    // Faces go straight into the mesh as they are parsed, the whole attrib_t
+    // and shape list are never held in memory
+    MeshBuildOptions buildOptions;
+    buildOptions.indexed = options.indexed;
+    buildOptions.normals = normals;
+    buildOptions.normalSource = options.normalSource;
+    buildOptions.tangents = tangents;
+    if (!buildMeshFromObj(data, dataSize, buildOptions, mMesh, err))
+    {
+        return false;
+    }
+
+    // Before optimizing, so every level gets its own cache friendly order
+    if (lodOptionsHash != 0)
+    {
+        generateLodChain(mMesh, options.lods);
+    }
+
+    if (options.optimize.any())
+    {
+        optimizeMesh(mMesh, options.optimize, &mOptimizeStats);
+    }
+
+    if (options.cachePath != nullptr)
+    {
+        // Not fatal, the OBJ is parsed again on the next load
+        std::string cacheErr;
+        if (!writeMeshCache(options.cachePath, mMesh, dataSize, sourceHash, processFlags, lodOptionsHash, cacheErr))
+        {
+            warn += "Failed to write mesh cache: " + cacheErr + "\n";
+        }
+    }
+
+    return true;
+}
+
+
+bool
+PreparedModel::prepareFromCache(const char* cachePath, const VertexLayout& layout, std::string& err)
+{
+    mMesh = MeshData();
+    mOptimizeStats = MeshOptimizeStats();
+    mCacheFile.reset();
+    mCacheView = MeshCacheView();
+    mLayout = layout;
+    if (!mLayout.isValid(err))
+    {
+        return false;
+    }
+
+    if (!mapCache(cachePath, err))
+    {
+        if (err.empty())
+        {
+            err = std::string("Failed to map mesh cache ") + cachePath;
+        }
+        return false;
+    }
+
+    if (mLayout.contains(VertexAttribute::Normal) && mCacheView.normals == nullptr && mCacheView.header->numVertices > 0)
+    {
+        mCacheFile.reset();
+        mCacheView = MeshCacheView();
+        err = std::string("Mesh cache ") + cachePath + " has no normals";
+        return false;
+    }
+    if (mLayout.contains(VertexAttribute::Tangent) && mCacheView.tangents == nullptr && mCacheView.header->numVertices > 0)
+    {
+        mCacheFile.reset();
+        mCacheView = MeshCacheView();
+        err = std::string("Mesh cache ") + cachePath + " has no tangents";
+        return false;
+    }
+    return true;
+}
+
+
+size_t
+PreparedModel::getVertexCount() const
+{
+    return isMapped() ? mCacheView.header->numVertices : mMesh.getVertexCount();
+}
+
+
+size_t
+PreparedModel::getIndexCount() const
+{
+    return isMapped() ? mCacheView.header->numIndices : mMesh.indices.size();
+}
+
+
+size_t
+PreparedModel::getIndexSize() const
+{
+    if (isMapped())
+    {
+        return mCacheView.header->indexSize;
+    }
+    if (!mMesh.isIndexed())
+    {
+        return 0;
+    }
+    // Half the index bandwidth for the common case of small models
+    return mMesh.canUse16BitIndices() ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+
+std::vector<MeshLod>
+PreparedModel::getLods() const
+{
+    if (isMapped())
+    {
+        return std::vector<MeshLod>(mCacheView.lods, mCacheView.lods + mCacheView.header->numLods);
+    }
+    return mMesh.lods;
+}
+
+
+const MeshBounds&
+PreparedModel::getBounds() const
+{
+    return isMapped() ? mCacheView.header->bounds : mMesh.bounds;
+}
+
+
+std::vector<MeshBounds>
+PreparedModel::getShapeBounds() const
+{
+    if (isMapped())
+    {
+        return std::vector<MeshBounds>(mCacheView.shapeBounds, mCacheView.shapeBounds + mCacheView.header->numShapes);
+    }
+    return mMesh.shapeBounds;
+}
+
+
+std::vector<std::string>
+PreparedModel::getShapeNames() const
+{
+    if (!isMapped())
+    {
+        return mMesh.shapeNames;
+    }
+
+    std::vector<std::string> names;
+    names.reserve(mCacheView.header->numShapes);
+    const char* name = mCacheView.shapeNames;
+    for (uint32_t i = 0; i < mCacheView.header->numShapes; ++i)
+    {
+        names.emplace_back(name);
+        name += names.back().size() + 1;
+    }
+    return names;
+}
+
+
+PositionQuantization
+PreparedModel::getPositionQuantization() const
+{
+    const int element = mLayout.findElement(VertexAttribute::Position);
+    if (element < 0 || mLayout.elements[element].format != VertexFormat::Unorm16x4)
+    {
+        return PositionQuantization();
+    }
+
+    const MeshBounds& bounds = getBounds();
+    return ::getPositionQuantization(bounds.min, bounds.max);
+}
+
+
+void
+PreparedModel::write(void* const vertexBuffers[VERTEX_ATTRIBUTE_COUNT], void* indices) const
+{
+    writeVertices(mLayout, getStreams(), getVertexCount(), vertexBuffers);
+
+    const size_t numIndices = getIndexCount();
+    const size_t indexSize = getIndexSize();
+    if (numIndices == 0)
+    {
+        return;
+    }
+
+    if (isMapped())
+    {
+        memcpy(indices, mCacheView.indices, numIndices * indexSize);
+    }
+    else if (indexSize == sizeof(uint16_t))
+    {
+        uint16_t* indices16 = static_cast<uint16_t*>(indices);
+        for (size_t i = 0; i < numIndices; ++i)
+        {
+            indices16[i] = static_cast<uint16_t>(mMesh.indices[i]);
+        }
+    }
+    else
+    {
+        memcpy(indices, mMesh.indices.data(), numIndices * sizeof(uint32_t));
+    }
+}
+
+
+bool
+PreparedModel::mapCache(const char* cachePath, std::string& err)
+{
+    std::unique_ptr<MemoryMappedFile> file(new MemoryMappedFile(cachePath));
+    if (!file->isOpen())
+    {
+        // No cache yet, leave err empty as there is nothing to report
+        return false;
+    }
+
+    if (!readMeshCache(file->data(), file->size(), mCacheView, err))
+    {
+        return false;
+    }
+
+    mCacheFile = std::move(file);
+    return true;
+}
+
+
+VertexStreams
+PreparedModel::getStreams() const
+{
+    VertexStreams streams;
+    if (isMapped())
+    {
+        streams.positions = mCacheView.positions;
+        streams.textureCoordinates = mCacheView.textureCoordinates;
+        streams.normals = mCacheView.normals;
+        streams.tangents = mCacheView.tangents;
+    }
+    else
+    {
+        streams.positions = mMesh.positions.data();
+        streams.textureCoordinates = mMesh.textureCoordinates.data();
+        streams.normals = mMesh.hasNormals() ? mMesh.normals.data() : nullptr;
+        streams.tangents = mMesh.hasTangents() ? mMesh.tangents.data() : nullptr;
+    }
+    streams.positionQuantization = getPositionQuantization();
+    return streams;
+}
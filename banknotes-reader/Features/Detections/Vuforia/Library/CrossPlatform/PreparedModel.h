@@ -0,0 +1,105 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __PREPAREDMODEL_H__
+#define __PREPAREDMODEL_H__
+
+#include "MemoryMappedFile.h"
+#include "MeshBounds.h"
+#include "MeshCache.h"
+#include "MeshLod.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "VertexLayout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/// Options for preparing a model from an OBJ file
+struct ModelLoadOptions
+{
+    /// Share vertices between faces and produce an index buffer
+    bool indexed{ true };
+    /// Layout the vertices are written in, normals and tangents are only loaded if it has them
+    VertexLayout layout{ VertexLayout::planar() };
+    /// Where the normals come from if the layout has normals or tangents
+    MeshNormalSource normalSource{ MeshNormalSource::Obj };
+    /// Binary mesh cache to use instead of parsing the OBJ, or nullptr for none.
+    /// A missing, stale or damaged cache is rebuilt from the OBJ and written here.
+    const char* cachePath{ nullptr };
+    /// Passes run on an indexed mesh after it is built, none by default
+    MeshOptimizeOptions optimize{ false, false, false };
+    /// Levels of detail generated for an indexed mesh, none by default
+    MeshLodOptions lods;
+};
+
+
+/// Model whose final sizes are known but whose data has not been copied to
+/// its destination yet. The streams are either built from an OBJ or mapped
+/// from a mesh cache, in which case they are used in place.
+class PreparedModel
+{
+public:
+    PreparedModel() = default;
+
+    PreparedModel(const PreparedModel&) = delete;
+    PreparedModel& operator=(const PreparedModel&) = delete;
+
+    /// Prepare from OBJ text, the data does not need to outlive the call.
+    /// Problems that do not stop the load, such as a stale cache, are appended to warn.
+    bool prepare(const char* data, size_t dataSize, const ModelLoadOptions& options, std::string& warn, std::string& err);
+
+    /// Prepare from a mesh cache file alone, there is no source to check it against.
+    /// The layout may only ask for normals and tangents if the cache has them.
+    bool prepareFromCache(const char* cachePath, const VertexLayout& layout, std::string& err);
+
+    size_t getVertexCount() const;
+    size_t getIndexCount() const;
+    /// Bytes per index, 2 or 4, 0 for a non-indexed model
+    size_t getIndexSize() const;
+    const MeshBounds& getBounds() const;
+    /// Bounds and names of the OBJ shapes with triangles, in file order
+    std::vector<MeshBounds> getShapeBounds() const;
+    std::vector<std::string> getShapeNames() const;
+    /// Ranges of the indices drawing each level of detail, finest first, empty without a LOD chain
+    std::vector<MeshLod> getLods() const;
+    const VertexLayout& getLayout() const { return mLayout; }
+    /// ACMR before and after the optimizeMesh passes, zero unless they ran in prepare
+    const MeshOptimizeStats& getOptimizeStats() const { return mOptimizeStats; }
+    /// Dequantization of the written positions, the identity unless the layout stores them as Unorm16x4
+    PositionQuantization getPositionQuantization() const;
+
+    /// Write the vertices in the layout to caller memory, vertexBuffers is indexed
+    /// like writeVertices and each buffer needs getLayout().getStride() * getVertexCount() bytes.
+    /// indices needs getIndexCount() * getIndexSize() bytes and may be null for a non-indexed model.
+    void write(void* const vertexBuffers[VERTEX_ATTRIBUTE_COUNT], void* indices) const;
+
+    /// True if the streams below point into a mapped cache file
+    bool isMapped() const { return mCacheFile != nullptr; }
+    /// True if the mapped streams are already in the requested layout and can be used in place
+    bool canUseMappedStreams() const { return isMapped() && mLayout.isPlanarDefault(); }
+    /// Mapped streams, only valid while isMapped() and this object is alive
+    const float* getMappedPositions() const { return mCacheView.positions; }
+    const float* getMappedTextureCoordinates() const { return mCacheView.textureCoordinates; }
+    const void* getMappedIndices() const { return mCacheView.indices; }
+
+private:
+    bool mapCache(const char* cachePath, std::string& err);
+    VertexStreams getStreams() const;
+
+    VertexLayout mLayout;
+    MeshData mMesh;
+    MeshOptimizeStats mOptimizeStats;
+    std::unique_ptr<MemoryMappedFile> mCacheFile;
+    MeshCacheView mCacheView;
+};
+
+#endif // __PREPAREDMODEL_H__
@@ -0,0 +1,78 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __SEQLOCK_H__
+#define __SEQLOCK_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+/// Publishes a small value from one writer thread to any number of reader
+/// threads without locks.
+///
+/// The sequence is odd while a store is in progress. A reader copies the value
+/// between two reads of the sequence and copies it again if a store overlapped,
+/// so the writer never waits and a reader only retries while the writer stores.
+/// The value is held in atomic words, so the copies are not data races.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock copies values bytewise");
+
+public:
+    explicit SeqLock(const T& value = T{}) { store(value); }
+
+    /// Writer: make value the latest. Stores must not run concurrently with each other.
+    void store(const T& value)
+    {
+        uint64_t words[WORD_COUNT] = {};
+        memcpy(words, &value, sizeof(T));
+
+        const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+        mSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORD_COUNT; ++i)
+        {
+            mWords[i].store(words[i], std::memory_order_relaxed);
+        }
+        mSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// Reader: the latest value stored, from any thread
+    T load() const
+    {
+        uint64_t words[WORD_COUNT];
+        uint32_t before;
+        uint32_t after;
+        do
+        {
+            before = mSequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORD_COUNT; ++i)
+            {
+                words[i] = mWords[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = mSequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> mSequence{ 0 };
+    std::atomic<uint64_t> mWords[WORD_COUNT];
+};
+
+#endif // __SEQLOCK_H__
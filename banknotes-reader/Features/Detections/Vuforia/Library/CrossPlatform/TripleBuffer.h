@@ -0,0 +1,80 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __TRIPLEBUFFER_H__
+#define __TRIPLEBUFFER_H__
+
+#include <atomic>
+#include <cstdint>
+
+
+/// Hands values from one writer thread to one reader thread without locks,
+/// the reader always getting the latest value published.
+///
+/// Each side owns one of three slots, the third is the middle slot they
+/// exchange through. The writer fills its back slot and publishes it as the
+/// middle, taking the old middle as its next back slot. The reader swaps its
+/// front slot for the middle when a newer value is there. Neither ever waits
+/// for the other, and a value the reader never took is reused by the writer.
+template <typename T>
+class TripleBuffer
+{
+public:
+    /// Writer: the slot to fill, which still holds whatever value it was last used for
+    T& getBack() { return mSlots[mBack].value; }
+
+    /// Writer: make the back slot the latest value
+    void publish()
+    {
+        const uint8_t middle = mMiddle.exchange(static_cast<uint8_t>(mBack | FRESH), std::memory_order_acq_rel);
+        mBack = middle & INDEX_MASK;
+    }
+
+    /// Reader: move to the latest value if one was published since the last
+    /// call. Returns false, keeping the front slot, if none was.
+    bool update()
+    {
+        if ((mMiddle.load(std::memory_order_relaxed) & FRESH) == 0)
+        {
+            return false;
+        }
+        const uint8_t middle = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+        mFront = middle & INDEX_MASK;
+        return true;
+    }
+
+    /// Reader: the value taken by the last update, unchanged until the next one
+    T& getFront() { return mSlots[mFront].value; }
+
+    /// Call function on every slot, only while neither side uses the buffer
+    template <typename Function>
+    void forEach(const Function& function)
+    {
+        for (Slot& slot : mSlots)
+        {
+            function(slot.value);
+        }
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 3;
+    /// Set in mMiddle while it holds a value the reader has not taken
+    static constexpr uint8_t FRESH = 4;
+
+    /// A cache line each, so the writer filling its slot does not slow the reader
+    struct alignas(64) Slot
+    {
+        T value{};
+    };
+
+    Slot mSlots[3];
+    std::atomic<uint8_t> mMiddle{ 1 };
+    uint8_t mBack{ 0 };
+    uint8_t mFront{ 2 };
+};
+
+#endif // __TRIPLEBUFFER_H__
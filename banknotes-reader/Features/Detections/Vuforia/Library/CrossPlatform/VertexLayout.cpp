@@ -0,0 +1,496 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace
+{
+
+uint32_t
+getSourceComponentCount(VertexAttribute attribute)
+{
+    switch (attribute)
+    {
+        case VertexAttribute::TextureCoordinate:
+            return 2;
+        case VertexAttribute::Tangent:
+            return 4;
+        default:
+            return 3;
+    }
+}
+
+
+uint32_t
+getFormatComponentCount(VertexFormat format)
+{
+    switch (format)
+    {
+        case VertexFormat::Float2:
+        case VertexFormat::Half2:
+        case VertexFormat::Unorm16x2:
+        case VertexFormat::OctSnorm16x2:
+            return 2;
+        case VertexFormat::Float3:
+            return 3;
+        case VertexFormat::Float4:
+        case VertexFormat::Half4:
+        case VertexFormat::Unorm16x4:
+        case VertexFormat::Snorm16x4:
+            return 4;
+    }
+    return 0;
+}
+
+
+bool
+isFloatFormat(VertexFormat format)
+{
+    return format == VertexFormat::Float2 || format == VertexFormat::Float3 || format == VertexFormat::Float4;
+}
+
+
+/// Quantized formats encode one kind of value, the others take any attribute
+bool
+fitsAttribute(VertexFormat format, VertexAttribute attribute)
+{
+    switch (format)
+    {
+        case VertexFormat::Unorm16x4:
+            return attribute == VertexAttribute::Position;
+        case VertexFormat::Unorm16x2:
+            return attribute == VertexAttribute::TextureCoordinate;
+        case VertexFormat::OctSnorm16x2:
+            return attribute == VertexAttribute::Normal;
+        case VertexFormat::Snorm16x4:
+            return attribute == VertexAttribute::Tangent;
+        default:
+            return true;
+    }
+}
+
+
+uint16_t
+floatToUnorm16(float value)
+{
+    return static_cast<uint16_t>(std::lround(std::min(std::max(value, 0.f), 1.f) * 65535.f));
+}
+
+
+int16_t
+floatToSnorm16(float value)
+{
+    return static_cast<int16_t>(std::lround(std::min(std::max(value, -1.f), 1.f) * 32767.f));
+}
+
+
+/// Octahedral normal encoding: project onto |x| + |y| + |z| = 1 and fold the
+/// lower half over the diagonals, which spreads the precision evenly
+void
+encodeOctNormal(const float normal[3], int16_t encoded[2])
+{
+    const float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+    if (length == 0.f)
+    {
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+
+    float x = normal[0] / length;
+    float y = normal[1] / length;
+    if (normal[2] < 0.f)
+    {
+        const float foldedX = (1.f - std::fabs(y)) * (x >= 0.f ? 1.f : -1.f);
+        const float foldedY = (1.f - std::fabs(x)) * (y >= 0.f ? 1.f : -1.f);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = floatToSnorm16(x);
+    encoded[1] = floatToSnorm16(y);
+}
+
+
+const float*
+getSourceStream(const VertexStreams& streams, VertexAttribute attribute)
+{
+    switch (attribute)
+    {
+        case VertexAttribute::Position:
+            return streams.positions;
+        case VertexAttribute::TextureCoordinate:
+            return streams.textureCoordinates;
+        case VertexAttribute::Normal:
+            return streams.normals;
+        case VertexAttribute::Tangent:
+            return streams.tangents;
+    }
+    return nullptr;
+}
+
+
+uint32_t
+alignStride(uint32_t stride, uint32_t alignment)
+{
+    return (stride + alignment - 1) / alignment * alignment;
+}
+
+
+/// Write one element of every vertex, converting and padding the components
+void
+writeElement(const VertexElement& element, const float* source, const PositionQuantization& quantization, size_t numVertices,
+             char* destination, uint32_t stride)
+{
+    const uint32_t sourceComponents = getSourceComponentCount(element.attribute);
+    const uint32_t components = getFormatComponentCount(element.format);
+    // Positions are points, a fourth component makes them homogeneous
+    const float w = element.attribute == VertexAttribute::Position ? 1.f : 0.f;
+
+    // Multiplying by the inverse scale keeps the division out of the loop
+    float inverseScale[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        inverseScale[c] = quantization.scale[c] != 0.f ? 1.f / quantization.scale[c] : 0.f;
+    }
+
+    for (size_t v = 0; v < numVertices; ++v)
+    {
+        // All source components are read, an oct normal needs xyz for its two
+        float values[4];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            if (source != nullptr && c < sourceComponents)
+            {
+                values[c] = source[v * sourceComponents + c];
+            }
+            else
+            {
+                values[c] = c == 3 ? w : 0.f;
+            }
+        }
+
+        char* out = destination + v * stride;
+        switch (element.format)
+        {
+            case VertexFormat::Half2:
+            case VertexFormat::Half4:
+            {
+                uint16_t halves[4];
+                for (uint32_t c = 0; c < components; ++c)
+                {
+                    halves[c] = floatToHalf(values[c]);
+                }
+                memcpy(out, halves, components * sizeof(uint16_t));
+                break;
+            }
+            case VertexFormat::Unorm16x4:
+            {
+                uint16_t normalized[4] = { 0, 0, 0, 0 };
+                for (int c = 0; c < 3; ++c)
+                {
+                    normalized[c] = floatToUnorm16((values[c] - quantization.offset[c]) * inverseScale[c]);
+                }
+                memcpy(out, normalized, sizeof(normalized));
+                break;
+            }
+            case VertexFormat::Unorm16x2:
+            {
+                const uint16_t normalized[2] = { floatToUnorm16(values[0]), floatToUnorm16(values[1]) };
+                memcpy(out, normalized, sizeof(normalized));
+                break;
+            }
+            case VertexFormat::OctSnorm16x2:
+            {
+                int16_t encoded[2];
+                encodeOctNormal(values, encoded);
+                memcpy(out, encoded, sizeof(encoded));
+                break;
+            }
+            case VertexFormat::Snorm16x4:
+            {
+                const int16_t normalized[4] = { floatToSnorm16(values[0]), floatToSnorm16(values[1]),
+                                                floatToSnorm16(values[2]), floatToSnorm16(values[3]) };
+                memcpy(out, normalized, sizeof(normalized));
+                break;
+            }
+            default:
+                memcpy(out, values, components * sizeof(float));
+                break;
+        }
+    }
+}
+
+} // namespace
+
+
+VertexLayout
+VertexLayout::planar()
+{
+    VertexLayout layout;
+    layout.elements[0] = { VertexAttribute::Position, VertexFormat::Float3 };
+    layout.elements[1] = { VertexAttribute::TextureCoordinate, VertexFormat::Float2 };
+    layout.numElements = 2;
+    return layout;
+}
+
+
+VertexLayout
+VertexLayout::interleavedPositionTextureNormal(bool normals)
+{
+    VertexLayout layout = planar();
+    layout.interleaved = true;
+    if (normals)
+    {
+        layout.elements[2] = { VertexAttribute::Normal, VertexFormat::Float3 };
+        layout.numElements = 3;
+    }
+    return layout;
+}
+
+
+VertexLayout
+VertexLayout::planarQuantized(bool normals)
+{
+    VertexLayout layout;
+    layout.elements[0] = { VertexAttribute::Position, VertexFormat::Unorm16x4 };
+    layout.elements[1] = { VertexAttribute::TextureCoordinate, VertexFormat::Unorm16x2 };
+    layout.numElements = 2;
+    if (normals)
+    {
+        layout.elements[2] = { VertexAttribute::Normal, VertexFormat::OctSnorm16x2 };
+        layout.numElements = 3;
+    }
+    return layout;
+}
+
+
+int
+VertexLayout::findElement(VertexAttribute attribute) const
+{
+    for (int i = 0; i < numElements; ++i)
+    {
+        if (elements[i].attribute == attribute)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+uint32_t
+VertexLayout::getStride(VertexAttribute attribute) const
+{
+    const int element = findElement(attribute);
+    if (element < 0)
+    {
+        return 0;
+    }
+
+    if (!interleaved)
+    {
+        return alignStride(getVertexFormatSize(elements[element].format), strideAlignment);
+    }
+
+    uint32_t stride = 0;
+    for (int i = 0; i < numElements; ++i)
+    {
+        stride += getVertexFormatSize(elements[i].format);
+    }
+    return alignStride(stride, strideAlignment);
+}
+
+
+uint32_t
+VertexLayout::getOffset(VertexAttribute attribute) const
+{
+    const int element = findElement(attribute);
+    if (element < 0 || !interleaved)
+    {
+        return 0;
+    }
+
+    // Every format is a multiple of 4 bytes, so offsets meet the Metal
+    // requirement for attribute alignment without extra padding
+    uint32_t offset = 0;
+    for (int i = 0; i < element; ++i)
+    {
+        offset += getVertexFormatSize(elements[i].format);
+    }
+    return offset;
+}
+
+
+bool
+VertexLayout::isValid(std::string& err) const
+{
+    if (numElements < 1 || numElements > VERTEX_ATTRIBUTE_COUNT)
+    {
+        err = "A vertex layout needs between 1 and " + std::to_string(VERTEX_ATTRIBUTE_COUNT) + " elements";
+        return false;
+    }
+    if (strideAlignment == 0 || (strideAlignment & (strideAlignment - 1)) != 0)
+    {
+        err = "Vertex stride alignment must be a power of two";
+        return false;
+    }
+
+    for (int i = 0; i < numElements; ++i)
+    {
+        if (static_cast<int>(elements[i].attribute) < 0 ||
+            static_cast<int>(elements[i].attribute) >= VERTEX_ATTRIBUTE_COUNT ||
+            getVertexFormatSize(elements[i].format) == 0)
+        {
+            err = "Vertex layout element " + std::to_string(i) + " has an unknown attribute or format";
+            return false;
+        }
+        if (!fitsAttribute(elements[i].format, elements[i].attribute))
+        {
+            err = "Vertex layout element " + std::to_string(i) + " has a quantized format for another attribute";
+            return false;
+        }
+        if (findElement(elements[i].attribute) != i)
+        {
+            err = "Vertex layout element " + std::to_string(i) + " repeats an attribute";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool
+VertexLayout::isPlanarDefault() const
+{
+    const VertexLayout reference = planar();
+    if (interleaved || numElements != reference.numElements ||
+        alignStride(getVertexFormatSize(VertexFormat::Float2), strideAlignment) != getVertexFormatSize(VertexFormat::Float2) ||
+        alignStride(getVertexFormatSize(VertexFormat::Float3), strideAlignment) != getVertexFormatSize(VertexFormat::Float3))
+    {
+        return false;
+    }
+
+    // Element order does not matter when every element has its own buffer
+    for (int i = 0; i < reference.numElements; ++i)
+    {
+        const int element = findElement(reference.elements[i].attribute);
+        if (element < 0 || elements[element].format != reference.elements[i].format)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+uint32_t
+getVertexFormatSize(VertexFormat format)
+{
+    return getFormatComponentCount(format) * (isFloatFormat(format) ? sizeof(float) : sizeof(uint16_t));
+}
+
+
+uint16_t
+floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    bits &= 0x7FFFFFFF;
+
+    // 65520 and above round to infinity, NaN stays a quiet NaN
+    if (bits >= 0x477FF000)
+    {
+        return sign | (bits > 0x7F800000 ? 0x7E00 : 0x7C00);
+    }
+
+    // Below the smallest normal half, adding 0.5 lines the subnormal half
+    // mantissa up with the low float mantissa bits and lets the FPU round
+    if (bits < 0x38800000)
+    {
+        float magnitude;
+        memcpy(&magnitude, &bits, sizeof(magnitude));
+        magnitude += 0.5f;
+        memcpy(&bits, &magnitude, sizeof(bits));
+        return sign | static_cast<uint16_t>(bits - 0x3F000000);
+    }
+
+    // Rebias the exponent and round the 13 dropped mantissa bits to nearest even
+    const uint32_t odd = (bits >> 13) & 1;
+    bits += 0xC8000FFF + odd;
+    return sign | static_cast<uint16_t>(bits >> 13);
+}
+
+
+PositionQuantization
+getPositionQuantization(const float boundsMin[3], const float boundsMax[3])
+{
+    PositionQuantization quantization;
+    for (int c = 0; c < 3; ++c)
+    {
+        quantization.offset[c] = boundsMin[c];
+        quantization.scale[c] = std::max(boundsMax[c] - boundsMin[c], 0.f);
+    }
+    return quantization;
+}
+
+
+void
+writeVertices(const VertexLayout& layout, const VertexStreams& streams, size_t numVertices,
+              void* const buffers[VERTEX_ATTRIBUTE_COUNT])
+{
+    if (numVertices == 0)
+    {
+        return;
+    }
+
+    for (int i = 0; i < layout.numElements; ++i)
+    {
+        const VertexElement& element = layout.elements[i];
+        const uint32_t stride = layout.getStride(element.attribute);
+        const uint32_t size = getVertexFormatSize(element.format);
+        const float* source = getSourceStream(streams, element.attribute);
+        char* destination =
+            static_cast<char*>(buffers[layout.interleaved ? 0 : static_cast<int>(element.attribute)]) +
+            layout.getOffset(element.attribute);
+
+        // A packed stream in the source format is a straight copy
+        if (!layout.interleaved && source != nullptr && isFloatFormat(element.format) && stride == size &&
+            getFormatComponentCount(element.format) == getSourceComponentCount(element.attribute))
+        {
+            memcpy(destination, source, numVertices * size);
+            continue;
+        }
+
+        writeElement(element, source, streams.positionQuantization, numVertices, destination, stride);
+    }
+
+    // Zero the padding so the buffers have no uninitialized bytes
+    for (int i = 0; i < (layout.interleaved ? 1 : layout.numElements); ++i)
+    {
+        const VertexElement& element = layout.elements[i];
+        const uint32_t stride = layout.getStride(element.attribute);
+        const uint32_t used = layout.interleaved ? layout.getOffset(layout.elements[layout.numElements - 1].attribute) +
+                                                       getVertexFormatSize(layout.elements[layout.numElements - 1].format)
+                                                 : getVertexFormatSize(element.format);
+        if (used == stride)
+        {
+            continue;
+        }
+
+        char* destination = static_cast<char*>(buffers[layout.interleaved ? 0 : static_cast<int>(element.attribute)]);
+        for (size_t v = 0; v < numVertices; ++v)
+        {
+            memset(destination + v * stride + used, 0, stride - used);
+        }
+    }
+}
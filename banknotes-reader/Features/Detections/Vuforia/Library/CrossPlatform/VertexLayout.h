@@ -0,0 +1,135 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __VERTEXLAYOUT_H__
+#define __VERTEXLAYOUT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/// Per vertex data a mesh can provide
+enum class VertexAttribute
+{
+    Position,
+    TextureCoordinate,
+    Normal,
+    /// xyz tangent and the handedness in w, see MeshData::tangents
+    Tangent,
+};
+
+constexpr int VERTEX_ATTRIBUTE_COUNT = 4;
+
+
+/// Storage format of one attribute. Components the mesh does not have are
+/// written as 0, except the w of a position which is 1.
+///
+/// The 16-bit integer formats quantize an attribute and only fit the one
+/// noted, they are read by the GPU as normalized values.
+enum class VertexFormat
+{
+    Float2,
+    Float3,
+    Float4,
+    Half2,
+    Half4,
+    /// Position relative to the bounds of the mesh, see PositionQuantization. w is 0.
+    Unorm16x4,
+    /// Texture coordinate clamped to [0, 1], so not for coordinates that repeat a texture
+    Unorm16x2,
+    /// Normal folded onto an octahedron, decode with octDecode in the shader
+    OctSnorm16x2,
+    /// Tangent with its handedness in w, the components are in [-1, 1] already
+    Snorm16x4,
+};
+
+
+struct VertexElement
+{
+    VertexAttribute attribute{ VertexAttribute::Position };
+    VertexFormat format{ VertexFormat::Float3 };
+};
+
+
+/// Describes how vertices are written to memory.
+///
+/// Planar layouts give every element its own buffer, interleaved layouts
+/// write all elements of a vertex next to each other in element order.
+/// Interleaving keeps the data of a vertex in one cache line, which suits
+/// the vertex fetch of mobile GPUs better.
+struct VertexLayout
+{
+    VertexElement elements[VERTEX_ATTRIBUTE_COUNT];
+    int numElements{ 0 };
+    bool interleaved{ false };
+    /// Strides are rounded up to a multiple of this, 1 for tightly packed
+    /// vertices or 16 to start every vertex on a 16-byte boundary
+    uint32_t strideAlignment{ 1 };
+
+    /// Float3 positions and Float2 texture coordinates in separate buffers
+    static VertexLayout planar();
+    /// Float3 positions, Float2 texture coordinates and optionally Float3 normals in one buffer
+    static VertexLayout interleavedPositionTextureNormal(bool normals);
+    /// Unorm16x4 positions, Unorm16x2 texture coordinates and optionally OctSnorm16x2 normals
+    /// in separate buffers, a third of the size of the float layouts
+    static VertexLayout planarQuantized(bool normals);
+
+    bool contains(VertexAttribute attribute) const { return findElement(attribute) >= 0; }
+    /// Index into elements, -1 if the attribute is not in the layout
+    int findElement(VertexAttribute attribute) const;
+
+    /// Bytes between consecutive vertices in the buffer holding attribute, 0 if it is not in the layout
+    uint32_t getStride(VertexAttribute attribute) const;
+    /// Byte offset of attribute within a vertex of its buffer, 0 if it is not in the layout
+    uint32_t getOffset(VertexAttribute attribute) const;
+
+    /// Check for unknown values, repeated attributes, quantized formats on an attribute
+    /// they do not fit and a stride alignment that is not a power of two
+    bool isValid(std::string& err) const;
+    /// True for the planar() layout, which is also the layout of a mesh cache
+    bool isPlanarDefault() const;
+};
+
+
+uint32_t getVertexFormatSize(VertexFormat format);
+
+/// IEEE half precision with round to nearest even, out of range values become infinity
+uint16_t floatToHalf(float value);
+
+
+/// Maps Unorm16x4 positions back to model space: position = offset + scale * normalized.
+/// The identity for meshes that are not quantized.
+struct PositionQuantization
+{
+    float scale[3]{ 1.f, 1.f, 1.f };
+    float offset[3]{ 0.f, 0.f, 0.f };
+};
+
+/// Quantization spanning the bounds, a flat axis gets a scale of 0
+PositionQuantization getPositionQuantization(const float boundsMin[3], const float boundsMax[3]);
+
+
+/// Source streams for writeVertices, xyz, uv or for tangents xyzw per vertex.
+/// normals and tangents may be null, their attribute is then written as zero.
+struct VertexStreams
+{
+    const float* positions{ nullptr };
+    const float* textureCoordinates{ nullptr };
+    const float* normals{ nullptr };
+    const float* tangents{ nullptr };
+    /// Box that Unorm16x4 positions are relative to
+    PositionQuantization positionQuantization;
+};
+
+/// Write numVertices vertices in the given layout. buffers is indexed by
+/// VertexAttribute, an interleaved layout writes everything to buffers[0].
+/// Each buffer needs getStride() * numVertices bytes.
+void writeVertices(const VertexLayout& layout, const VertexStreams& streams, size_t numVertices,
+                   void* const buffers[VERTEX_ATTRIBUTE_COUNT]);
+
+#endif // __VERTEXLAYOUT_H__
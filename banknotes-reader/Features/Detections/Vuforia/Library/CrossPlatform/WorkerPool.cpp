@@ -0,0 +1,133 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+
+WorkerPool::WorkerPool(unsigned int numThreads)
+{
+    if (numThreads == 0)
+    {
+        // Leave a core for the render and camera threads
+        const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    mThreads.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        mThreads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+
+WorkerPool::~WorkerPool()
+{
+    std::map<QueueKey, Task> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        cancelled.swap(mQueue);
+        for (auto& running : mRunning)
+        {
+            running.second = true;
+        }
+    }
+    mWakeUp.notify_all();
+
+    for (auto& entry : cancelled)
+    {
+        entry.second.finish(true);
+    }
+    for (std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+
+uint64_t
+WorkerPool::submit(int priority, std::function<void()> run, std::function<void(bool cancelled)> finish)
+{
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        id = mNextId++;
+        mQueue[QueueKey{ priority, id }] = Task{ std::move(run), std::move(finish) };
+    }
+    mWakeUp.notify_one();
+    return id;
+}
+
+
+bool
+WorkerPool::cancel(uint64_t id)
+{
+    Task task;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto running = mRunning.find(id);
+        if (running != mRunning.end())
+        {
+            // The worker discards the result when run returns
+            const bool wasCancelled = running->second;
+            running->second = true;
+            return !wasCancelled;
+        }
+
+        auto queued = std::find_if(mQueue.begin(), mQueue.end(),
+                                   [id](const std::pair<const QueueKey, Task>& entry) { return entry.first.id == id; });
+        if (queued == mQueue.end())
+        {
+            return false;
+        }
+        task = std::move(queued->second);
+        mQueue.erase(queued);
+    }
+
+    task.finish(true);
+    return true;
+}
+
+
+void
+WorkerPool::workerLoop()
+{
+    for (;;)
+    {
+        uint64_t id;
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeUp.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+            if (mQueue.empty())
+            {
+                return;
+            }
+
+            auto next = mQueue.begin();
+            id = next->first.id;
+            task = std::move(next->second);
+            mQueue.erase(next);
+            mRunning[id] = false;
+        }
+
+        task.run();
+
+        bool cancelled;
+        {
+            // Once the task leaves mRunning cancel reports it as finished
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto running = mRunning.find(id);
+            cancelled = running->second;
+            mRunning.erase(running);
+        }
+        task.finish(cancelled);
+    }
+}
@@ -0,0 +1,78 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __WORKERPOOL_H__
+#define __WORKERPOOL_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/// Fixed set of threads running background tasks, higher priorities first
+/// and tasks of equal priority in submission order.
+///
+/// A task is split in run, which does the work, and finish, which hands the
+/// result over. finish(false) follows run unless the task was cancelled, a
+/// cancelled task gets finish(true) instead so it can free its result.
+/// Tasks run on the worker threads, only a task cancelled while still queued
+/// gets its finish(true) on the thread that cancels it.
+class WorkerPool
+{
+public:
+    /// 0 threads picks one less than the hardware threads, at least one
+    explicit WorkerPool(unsigned int numThreads = 0);
+    /// Cancels every task and waits for the running ones to return from run
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /// Returns the id of the task, never 0
+    uint64_t submit(int priority, std::function<void()> run, std::function<void(bool cancelled)> finish);
+
+    /// Cancel a queued or running task. A running task still completes its
+    /// run, but its result is discarded. Returns false if the task already
+    /// finished or is finishing, finish(false) is then called or has been.
+    bool cancel(uint64_t id);
+
+private:
+    struct Task
+    {
+        std::function<void()> run;
+        std::function<void(bool)> finish;
+    };
+
+    /// Orders the queue by priority, then by id
+    struct QueueKey
+    {
+        int priority;
+        uint64_t id;
+
+        bool operator<(const QueueKey& other) const
+        {
+            return priority != other.priority ? priority > other.priority : id < other.id;
+        }
+    };
+
+    void workerLoop();
+
+    std::mutex mMutex;
+    std::condition_variable mWakeUp;
+    std::map<QueueKey, Task> mQueue;
+    /// Ids of running tasks, true once cancelled
+    std::map<uint64_t, bool> mRunning;
+    uint64_t mNextId{ 1 };
+    bool mStopping{ false };
+    std::vector<std::thread> mThreads;
+};
+
+#endif // __WORKERPOOL_H__
@@ -53,7 +53,10 @@ THE SOFTWARE.
 #ifndef TINY_OBJ_LOADER_H_
 #define TINY_OBJ_LOADER_H_
 
+#include <cstddef>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -303,6 +306,9 @@ typedef struct callback_t_
     // There may be multiple group names
     void (*group_cb)(void* user_data, const char** names, int num_names);
     void (*object_cb)(void* user_data, const char* name);
+    // called per 's' line with the smoothing group of the faces that follow,
+    // 0 if smoothing is off.
+    void (*smoothing_group_cb)(void* user_data, unsigned int smoothing_group_id);
 
     callback_t_() :
         vertex_cb(NULL),
@@ -312,11 +318,22 @@ typedef struct callback_t_
         usemtl_cb(NULL),
         mtllib_cb(NULL),
         group_cb(NULL),
-        object_cb(NULL)
+        object_cb(NULL),
+        smoothing_group_cb(NULL)
     {
     }
 } callback_t;
 
+// Element counts of an .obj buffer, used to size containers before parsing.
+typedef struct
+{
+    size_t num_vertices;     // 'v'
+    size_t num_normals;      // 'vn'
+    size_t num_texcoords;    // 'vt'
+    size_t num_faces;        // 'f'
+    size_t num_face_corners; // indices over all 'f' lines
+} obj_counts_t;
+
 class MaterialReader
 {
 public:
@@ -351,6 +368,52 @@ private:
     std::istream& m_inStream;
 };
 
+// A parsed .mtl file. Immutable once parsed, so loads on any thread can
+// share it.
+typedef struct
+{
+    std::vector<material_t> materials;
+    std::map<std::string, int> material_map; // name -> index into materials
+    std::string warn;
+} material_library_t;
+
+// Resolves mtllib names against .mtl files held in memory, e.g. from the app
+// bundle. Each library is parsed on first use only, later loads naming it
+// copy the parsed materials instead of parsing the text again. One reader
+// can serve many loads at once on different threads.
+class MaterialCacheReader : public MaterialReader
+{
+public:
+    MaterialCacheReader() { }
+    virtual ~MaterialCacheReader() { }
+
+    // Registers the text of a library under the name mtllib refers to it by.
+    // The text is copied. Replacing a library does not affect loads that
+    // already resolved it.
+    void AddLibrary(const std::string& name, const char* buf, size_t buf_len);
+
+    // Returns the parsed library, parsing it if this is its first use.
+    // Returns NULL if no library has the name.
+    std::shared_ptr<const material_library_t> GetLibrary(const std::string& name);
+
+    virtual bool operator()(const std::string& matId, std::vector<material_t>* materials, std::map<std::string, int>* matMap,
+                            std::string* warn, std::string* err);
+
+private:
+    struct entry_t
+    {
+        std::string source;
+        std::once_flag parsed_flag;
+        std::shared_ptr<const material_library_t> parsed;
+    };
+
+    MaterialCacheReader(const MaterialCacheReader&);
+    MaterialCacheReader& operator=(const MaterialCacheReader&);
+
+    std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<entry_t> > m_libraries;
+};
+
 /// Loads .obj from a file.
 /// 'attrib', 'shapes' and 'materials' will be filled with parsed shape data
 /// 'shapes' will be filled with parsed shape data
@@ -369,12 +432,19 @@ bool LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<materia
 /// Loads .obj from a file with custom user callback.
 /// .mtl is loaded as usual and parsed material_t data will be passed to
 /// `callback.mtllib_cb`.
-/// Returns true when loading .obj/.mtl become success.
+/// Returns true when loading .obj/.mtl become success. Like LoadObj, a face
+/// with a zero index fails the load, the callbacks made before it stand.
 /// Returns warning message into `warn`, and error message into `err`
 /// See `examples/callback_api/` for how to use this function.
 bool LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* user_data = NULL, MaterialReader* readMatFn = NULL,
                          std::string* warn = NULL, std::string* err = NULL);
 
+/// Same as LoadObjWithCallback, but parses lines in place from a memory
+/// buffer such as a memory-mapped .obj file. `buf` does not need to be
+/// NUL-terminated.
+bool LoadObjWithCallbackFromBuffer(const char* buf, size_t buf_len, const callback_t& callback, void* user_data = NULL,
+                                   MaterialReader* readMatFn = NULL, std::string* warn = NULL, std::string* err = NULL);
+
 /// Loads object from a std::istream, uses GetMtlIStreamFn to retrieve
 /// std::istream for materials.
 /// Returns true when loading .obj become success.
@@ -382,6 +452,37 @@ bool LoadObjWithCallback(std::istream& inStream, const callback_t& callback, voi
 bool LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn, std::string* err,
              std::istream* inStream, MaterialReader* readMatFn = NULL, bool triangulate = true, bool default_vcols_fallback = true);
 
+/// Loads object from a memory buffer, e.g. a memory-mapped .obj file.
+/// Lines are parsed in place, without an intermediate std::istream or a
+/// per-line std::string copy. `buf` does not need to be NUL-terminated.
+/// Returns true when loading .obj become success.
+/// Returns warning and error message into `err`
+bool LoadObjFromBuffer(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn,
+                       std::string* err, const char* buf, size_t buf_len, MaterialReader* readMatFn = NULL, bool triangulate = true,
+                       bool default_vcols_fallback = true);
+
+/// Same as LoadObjFromBuffer, but splits the buffer at line boundaries and
+/// parses the chunks on `num_threads` threads (0 = one per hardware thread).
+/// Group, material and tag commands are replayed in file order afterwards, so
+/// the result is identical to LoadObjFromBuffer. Each chunk is at least
+/// `min_chunk_size` bytes, below which starting a thread costs more than it
+/// saves, so small buffers are parsed on the calling thread.
+bool LoadObjFromBufferParallel(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn,
+                               std::string* err, const char* buf, size_t buf_len, MaterialReader* readMatFn = NULL,
+                               bool triangulate = true, bool default_vcols_fallback = true, unsigned int num_threads = 0,
+                               size_t min_chunk_size = 256 * 1024);
+
+/// Counts the vertex data and faces of an .obj buffer in one quick pass,
+/// without parsing any numbers.
+void CountObjElements(const char* buf, size_t buf_len, obj_counts_t* counts);
+
+/// Triangulates one polygon face the same way LoadObj does when `triangulate`
+/// is set. `face` holds zero based indices into the `num_values` values of
+/// `vertices`, which are laid out like attrib_t::vertices. Three indices per
+/// triangle are appended to `triangles`. Returns the number of triangles.
+size_t TriangulateFace(const index_t* face, size_t num_indices, const real_t* vertices, size_t num_values,
+                       std::vector<index_t>* triangles);
+
 /// Loads materials into std::map
 void LoadMtl(std::map<std::string, int>* material_map, std::vector<material_t>* materials, std::istream* inStream, std::string* warning,
              std::string* err);
@@ -400,18 +501,29 @@ bool ParseTextureNameAndOption(std::string* texname, texture_option_t* texopt, c
 #endif // TINY_OBJ_LOADER_H_
 
 #ifdef TINYOBJLOADER_IMPLEMENTATION
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <thread>
 #include <utility>
 
 #include <fstream>
 #include <sstream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TINYOBJ_SCAN_SSE2
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define TINYOBJ_SCAN_NEON
+#endif
+
 namespace tinyobj
 {
 
@@ -436,6 +548,8 @@ struct face_t
     face_t() : smoothing_group_id(0), pad_(0) { }
 };
 
+typedef std::vector<face_t> face_group_t;
+
 struct line_t
 {
     int idx0;
@@ -457,48 +571,209 @@ struct obj_shape
     std::vector<real_t> vt;
 };
 
-// See
-// http://stackoverflow.com/questions/6089231/getting-std-ifstream-to-handle-lf-cr-and-crlf
-static std::istream&
-safeGetline(std::istream& is, std::string& t)
+static inline int
+trailingZeroes(uint64_t w)
 {
-    t.clear();
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(w);
+#else
+    int n = 0;
+    while (!(w & 1))
+    {
+        w >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
 
-    // The characters in the stream are read one-by-one using a std::streambuf.
-    // That is faster than reading them one-by-one using the std::istream.
-    // Code that uses streambuf this way must be guarded by a sentry object.
-    // The sentry object performs various tasks,
-    // such as thread synchronization and updating the stream state.
+// Returns the first '\r' or '\n' in [p, end), or end if there is none.
+// Compares 16 bytes at a time where SSE2 or NEON is available, OBJ lines
+// are mostly 20 to 40 bytes so most of them are found in two or three steps.
+static inline const char*
+findLineEnd(const char* p, const char* end)
+{
+#if defined(TINYOBJ_SCAN_SSE2)
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    while (end - p >= 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, lf), _mm_cmpeq_epi8(bytes, cr)));
+        if (mask != 0)
+        {
+            return p + trailingZeroes(static_cast<uint64_t>(mask));
+        }
+        p += 16;
+    }
+#elif defined(TINYOBJ_SCAN_NEON)
+    const uint8x16_t lf = vdupq_n_u8('\n');
+    const uint8x16_t cr = vdupq_n_u8('\r');
+    while (end - p >= 16)
+    {
+        const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        const uint8x16_t matches = vorrq_u8(vceqq_u8(bytes, lf), vceqq_u8(bytes, cr));
+        // Narrow every byte to 4 bits, NEON has no movemask
+        const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+        if (mask != 0)
+        {
+            return p + (trailingZeroes(mask) >> 2);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && (*p) != '\n' && (*p) != '\r')
+    {
+        p++;
+    }
+    return p;
+}
 
-    std::istream::sentry se(is, true);
-    std::streambuf* sb = is.rdbuf();
+// Reads lines from a std::istream in blocks, without going through the
+// stream a character at a time. Lines are split in the block the same way
+// BufferLineReader splits them and returned in place, followed by their
+// '\r', '\n' or '\0' terminator. A line longer than the block grows it.
+// Like the getline loop it replaces, it sets failbit and eofbit on the stream
+// at its end and reads nothing from a stream that has either set already.
+class StreamLineReader
+{
+public:
+    explicit StreamLineReader(std::istream& inStream) :
+        m_inStream(inStream), m_begin(0), m_end(0), m_scanned(0), m_eof(!inStream.good())
+    {
+    }
 
-    if (se)
+    // Returns the next line without its line ending. The line stays valid
+    // until the next call.
+    bool next(const char** line, size_t* len)
     {
         for (;;)
         {
-            int c = sb->sbumpc();
-            switch (c)
+            const char* begin = m_buf.data() + m_begin;
+            const char* end = m_buf.data() + m_end;
+            const char* p = findLineEnd(begin + m_scanned, end);
+
+            // A '\r' at the end of the block may be the first half of '\r\n'
+            if (p < end && (p + 1 < end || (*p) == '\n' || m_eof))
+            {
+                (*line) = begin;
+                (*len) = static_cast<size_t>(p - begin);
+
+                // Handle '\r', '\n' and '\r\n' line endings.
+                if ((*p) == '\r' && (p + 1) < end && p[1] == '\n')
+                {
+                    p++;
+                }
+                m_begin = static_cast<size_t>(p + 1 - m_buf.data());
+                m_scanned = 0;
+                return true;
+            }
+
+            if (m_eof)
             {
-                case '\n':
-                    return is;
-                case '\r':
-                    if (sb->sgetc() == '\n')
-                        sb->sbumpc();
-                    return is;
-                case EOF:
-                    // Also handle the case when the last line has no line ending
-                    if (t.empty())
-                        is.setstate(std::ios::eofbit);
-                    return is;
-                default:
-                    t += static_cast<char>(c);
+                if (m_begin == m_end)
+                {
+                    return false;
+                }
+
+                // The last line has no line ending, refill left room for a terminator
+                m_buf[m_end] = '\0';
+                (*line) = begin;
+                (*len) = m_end - m_begin;
+                m_begin = m_end;
+                m_scanned = 0;
+                return true;
             }
+
+            m_scanned = static_cast<size_t>(p - begin);
+            refill();
         }
     }
 
-    return is;
-}
+private:
+    static const size_t kBlockSize = 64 * 1024;
+
+    // Move the unread part of the block to its front and read more after it
+    void refill()
+    {
+        const size_t pending = m_end - m_begin;
+        if (pending > 0 && m_begin > 0)
+        {
+            memmove(m_buf.data(), m_buf.data() + m_begin, pending);
+        }
+        m_begin = 0;
+        m_end = pending;
+
+        // Always a block to read into and one byte for a terminator
+        if (m_buf.size() < pending + kBlockSize + 1)
+        {
+            m_buf.resize(std::max(m_buf.size() * 2, pending + kBlockSize + 1));
+        }
+
+        const std::streamsize read =
+            m_inStream.rdbuf()->sgetn(m_buf.data() + m_end, static_cast<std::streamsize>(m_buf.size() - 1 - m_end));
+        if (read <= 0)
+        {
+            m_eof = true;
+            m_inStream.setstate(std::ios::eofbit | std::ios::failbit);
+            return;
+        }
+        m_end += static_cast<size_t>(read);
+    }
+
+    std::istream& m_inStream;
+    std::vector<char> m_buf;
+    // Unread part of m_buf, and how much of it is known to have no line ending
+    size_t m_begin;
+    size_t m_end;
+    size_t m_scanned;
+    bool m_eof;
+};
+
+// Reads lines in place from a memory buffer. Every returned line is followed
+// by its '\r', '\n' or '\0' terminator, so the parsers below can run straight
+// on the buffer. Only a last line without a line ending is copied, to give it
+// a terminator.
+class BufferLineReader
+{
+public:
+    BufferLineReader(const char* buf, size_t len) : m_cur(buf), m_end(buf + len) { }
+
+    bool next(const char** line, size_t* len)
+    {
+        if (m_cur >= m_end)
+        {
+            return false;
+        }
+
+        const char* p = findLineEnd(m_cur, m_end);
+
+        if (p == m_end)
+        {
+            m_tail.assign(m_cur, m_end);
+            (*line) = m_tail.c_str();
+            (*len) = m_tail.size();
+            m_cur = m_end;
+            return true;
+        }
+
+        (*line) = m_cur;
+        (*len) = static_cast<size_t>(p - m_cur);
+
+        // Handle '\r', '\n' and '\r\n' line endings.
+        if ((*p) == '\r' && (p + 1) < m_end && p[1] == '\n')
+        {
+            p++;
+        }
+        m_cur = p + 1;
+        return true;
+    }
+
+private:
+    const char* m_cur;
+    const char* m_end;
+    std::string m_tail;
+};
 
 #define IS_SPACE(x)    (((x) == ' ') || ((x) == '\t'))
 #define IS_DIGIT(x)    (static_cast<unsigned int>((x) - '0') < static_cast<unsigned int>(10))
@@ -534,12 +809,40 @@ fixIndex(int idx, int n, int* ret)
     return false; // never reach here.
 }
 
+// atoi() that stays within the current line. atoi() skips any leading
+// whitespace, including line endings, which would run into the next line (or
+// past the end) of a buffer that is parsed in place.
+static inline int
+parseLineInt(const char* s)
+{
+    while ((*s) == ' ' || (*s) == '\t' || (*s) == '\v' || (*s) == '\f')
+    {
+        s++;
+    }
+
+    bool negative = false;
+    if ((*s) == '+' || (*s) == '-')
+    {
+        negative = ((*s) == '-');
+        s++;
+    }
+
+    unsigned int value = 0;
+    while (IS_DIGIT(*s))
+    {
+        value = value * 10 + static_cast<unsigned int>((*s) - '0');
+        s++;
+    }
+
+    return static_cast<int>(negative ? (0u - value) : value);
+}
+
 static inline std::string
 parseString(const char** token)
 {
     std::string s;
     (*token) += strspn((*token), " \t");
-    size_t e = strcspn((*token), " \t\r");
+    size_t e = strcspn((*token), " \t\r\n");
     s = std::string((*token), &(*token)[e]);
     (*token) += e;
     return s;
@@ -549,40 +852,248 @@ static inline int
 parseInt(const char** token)
 {
     (*token) += strspn((*token), " \t");
-    int i = atoi((*token));
-    (*token) += strcspn((*token), " \t\r");
+    int i = parseLineInt((*token));
+    (*token) += strcspn((*token), " \t\r\n");
     return i;
 }
 
-// Tries to parse a floating point number located at s.
-//
-// s_end should be a location in the string where reading should absolutely
-// stop. For example at the end of the string, to prevent buffer overflows.
-//
-// Parses the following EBNF grammar:
-//   sign    = "+" | "-" ;
-//   END     = ? anything not in digit ?
-//   digit   = "0" | "1" | "2" | "3" | "4" | "5" | "6" | "7" | "8" | "9" ;
-//   integer = [sign] , digit , {digit} ;
-//   decimal = integer , ["." , integer] ;
-//   float   = ( decimal , END ) | ( decimal , ("E" | "e") , integer , END ) ;
-//
-//  Valid strings are for example:
-//   -0  +3.1417e+2  -0.0E-3  1.0324  -1.41   11e2
-//
-// If the parsing is a success, result is set to the parsed value and true
-// is returned.
-//
-// The function is greedy and will parse until any of the following happens:
-//  - a non-conforming character is encountered.
-//  - s_end is reached.
-//
-// The following situations triggers a failure:
-//  - s >= s_end.
-//  - parse failure.
-//
+static inline void
+fullMultiplication(uint64_t a, uint64_t b, uint64_t* lo, uint64_t* hi)
+{
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    (*lo) = static_cast<uint64_t>(r);
+    (*hi) = static_cast<uint64_t>(r >> 64);
+#else
+    const uint64_t a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+    const uint64_t b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+    const uint64_t p0 = a_lo * b_lo;
+    const uint64_t p1 = a_lo * b_hi;
+    const uint64_t p2 = a_hi * b_lo;
+    const uint64_t p3 = a_hi * b_hi;
+    const uint64_t mid = (p0 >> 32) + (p1 & 0xFFFFFFFFULL) + (p2 & 0xFFFFFFFFULL);
+    (*lo) = (mid << 32) | (p0 & 0xFFFFFFFFULL);
+    (*hi) = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+#endif
+}
+
+static inline int
+leadingZeroes(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(w);
+#else
+    int n = 0;
+    while (!(w & 0x8000000000000000ULL))
+    {
+        w <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// 128-bit approximations of 5^q, normalized so that the top bit is set, as
+// used by the Eisel-Lemire algorithm. Only the exponents that occur in real
+// OBJ data are covered, anything else goes to tryParseDoubleSlow.
+static const int power_of_five_min = -64;
+static const int power_of_five_max = 64;
+static const uint64_t power_of_five_128[] = {
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL, // 5^-64
+    0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL, // 5^-63
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL, // 5^-62
+    0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL, // 5^-61
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL, // 5^-60
+    0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL, // 5^-59
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL, // 5^-58
+    0xc8de047564d20a8bULL, 0xf245825a5a445275ULL, // 5^-57
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL, // 5^-56
+    0x9ced737bb6c4183dULL, 0x55464dd69685606bULL, // 5^-55
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL, // 5^-54
+    0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL, // 5^-53
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL, // 5^-52
+    0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL, // 5^-51
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL, // 5^-50
+    0x95a8637627989aadULL, 0xdde7001379a44aa8ULL, // 5^-49
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL, // 5^-48
+    0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL, // 5^-47
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL, // 5^-46
+    0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL, // 5^-45
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL, // 5^-44
+    0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL, // 5^-43
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL, // 5^-42
+    0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL, // 5^-41
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL, // 5^-40
+    0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL, // 5^-39
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL, // 5^-38
+    0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL, // 5^-37
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL, // 5^-36
+    0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL, // 5^-35
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL, // 5^-34
+    0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL, // 5^-33
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL, // 5^-32
+    0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL, // 5^-31
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL, // 5^-30
+    0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL, // 5^-29
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL, // 5^-28
+    0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL, // 5^-27
+    0xc612062576589ddaULL, 0x95364afe032a819eULL, // 5^-26
+    0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL, // 5^-25
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL, // 5^-24
+    0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL, // 5^-23
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL, // 5^-22
+    0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL, // 5^-21
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL, // 5^-20
+    0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL, // 5^-19
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL, // 5^-18
+    0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL, // 5^-17
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL, // 5^-16
+    0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL, // 5^-15
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL, // 5^-14
+    0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL, // 5^-13
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL, // 5^-12
+    0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL, // 5^-11
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL, // 5^-10
+    0x89705f4136b4a597ULL, 0x31680a88f8953031ULL, // 5^-9
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL, // 5^-8
+    0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL, // 5^-7
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL, // 5^-6
+    0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL, // 5^-5
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL, // 5^-4
+    0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL, // 5^-3
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL, // 5^-2
+    0xccccccccccccccccULL, 0xcccccccccccccccdULL, // 5^-1
+    0x8000000000000000ULL, 0x0000000000000000ULL, // 5^0
+    0xa000000000000000ULL, 0x0000000000000000ULL, // 5^1
+    0xc800000000000000ULL, 0x0000000000000000ULL, // 5^2
+    0xfa00000000000000ULL, 0x0000000000000000ULL, // 5^3
+    0x9c40000000000000ULL, 0x0000000000000000ULL, // 5^4
+    0xc350000000000000ULL, 0x0000000000000000ULL, // 5^5
+    0xf424000000000000ULL, 0x0000000000000000ULL, // 5^6
+    0x9896800000000000ULL, 0x0000000000000000ULL, // 5^7
+    0xbebc200000000000ULL, 0x0000000000000000ULL, // 5^8
+    0xee6b280000000000ULL, 0x0000000000000000ULL, // 5^9
+    0x9502f90000000000ULL, 0x0000000000000000ULL, // 5^10
+    0xba43b74000000000ULL, 0x0000000000000000ULL, // 5^11
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL, // 5^12
+    0x9184e72a00000000ULL, 0x0000000000000000ULL, // 5^13
+    0xb5e620f480000000ULL, 0x0000000000000000ULL, // 5^14
+    0xe35fa931a0000000ULL, 0x0000000000000000ULL, // 5^15
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL, // 5^16
+    0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL, // 5^17
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL, // 5^18
+    0x8ac7230489e80000ULL, 0x0000000000000000ULL, // 5^19
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL, // 5^20
+    0xd8d726b7177a8000ULL, 0x0000000000000000ULL, // 5^21
+    0x878678326eac9000ULL, 0x0000000000000000ULL, // 5^22
+    0xa968163f0a57b400ULL, 0x0000000000000000ULL, // 5^23
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL, // 5^24
+    0x84595161401484a0ULL, 0x0000000000000000ULL, // 5^25
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL, // 5^26
+    0xcecb8f27f4200f3aULL, 0x0000000000000000ULL, // 5^27
+    0x813f3978f8940984ULL, 0x4000000000000000ULL, // 5^28
+    0xa18f07d736b90be5ULL, 0x5000000000000000ULL, // 5^29
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL, // 5^30
+    0xfc6f7c4045812296ULL, 0x4d00000000000000ULL, // 5^31
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL, // 5^32
+    0xc5371912364ce305ULL, 0x6c28000000000000ULL, // 5^33
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL, // 5^34
+    0x9a130b963a6c115cULL, 0x3c7f400000000000ULL, // 5^35
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL, // 5^36
+    0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL, // 5^37
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL, // 5^38
+    0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL, // 5^39
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL, // 5^40
+    0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL, // 5^41
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL, // 5^42
+    0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL, // 5^43
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL, // 5^44
+    0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL, // 5^45
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL, // 5^46
+    0x8c213d9da502de45ULL, 0x4526f422cc340000ULL, // 5^47
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL, // 5^48
+    0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL, // 5^49
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL, // 5^50
+    0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL, // 5^51
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL, // 5^52
+    0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL, // 5^53
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL, // 5^54
+    0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL, // 5^55
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL, // 5^56
+    0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL, // 5^57
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL, // 5^58
+    0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL, // 5^59
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL, // 5^60
+    0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL, // 5^61
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL, // 5^62
+    0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL, // 5^63
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL, // 5^64
+};
+
+// Eisel-Lemire: computes the correctly rounded double for w * 10^q, with
+// w != 0 and q within the table. Returns false in the rare cases where the
+// 128-bit product is too close to a rounding boundary to decide.
+static bool
+computeDouble(int q, uint64_t w, bool negative, double* result)
+{
+    const int lz = leadingZeroes(w);
+    w <<= lz;
+
+    const uint64_t* pow5 = &power_of_five_128[2 * (q - power_of_five_min)];
+    uint64_t lo, hi;
+    fullMultiplication(w, pow5[0], &lo, &hi);
+    if ((hi & 0x1FF) == 0x1FF)
+    {
+        uint64_t lo2, hi2;
+        fullMultiplication(w, pow5[1], &lo2, &hi2);
+        lo += hi2;
+        if (hi2 > lo)
+        {
+            hi++;
+        }
+    }
+
+    if (lo == 0xFFFFFFFFFFFFFFFFULL && (q < -27 || q > 55))
+    {
+        return false;
+    }
+
+    // 52 explicit mantissa bits plus 3 guard bits. The table range keeps the
+    // result well inside the normal range, no subnormal or infinity handling
+    // is needed.
+    const int upperbit = static_cast<int>(hi >> 63);
+    uint64_t mantissa = hi >> (upperbit + 64 - 52 - 3);
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+
+    // Exactly half way between two doubles: round to even.
+    if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1)
+    {
+        if ((mantissa << (upperbit + 64 - 52 - 3)) == hi)
+        {
+            mantissa &= ~static_cast<uint64_t>(1);
+        }
+    }
+
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if (mantissa >= (static_cast<uint64_t>(2) << 52))
+    {
+        mantissa = static_cast<uint64_t>(1) << 52;
+        power2++;
+    }
+    mantissa &= ~(static_cast<uint64_t>(1) << 52);
+
+    const uint64_t bits = mantissa | (static_cast<uint64_t>(power2) << 52) | (negative ? (static_cast<uint64_t>(1) << 63) : 0);
+    memcpy(result, &bits, sizeof(bits));
+    return true;
+}
+
+// The original digit-by-digit parser. It accumulates rounding error, so it is
+// only used for numbers the fast path below does not handle: more than 19
+// digits or a decimal exponent outside the power_of_five_128 table. s_end is
+// where reading must stop.
 static bool
-tryParseDouble(const char* s, const char* s_end, double* result)
+tryParseDoubleSlow(const char* s, const char* s_end, double* result)
 {
     if (s >= s_end)
     {
@@ -719,84 +1230,243 @@ fail:
     return false;
 }
 
-static inline real_t
-parseReal(const char** token, double default_value = 0.0)
-{
-    (*token) += strspn((*token), " \t");
-    const char* end = (*token) + strcspn((*token), " \t\r");
-    double val = default_value;
-    tryParseDouble((*token), end, &val);
-    real_t f = static_cast<real_t>(val);
-    (*token) = end;
-    return f;
-}
-
-static inline bool
-parseReal(const char** token, real_t* out)
+// Tries to parse a floating point number located at s.
+//
+// Parses the following EBNF grammar:
+//   sign    = "+" | "-" ;
+//   END     = ? anything not in digit ?
+//   digit   = "0" | "1" | "2" | "3" | "4" | "5" | "6" | "7" | "8" | "9" ;
+//   integer = [sign] , digit , {digit} ;
+//   decimal = integer , ["." , integer] ;
+//   float   = ( decimal , END ) | ( decimal , ("E" | "e") , integer , END ) ;
+//
+//  Valid strings are for example:
+//   -0  +3.1417e+2  -0.0E-3  1.0324  -1.41   11e2
+//
+// If the parsing is a success, result is set to the parsed value and true
+// is returned. The value is correctly rounded, the same as strtod() gives
+// for the parsed characters, unless the number has more than 19 digits not
+// counting leading zeros, or an extreme exponent (see tryParseDoubleSlow).
+// tools/floatcheck compares it with strtod.
+//
+// The function is greedy and will parse until a non-conforming character is
+// encountered. `token_end` is set to the end of the token, the next space, tab
+// or line ending, also on failure. Any line ending, including '\0', stops the
+// scan, so the number does not need to be measured up front.
+//
+static bool
+tryParseDouble(const char* s, const char** token_end, double* result)
 {
-    (*token) += strspn((*token), " \t");
-    const char* end = (*token) + strcspn((*token), " \t\r");
-    double val;
-    bool ret = tryParseDouble((*token), end, &val);
-    if (ret)
+    const char* curr = s;
+    bool negative = false;
+    if (*curr == '+' || *curr == '-')
     {
-        real_t f = static_cast<real_t>(val);
-        (*out) = f;
+        negative = (*curr == '-');
+        curr++;
     }
-    (*token) = end;
-    return ret;
-}
-
-static inline void
-parseReal2(real_t* x, real_t* y, const char** token, const double default_x = 0.0, const double default_y = 0.0)
-{
-    (*x) = parseReal(token, default_x);
-    (*y) = parseReal(token, default_y);
-}
-
-static inline void
-parseReal3(real_t* x, real_t* y, real_t* z, const char** token, const double default_x = 0.0, const double default_y = 0.0,
-           const double default_z = 0.0)
-{
-    (*x) = parseReal(token, default_x);
-    (*y) = parseReal(token, default_y);
-    (*z) = parseReal(token, default_z);
-}
 
-static inline void
-parseV(real_t* x, real_t* y, real_t* z, real_t* w, const char** token, const double default_x = 0.0, const double default_y = 0.0,
-       const double default_z = 0.0, const double default_w = 1.0)
-{
-    (*x) = parseReal(token, default_x);
-    (*y) = parseReal(token, default_y);
-    (*z) = parseReal(token, default_z);
-    (*w) = parseReal(token, default_w);
-}
-
-// Extension: parse vertex with colors(6 items)
-static inline bool
-parseVertexWithColor(real_t* x, real_t* y, real_t* z, real_t* r, real_t* g, real_t* b, const char** token, const double default_x = 0.0,
-                     const double default_y = 0.0, const double default_z = 0.0)
-{
-    (*x) = parseReal(token, default_x);
-    (*y) = parseReal(token, default_y);
-    (*z) = parseReal(token, default_z);
-
-    const bool found_color = parseReal(token, r) && parseReal(token, g) && parseReal(token, b);
+    uint64_t w = 0;
+    int64_t exponent = 0;
+    bool valid = true;
 
-    if (!found_color)
+    // Read the integer part, at least one digit is required. Leading zeros do
+    // not change w, so they do not count towards the digits it can hold.
+    const char* digits_begin = curr;
+    while (*curr == '0')
     {
-        (*r) = (*g) = (*b) = 1.0;
+        curr++;
+    }
+    const char* significant_begin = curr;
+    while (IS_DIGIT(*curr))
+    {
+        w = w * 10 + static_cast<uint64_t>(*curr - '0');
+        curr++;
+    }
+    ptrdiff_t num_digits = curr - significant_begin;
+    if (curr == digits_begin)
+    {
+        valid = false;
     }
 
-    return found_color;
-}
-
-static inline bool
+    // Read the decimal part, skipping the zeros after the point of a number below 1.
+    if (valid && *curr == '.')
+    {
+        curr++;
+        const char* frac_begin = curr;
+        if (num_digits == 0)
+        {
+            while (*curr == '0')
+            {
+                curr++;
+            }
+        }
+        const char* frac_significant_begin = curr;
+        while (IS_DIGIT(*curr))
+        {
+            w = w * 10 + static_cast<uint64_t>(*curr - '0');
+            curr++;
+        }
+        exponent = -(curr - frac_begin);
+        num_digits += curr - frac_significant_begin;
+    }
+
+    // Read the exponent part.
+    if (valid && (*curr == 'e' || *curr == 'E'))
+    {
+        curr++;
+        bool exp_negative = false;
+        if (*curr == '+' || *curr == '-')
+        {
+            exp_negative = (*curr == '-');
+            curr++;
+        }
+
+        const char* exp_begin = curr;
+        int64_t exp_value = 0;
+        while (IS_DIGIT(*curr))
+        {
+            if (exp_value < 100000)
+            {
+                exp_value = exp_value * 10 + (*curr - '0');
+            }
+            curr++;
+        }
+        // Empty E is not allowed.
+        valid = (curr != exp_begin);
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+
+    // Skip anything else up to the end of the token.
+    if (!IS_SPACE(*curr) && !IS_NEW_LINE(*curr))
+    {
+        curr += strcspn(curr, " \t\r\n");
+    }
+    (*token_end) = curr;
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    // Up to 19 digits, w holds the exact decimal mantissa.
+    if (num_digits <= 19)
+    {
+        if (w == 0)
+        {
+            (*result) = negative ? -0.0 : 0.0;
+            return true;
+        }
+
+        // Clinger's fast path: w and 10^|exponent| are both exact doubles, so
+        // a single multiplication or division is correctly rounded.
+        if (exponent >= -22 && exponent <= 22 && w <= (static_cast<uint64_t>(1) << 53))
+        {
+            static const double exact_pow10[] = {
+                1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+            };
+            double value = static_cast<double>(static_cast<int64_t>(w));
+            if (exponent < 0)
+            {
+                value /= exact_pow10[-exponent];
+            }
+            else
+            {
+                value *= exact_pow10[exponent];
+            }
+            (*result) = negative ? -value : value;
+            return true;
+        }
+
+        if (exponent >= power_of_five_min && exponent <= power_of_five_max &&
+            computeDouble(static_cast<int>(exponent), w, negative, result))
+        {
+            return true;
+        }
+    }
+
+    return tryParseDoubleSlow(s, curr, result);
+}
+
+static inline real_t
+parseReal(const char** token, double default_value = 0.0)
+{
+    while (IS_SPACE(**token))
+    {
+        (*token)++;
+    }
+    double val = default_value;
+    tryParseDouble((*token), token, &val);
+    return static_cast<real_t>(val);
+}
+
+static inline bool
+parseReal(const char** token, real_t* out)
+{
+    while (IS_SPACE(**token))
+    {
+        (*token)++;
+    }
+    double val;
+    bool ret = tryParseDouble((*token), token, &val);
+    if (ret)
+    {
+        real_t f = static_cast<real_t>(val);
+        (*out) = f;
+    }
+    return ret;
+}
+
+static inline void
+parseReal2(real_t* x, real_t* y, const char** token, const double default_x = 0.0, const double default_y = 0.0)
+{
+    (*x) = parseReal(token, default_x);
+    (*y) = parseReal(token, default_y);
+}
+
+static inline void
+parseReal3(real_t* x, real_t* y, real_t* z, const char** token, const double default_x = 0.0, const double default_y = 0.0,
+           const double default_z = 0.0)
+{
+    (*x) = parseReal(token, default_x);
+    (*y) = parseReal(token, default_y);
+    (*z) = parseReal(token, default_z);
+}
+
+static inline void
+parseV(real_t* x, real_t* y, real_t* z, real_t* w, const char** token, const double default_x = 0.0, const double default_y = 0.0,
+       const double default_z = 0.0, const double default_w = 1.0)
+{
+    (*x) = parseReal(token, default_x);
+    (*y) = parseReal(token, default_y);
+    (*z) = parseReal(token, default_z);
+    (*w) = parseReal(token, default_w);
+}
+
+// Extension: parse vertex with colors(6 items)
+static inline bool
+parseVertexWithColor(real_t* x, real_t* y, real_t* z, real_t* r, real_t* g, real_t* b, const char** token, const double default_x = 0.0,
+                     const double default_y = 0.0, const double default_z = 0.0)
+{
+    (*x) = parseReal(token, default_x);
+    (*y) = parseReal(token, default_y);
+    (*z) = parseReal(token, default_z);
+
+    const bool found_color = parseReal(token, r) && parseReal(token, g) && parseReal(token, b);
+
+    if (!found_color)
+    {
+        (*r) = (*g) = (*b) = 1.0;
+    }
+
+    return found_color;
+}
+
+static inline bool
 parseOnOff(const char** token, bool default_value = true)
 {
     (*token) += strspn((*token), " \t");
-    const char* end = (*token) + strcspn((*token), " \t\r");
+    const char* end = (*token) + strcspn((*token), " \t\r\n");
 
     bool ret = default_value;
     if ((0 == strncmp((*token), "on", 2)))
@@ -816,7 +1486,7 @@ static inline texture_type_t
 parseTextureType(const char** token, texture_type_t default_value = TEXTURE_TYPE_NONE)
 {
     (*token) += strspn((*token), " \t");
-    const char* end = (*token) + strcspn((*token), " \t\r");
+    const char* end = (*token) + strcspn((*token), " \t\r\n");
     texture_type_t ty = default_value;
 
     if ((0 == strncmp((*token), "cube_top", strlen("cube_top"))))
@@ -858,8 +1528,8 @@ parseTagTriple(const char** token)
     tag_sizes ts;
 
     (*token) += strspn((*token), " \t");
-    ts.num_ints = atoi((*token));
-    (*token) += strcspn((*token), "/ \t\r");
+    ts.num_ints = parseLineInt((*token));
+    (*token) += strcspn((*token), "/ \t\r\n");
     if ((*token)[0] != '/')
     {
         return ts;
@@ -868,8 +1538,8 @@ parseTagTriple(const char** token)
     (*token)++; // Skip '/'
 
     (*token) += strspn((*token), " \t");
-    ts.num_reals = atoi((*token));
-    (*token) += strcspn((*token), "/ \t\r");
+    ts.num_reals = parseLineInt((*token));
+    (*token) += strcspn((*token), "/ \t\r\n");
     if ((*token)[0] != '/')
     {
         return ts;
@@ -892,12 +1562,12 @@ parseTriple(const char** token, int vsize, int vnsize, int vtsize, vertex_index_
 
     vertex_index_t vi(-1);
 
-    if (!fixIndex(atoi((*token)), vsize, &(vi.v_idx)))
+    if (!fixIndex(parseLineInt((*token)), vsize, &(vi.v_idx)))
     {
         return false;
     }
 
-    (*token) += strcspn((*token), "/ \t\r");
+    (*token) += strcspn((*token), "/ \t\r\n");
     if ((*token)[0] != '/')
     {
         (*ret) = vi;
@@ -909,22 +1579,22 @@ parseTriple(const char** token, int vsize, int vnsize, int vtsize, vertex_index_
     if ((*token)[0] == '/')
     {
         (*token)++;
-        if (!fixIndex(atoi((*token)), vnsize, &(vi.vn_idx)))
+        if (!fixIndex(parseLineInt((*token)), vnsize, &(vi.vn_idx)))
         {
             return false;
         }
-        (*token) += strcspn((*token), "/ \t\r");
+        (*token) += strcspn((*token), "/ \t\r\n");
         (*ret) = vi;
         return true;
     }
 
     // i/j/k or i/j
-    if (!fixIndex(atoi((*token)), vtsize, &(vi.vt_idx)))
+    if (!fixIndex(parseLineInt((*token)), vtsize, &(vi.vt_idx)))
     {
         return false;
     }
 
-    (*token) += strcspn((*token), "/ \t\r");
+    (*token) += strcspn((*token), "/ \t\r\n");
     if ((*token)[0] != '/')
     {
         (*ret) = vi;
@@ -933,28 +1603,36 @@ parseTriple(const char** token, int vsize, int vnsize, int vtsize, vertex_index_
 
     // i/j/k
     (*token)++; // skip '/'
-    if (!fixIndex(atoi((*token)), vnsize, &(vi.vn_idx)))
+    if (!fixIndex(parseLineInt((*token)), vnsize, &(vi.vn_idx)))
     {
         return false;
     }
-    (*token) += strcspn((*token), "/ \t\r");
+    (*token) += strcspn((*token), "/ \t\r\n");
 
     (*ret) = vi;
 
     return true;
 }
 
-// Parse raw triples: i, i/j/k, i//k, i/j
-static vertex_index_t
-parseRawTriple(const char** token)
+// Parse triples like parseTriple, but keep the indices as written so that
+// relative indices can be resolved later with fixIndex. Missing components
+// are left at 0. Returns false where parseTriple would (a zero index).
+static bool
+parseUnresolvedTriple(const char** token, vertex_index_t* ret)
 {
-    vertex_index_t vi(static_cast<int>(0)); // 0 is an invalid index in OBJ
+    vertex_index_t vi(static_cast<int>(0));
+
+    vi.v_idx = parseLineInt((*token));
+    if (vi.v_idx == 0)
+    {
+        return false;
+    }
 
-    vi.v_idx = atoi((*token));
-    (*token) += strcspn((*token), "/ \t\r");
+    (*token) += strcspn((*token), "/ \t\r\n");
     if ((*token)[0] != '/')
     {
-        return vi;
+        (*ret) = vi;
+        return true;
     }
     (*token)++;
 
@@ -962,24 +1640,42 @@ parseRawTriple(const char** token)
     if ((*token)[0] == '/')
     {
         (*token)++;
-        vi.vn_idx = atoi((*token));
-        (*token) += strcspn((*token), "/ \t\r");
-        return vi;
+        vi.vn_idx = parseLineInt((*token));
+        if (vi.vn_idx == 0)
+        {
+            return false;
+        }
+        (*token) += strcspn((*token), "/ \t\r\n");
+        (*ret) = vi;
+        return true;
     }
 
     // i/j/k or i/j
-    vi.vt_idx = atoi((*token));
-    (*token) += strcspn((*token), "/ \t\r");
+    vi.vt_idx = parseLineInt((*token));
+    if (vi.vt_idx == 0)
+    {
+        return false;
+    }
+
+    (*token) += strcspn((*token), "/ \t\r\n");
     if ((*token)[0] != '/')
     {
-        return vi;
+        (*ret) = vi;
+        return true;
     }
 
     // i/j/k
     (*token)++; // skip '/'
-    vi.vn_idx = atoi((*token));
-    (*token) += strcspn((*token), "/ \t\r");
-    return vi;
+    vi.vn_idx = parseLineInt((*token));
+    if (vi.vn_idx == 0)
+    {
+        return false;
+    }
+    (*token) += strcspn((*token), "/ \t\r\n");
+
+    (*ret) = vi;
+
+    return true;
 }
 
 bool
@@ -1043,7 +1739,7 @@ ParseTextureNameAndOption(std::string* texname, texture_option_t* texopt, const
         {
             token += 9;
             token += strspn(token, " \t");
-            const char* end = token + strcspn(token, " \t\r");
+            const char* end = token + strcspn(token, " \t\r\n");
             if ((end - token) == 1)
             { // Assume one char for -imfchan
                 texopt->imfchan = (*token);
@@ -1191,261 +1887,614 @@ pnpoly(int nvert, T* vertx, T* verty, T testx, T testy)
     return c;
 }
 
-// TODO(syoyo): refactor function.
+// Faces with more corners than this that are not convex are clipped with
+// ear_clipper_t, smaller ones keep the original clipping loop, which is quadratic
+// in the number of corners but exactly as it always was.
+static const size_t kMaxLegacyTriangulationCorners = 8;
+
+// Twice the signed area of the triangle, the cross product TriangulateFace
+// uses to tell convex from reflex corners.
+static inline real_t
+TriangleCross(real_t ax, real_t ay, real_t bx, real_t by, real_t cx, real_t cy)
+{
+    return (bx - ax) * (cy - by) - (by - ay) * (cx - bx);
+}
+
+// True if the projected polygon is strictly convex, turning the same way as
+// `area` at every corner and only once around. The original clipping loop
+// cuts such a polygon into a fan around its first corner.
 static bool
-exportGroupsToShape(shape_t* shape, const std::vector<face_t>& faceGroup, std::vector<int>& lineGroup, const std::vector<tag_t>& tags,
-                    const int material_id, const std::string& name, bool triangulate, const std::vector<real_t>& v)
+IsConvexPolygon(const real_t* xy, size_t n, real_t area)
 {
-    if (faceGroup.empty() && lineGroup.empty())
+    int x_sign_changes = 0;
+    int y_sign_changes = 0;
+    real_t last_dx = 0;
+    real_t last_dy = 0;
+    real_t first_dx = 0;
+    real_t first_dy = 0;
+    for (size_t k = 0; k < n; ++k)
     {
-        return false;
+        const real_t* a = xy + 2 * k;
+        const real_t* b = xy + 2 * ((k + 1) % n);
+        const real_t* c = xy + 2 * ((k + 2) % n);
+        if (!(TriangleCross(a[0], a[1], b[0], b[1], c[0], c[1]) * area > 0))
+        {
+            return false;
+        }
+
+        // Count direction reversals along each axis, a simple convex
+        // polygon has at most two per axis, a star-shaped one more
+        const real_t dx = b[0] - a[0];
+        const real_t dy = b[1] - a[1];
+        if (dx != 0)
+        {
+            if (last_dx == 0)
+            {
+                first_dx = dx;
+            }
+            else if ((dx > 0) != (last_dx > 0))
+            {
+                x_sign_changes++;
+            }
+            last_dx = dx;
+        }
+        if (dy != 0)
+        {
+            if (last_dy == 0)
+            {
+                first_dy = dy;
+            }
+            else if ((dy > 0) != (last_dy > 0))
+            {
+                y_sign_changes++;
+            }
+            last_dy = dy;
+        }
     }
+    // Close the loop back to the first edge
+    x_sign_changes += (first_dx != 0 && (first_dx > 0) != (last_dx > 0)) ? 1 : 0;
+    y_sign_changes += (first_dy != 0 && (first_dy > 0) != (last_dy > 0)) ? 1 : 0;
+    return x_sign_changes <= 2 && y_sign_changes <= 2;
+}
 
-    if (!faceGroup.empty())
+// Picks the two axes to project a face on from the dominant component of its
+// normal by Newell's method, the same way TriangulateFace does from a corner.
+// Leaves `axes` as they are if the normal is zero.
+static void
+FindPolygonAxes(const index_t* face, size_t n, const real_t* v, size_t v_size, size_t axes[2])
+{
+    real_t nx = 0;
+    real_t ny = 0;
+    real_t nz = 0;
+    for (size_t k = 0; k < n; ++k)
     {
-        // Flatten vertices and indices
-        for (size_t i = 0; i < faceGroup.size(); i++)
+        size_t vi0 = size_t(face[k].vertex_index);
+        size_t vi1 = size_t(face[(k + 1) % n].vertex_index);
+        if (((3 * vi0 + 2) >= v_size) || ((3 * vi1 + 2) >= v_size))
         {
-            const face_t& face = faceGroup[i];
+            continue;
+        }
+        const real_t* p0 = v + 3 * vi0;
+        const real_t* p1 = v + 3 * vi1;
+        nx += (p0[1] - p1[1]) * (p0[2] + p1[2]);
+        ny += (p0[2] - p1[2]) * (p0[0] + p1[0]);
+        nz += (p0[0] - p1[0]) * (p0[1] + p1[1]);
+    }
 
-            size_t npolys = face.vertex_indices.size();
+    const real_t cx = std::fabs(nx);
+    const real_t cy = std::fabs(ny);
+    const real_t cz = std::fabs(nz);
+    if (cx > 0 || cy > 0 || cz > 0)
+    {
+        axes[0] = (cx > cy && cx > cz) ? 1 : 0;
+        axes[1] = (cx > cy && cx > cz) ? 2 : ((cz > cx && cz > cy) ? 1 : 2);
+    }
+}
 
-            if (npolys < 3)
+namespace
+{
+
+// Ear clipping in close to O(n log n) for the faces of real models. Only a
+// reflex corner can lie inside an ear of a simple polygon, so the reflex
+// corners are bucketed in a uniform grid over the polygon and an ear is only
+// tested against those in the cells its bounding box covers. Clipping never
+// turns a convex corner reflex, so the grid only ever loses corners, which
+// are skipped when their turn is checked.
+class ear_clipper_t
+{
+public:
+    ear_clipper_t(const real_t* xy, size_t n, real_t area)
+        : m_sign(area < 0 ? real_t(-1) : real_t(1)), m_x(n), m_y(n), m_prev(n), m_next(n), m_removed(n, false)
+    {
+        for (size_t k = 0; k < n; ++k)
+        {
+            m_x[k] = xy[2 * k];
+            m_y[k] = xy[2 * k + 1];
+            m_prev[k] = (k + n - 1) % n;
+            m_next[k] = (k + 1) % n;
+        }
+
+        std::vector<size_t> reflex;
+        m_min_x = m_max_x = m_x[0];
+        m_min_y = m_max_y = m_y[0];
+        for (size_t k = 0; k < n; ++k)
+        {
+            if (Turn(m_prev[k], k, m_next[k]) <= 0)
             {
-                // Face must have 3+ vertices.
-                continue;
+                reflex.push_back(k);
             }
+            m_min_x = (std::min)(m_min_x, m_x[k]);
+            m_max_x = (std::max)(m_max_x, m_x[k]);
+            m_min_y = (std::min)(m_min_y, m_y[k]);
+            m_max_y = (std::max)(m_max_y, m_y[k]);
+        }
 
-            vertex_index_t i0 = face.vertex_indices[0];
-            vertex_index_t i1(-1);
-            vertex_index_t i2 = face.vertex_indices[1];
+        // About one reflex corner per cell
+        m_grid_size = 1;
+        while (m_grid_size * m_grid_size < reflex.size() && m_grid_size < 1024)
+        {
+            m_grid_size *= 2;
+        }
+        const real_t extent_x = m_max_x - m_min_x;
+        const real_t extent_y = m_max_y - m_min_y;
+        m_cell_scale_x = extent_x > 0 ? real_t(m_grid_size) / extent_x : real_t(0);
+        m_cell_scale_y = extent_y > 0 ? real_t(m_grid_size) / extent_y : real_t(0);
+
+        // Bucket the reflex corners by cell, cell c holds m_cell_corners[m_cell_start[c]..m_cell_start[c + 1])
+        m_cell_start.assign(m_grid_size * m_grid_size + 1, 0);
+        for (size_t k = 0; k < reflex.size(); ++k)
+        {
+            m_cell_start[Cell(m_x[reflex[k]], m_y[reflex[k]]) + 1]++;
+        }
+        for (size_t c = 0; c < m_grid_size * m_grid_size; ++c)
+        {
+            m_cell_start[c + 1] += m_cell_start[c];
+        }
+        m_cell_corners.resize(reflex.size());
+        std::vector<size_t> fill(m_cell_start.begin(), m_cell_start.end() - 1);
+        for (size_t k = 0; k < reflex.size(); ++k)
+        {
+            m_cell_corners[fill[Cell(m_x[reflex[k]], m_y[reflex[k]])]++] = reflex[k];
+        }
+    }
 
-            if (triangulate)
+    // Appends the triangles as corner indices, in the winding of the polygon
+    void Clip(std::vector<size_t>* corners)
+    {
+        size_t remaining = m_x.size();
+        size_t ear = 0;
+        size_t stop = ear;
+        while (remaining > 3)
+        {
+            const size_t next = m_next[ear];
+            const bool is_ear = IsEar(ear);
+            if (!is_ear)
             {
-                // find the two axes to work in
-                size_t axes[2] = { 1, 2 };
-                for (size_t k = 0; k < npolys; ++k)
+                ear = next;
+                if (ear != stop)
                 {
-                    i0 = face.vertex_indices[(k + 0) % npolys];
-                    i1 = face.vertex_indices[(k + 1) % npolys];
-                    i2 = face.vertex_indices[(k + 2) % npolys];
-                    size_t vi0 = size_t(i0.v_idx);
-                    size_t vi1 = size_t(i1.v_idx);
-                    size_t vi2 = size_t(i2.v_idx);
-
-                    if (((3 * vi0 + 2) >= v.size()) || ((3 * vi1 + 2) >= v.size()) || ((3 * vi2 + 2) >= v.size()))
-                    {
-                        // Invalid triangle.
-                        // FIXME(syoyo): Is it ok to simply skip this invalid triangle?
-                        continue;
-                    }
-                    real_t v0x = v[vi0 * 3 + 0];
-                    real_t v0y = v[vi0 * 3 + 1];
-                    real_t v0z = v[vi0 * 3 + 2];
-                    real_t v1x = v[vi1 * 3 + 0];
-                    real_t v1y = v[vi1 * 3 + 1];
-                    real_t v1z = v[vi1 * 3 + 2];
-                    real_t v2x = v[vi2 * 3 + 0];
-                    real_t v2y = v[vi2 * 3 + 1];
-                    real_t v2z = v[vi2 * 3 + 2];
-                    real_t e0x = v1x - v0x;
-                    real_t e0y = v1y - v0y;
-                    real_t e0z = v1z - v0z;
-                    real_t e1x = v2x - v1x;
-                    real_t e1y = v2y - v1y;
-                    real_t e1z = v2z - v1z;
-                    real_t cx = std::fabs(e0y * e1z - e0z * e1y);
-                    real_t cy = std::fabs(e0z * e1x - e0x * e1z);
-                    real_t cz = std::fabs(e0x * e1y - e0y * e1x);
-                    const real_t epsilon = std::numeric_limits<real_t>::epsilon();
-                    if (cx > epsilon || cy > epsilon || cz > epsilon)
-                    {
-                        // found a corner
-                        if (cx > cy && cx > cz)
-                        {
-                        }
-                        else
-                        {
-                            axes[0] = 0;
-                            if (cz > cx && cz > cy)
-                                axes[1] = 1;
-                        }
-                        break;
-                    }
+                    continue;
                 }
+                // A whole lap without an ear, the polygon intersects itself or
+                // is degenerate. Clip anyway so no corner is lost.
+            }
 
-                real_t area = 0;
-                for (size_t k = 0; k < npolys; ++k)
-                {
-                    i0 = face.vertex_indices[(k + 0) % npolys];
-                    i1 = face.vertex_indices[(k + 1) % npolys];
-                    size_t vi0 = size_t(i0.v_idx);
-                    size_t vi1 = size_t(i1.v_idx);
-                    if (((vi0 * 3 + axes[0]) >= v.size()) || ((vi0 * 3 + axes[1]) >= v.size()) || ((vi1 * 3 + axes[0]) >= v.size()) ||
-                        ((vi1 * 3 + axes[1]) >= v.size()))
-                    {
-                        // Invalid index.
-                        continue;
-                    }
-                    real_t v0x = v[vi0 * 3 + axes[0]];
-                    real_t v0y = v[vi0 * 3 + axes[1]];
-                    real_t v1x = v[vi1 * 3 + axes[0]];
-                    real_t v1y = v[vi1 * 3 + axes[1]];
-                    area += (v0x * v1y - v0y * v1x) * static_cast<real_t>(0.5);
-                }
+            Emit(ear, corners);
+            m_next[m_prev[ear]] = m_next[ear];
+            m_prev[m_next[ear]] = m_prev[ear];
+            m_removed[ear] = true;
+            remaining--;
+            // Moving on past the next corner avoids long slivers around a single one
+            ear = is_ear ? m_next[next] : m_next[ear];
+            stop = ear;
+        }
+        Emit(ear, corners);
+    }
+
+private:
+    size_t CellCoordinate(real_t value, real_t min_value, real_t scale) const
+    {
+        const real_t cell = (value - min_value) * scale;
+        return cell < real_t(m_grid_size) ? static_cast<size_t>(cell) : m_grid_size - 1;
+    }
+
+    size_t Cell(real_t x, real_t y) const
+    {
+        return CellCoordinate(y, m_min_y, m_cell_scale_y) * m_grid_size + CellCoordinate(x, m_min_x, m_cell_scale_x);
+    }
 
+    real_t Turn(size_t a, size_t b, size_t c) const
+    {
+        return TriangleCross(m_x[a], m_y[a], m_x[b], m_y[b], m_x[c], m_y[c]) * m_sign;
+    }
 
-                face_t remainingFace = face; // copy
-                size_t guess_vert = 0;
-                vertex_index_t ind[3];
-                real_t vx[3];
-                real_t vy[3];
+    // True if corner p keeps the ear a-b-c from being clipped: it is
+    // reflex or flat and lies inside or on the ear
+    bool Blocks(size_t p, size_t a, size_t b, size_t c) const
+    {
+        if (m_removed[p] || p == a || p == b || p == c)
+        {
+            return false;
+        }
+        const real_t px = m_x[p];
+        const real_t py = m_y[p];
+        if ((px == m_x[a] && py == m_y[a]) || (px == m_x[b] && py == m_y[b]) || (px == m_x[c] && py == m_y[c]))
+        {
+            return false;
+        }
+        return TriangleCross(m_x[a], m_y[a], m_x[b], m_y[b], px, py) * m_sign >= 0 &&
+               TriangleCross(m_x[b], m_y[b], m_x[c], m_y[c], px, py) * m_sign >= 0 &&
+               TriangleCross(m_x[c], m_y[c], m_x[a], m_y[a], px, py) * m_sign >= 0 && Turn(m_prev[p], p, m_next[p]) <= 0;
+    }
 
-                // How many iterations can we do without decreasing the remaining
-                // vertices.
-                size_t remainingIterations = face.vertex_indices.size();
-                size_t previousRemainingVertices = remainingFace.vertex_indices.size();
+    bool IsEar(size_t ear) const
+    {
+        const size_t a = m_prev[ear];
+        const size_t c = m_next[ear];
+        // Flat corners are clipped too, like the original loop does
+        if (Turn(a, ear, c) < 0)
+        {
+            return false;
+        }
 
-                while (remainingFace.vertex_indices.size() > 3 && remainingIterations > 0)
+        const size_t x0 = CellCoordinate((std::min)((std::min)(m_x[a], m_x[ear]), m_x[c]), m_min_x, m_cell_scale_x);
+        const size_t x1 = CellCoordinate((std::max)((std::max)(m_x[a], m_x[ear]), m_x[c]), m_min_x, m_cell_scale_x);
+        const size_t y0 = CellCoordinate((std::min)((std::min)(m_y[a], m_y[ear]), m_y[c]), m_min_y, m_cell_scale_y);
+        const size_t y1 = CellCoordinate((std::max)((std::max)(m_y[a], m_y[ear]), m_y[c]), m_min_y, m_cell_scale_y);
+        for (size_t y = y0; y <= y1; ++y)
+        {
+            for (size_t x = x0; x <= x1; ++x)
+            {
+                const size_t cell = y * m_grid_size + x;
+                for (size_t k = m_cell_start[cell]; k < m_cell_start[cell + 1]; ++k)
                 {
-                    npolys = remainingFace.vertex_indices.size();
-                    if (guess_vert >= npolys)
+                    if (Blocks(m_cell_corners[k], a, ear, c))
                     {
-                        guess_vert -= npolys;
+                        return false;
                     }
+                }
+            }
+        }
+        return true;
+    }
 
-                    if (previousRemainingVertices != npolys)
-                    {
-                        // The number of remaining vertices decreased. Reset counters.
-                        previousRemainingVertices = npolys;
-                        remainingIterations = npolys;
-                    }
-                    else
-                    {
-                        // We didn't consume a vertex on previous iteration, reduce the
-                        // available iterations.
-                        remainingIterations--;
-                    }
+    void Emit(size_t ear, std::vector<size_t>* corners) const
+    {
+        corners->push_back(m_prev[ear]);
+        corners->push_back(ear);
+        corners->push_back(m_next[ear]);
+    }
 
-                    for (size_t k = 0; k < 3; k++)
-                    {
-                        ind[k] = remainingFace.vertex_indices[(guess_vert + k) % npolys];
-                        size_t vi = size_t(ind[k].v_idx);
-                        if (((vi * 3 + axes[0]) >= v.size()) || ((vi * 3 + axes[1]) >= v.size()))
-                        {
-                            // ???
-                            vx[k] = static_cast<real_t>(0.0);
-                            vy[k] = static_cast<real_t>(0.0);
-                        }
-                        else
-                        {
-                            vx[k] = v[vi * 3 + axes[0]];
-                            vy[k] = v[vi * 3 + axes[1]];
-                        }
-                    }
-                    real_t e0x = vx[1] - vx[0];
-                    real_t e0y = vy[1] - vy[0];
-                    real_t e1x = vx[2] - vx[1];
-                    real_t e1y = vy[2] - vy[1];
-                    real_t cross = e0x * e1y - e0y * e1x;
-                    // if an internal angle
-                    if (cross * area < static_cast<real_t>(0.0))
-                    {
-                        guess_vert += 1;
-                        continue;
-                    }
+    real_t m_sign;
+    std::vector<real_t> m_x;
+    std::vector<real_t> m_y;
+    std::vector<size_t> m_prev;
+    std::vector<size_t> m_next;
+    std::vector<bool> m_removed;
+    real_t m_min_x;
+    real_t m_max_x;
+    real_t m_min_y;
+    real_t m_max_y;
+    size_t m_grid_size;
+    real_t m_cell_scale_x;
+    real_t m_cell_scale_y;
+    std::vector<size_t> m_cell_start;
+    std::vector<size_t> m_cell_corners;
+};
 
-                    // check all other verts in case they are inside this triangle
-                    bool overlap = false;
-                    for (size_t otherVert = 3; otherVert < npolys; ++otherVert)
-                    {
-                        size_t idx = (guess_vert + otherVert) % npolys;
+} // namespace
 
-                        if (idx >= remainingFace.vertex_indices.size())
-                        {
-                            // ???
-                            continue;
-                        }
+size_t
+TriangulateFace(const index_t* face, size_t num_indices, const real_t* v, size_t v_size, std::vector<index_t>* triangles)
+{
+    size_t npolys = num_indices;
+    size_t num_triangles = 0;
 
-                        size_t ovi = size_t(remainingFace.vertex_indices[idx].v_idx);
+    if (npolys < 3)
+    {
+        // Face must have 3+ vertices.
+        return 0;
+    }
 
-                        if (((ovi * 3 + axes[0]) >= v.size()) || ((ovi * 3 + axes[1]) >= v.size()))
-                        {
-                            // ???
-                            continue;
-                        }
-                        real_t tx = v[ovi * 3 + axes[0]];
-                        real_t ty = v[ovi * 3 + axes[1]];
-                        if (pnpoly(3, vx, vy, tx, ty))
-                        {
-                            overlap = true;
-                            break;
-                        }
-                    }
+    if (npolys == 3)
+    {
+        triangles->push_back(face[0]);
+        triangles->push_back(face[1]);
+        triangles->push_back(face[2]);
+        return 1;
+    }
 
-                    if (overlap)
-                    {
-                        guess_vert += 1;
-                        continue;
-                    }
+    index_t i0 = face[0];
+    index_t i1 = face[1];
+    index_t i2 = face[2];
 
-                    // this triangle is an ear
-                    {
-                        index_t idx0, idx1, idx2;
-                        idx0.vertex_index = ind[0].v_idx;
-                        idx0.normal_index = ind[0].vn_idx;
-                        idx0.texcoord_index = ind[0].vt_idx;
-                        idx1.vertex_index = ind[1].v_idx;
-                        idx1.normal_index = ind[1].vn_idx;
-                        idx1.texcoord_index = ind[1].vt_idx;
-                        idx2.vertex_index = ind[2].v_idx;
-                        idx2.normal_index = ind[2].vn_idx;
-                        idx2.texcoord_index = ind[2].vt_idx;
-
-                        shape->mesh.indices.push_back(idx0);
-                        shape->mesh.indices.push_back(idx1);
-                        shape->mesh.indices.push_back(idx2);
-
-                        shape->mesh.num_face_vertices.push_back(3);
-                        shape->mesh.material_ids.push_back(material_id);
-                        shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
-                    }
+    // find the two axes to work in
+    size_t axes[2] = { 1, 2 };
+    for (size_t k = 0; k < npolys; ++k)
+    {
+        i0 = face[(k + 0) % npolys];
+        i1 = face[(k + 1) % npolys];
+        i2 = face[(k + 2) % npolys];
+        size_t vi0 = size_t(i0.vertex_index);
+        size_t vi1 = size_t(i1.vertex_index);
+        size_t vi2 = size_t(i2.vertex_index);
+
+        if (((3 * vi0 + 2) >= v_size) || ((3 * vi1 + 2) >= v_size) || ((3 * vi2 + 2) >= v_size))
+        {
+            // Invalid triangle.
+            // FIXME(syoyo): Is it ok to simply skip this invalid triangle?
+            continue;
+        }
+        real_t v0x = v[vi0 * 3 + 0];
+        real_t v0y = v[vi0 * 3 + 1];
+        real_t v0z = v[vi0 * 3 + 2];
+        real_t v1x = v[vi1 * 3 + 0];
+        real_t v1y = v[vi1 * 3 + 1];
+        real_t v1z = v[vi1 * 3 + 2];
+        real_t v2x = v[vi2 * 3 + 0];
+        real_t v2y = v[vi2 * 3 + 1];
+        real_t v2z = v[vi2 * 3 + 2];
+        real_t e0x = v1x - v0x;
+        real_t e0y = v1y - v0y;
+        real_t e0z = v1z - v0z;
+        real_t e1x = v2x - v1x;
+        real_t e1y = v2y - v1y;
+        real_t e1z = v2z - v1z;
+        real_t cx = std::fabs(e0y * e1z - e0z * e1y);
+        real_t cy = std::fabs(e0z * e1x - e0x * e1z);
+        real_t cz = std::fabs(e0x * e1y - e0y * e1x);
+        const real_t epsilon = std::numeric_limits<real_t>::epsilon();
+        if (cx > epsilon || cy > epsilon || cz > epsilon)
+        {
+            // found a corner
+            if (cx > cy && cx > cz)
+            {
+            }
+            else
+            {
+                axes[0] = 0;
+                if (cz > cx && cz > cy)
+                    axes[1] = 1;
+            }
+            break;
+        }
+    }
 
-                    // remove v1 from the list
-                    size_t removed_vert_index = (guess_vert + 1) % npolys;
-                    while (removed_vert_index + 1 < npolys)
-                    {
-                        remainingFace.vertex_indices[removed_vert_index] = remainingFace.vertex_indices[removed_vert_index + 1];
-                        removed_vert_index += 1;
-                    }
-                    remainingFace.vertex_indices.pop_back();
+    if (npolys > kMaxLegacyTriangulationCorners)
+    {
+        // One corner says little about the plane of a large face, and the
+        // epsilon above is absolute, so it misses the finely divided curves
+        // large faces often have. Use the whole outline instead.
+        FindPolygonAxes(face, npolys, v, v_size, axes);
+    }
+
+    real_t area = 0;
+    for (size_t k = 0; k < npolys; ++k)
+    {
+        i0 = face[(k + 0) % npolys];
+        i1 = face[(k + 1) % npolys];
+        size_t vi0 = size_t(i0.vertex_index);
+        size_t vi1 = size_t(i1.vertex_index);
+        if (((vi0 * 3 + axes[0]) >= v_size) || ((vi0 * 3 + axes[1]) >= v_size) || ((vi1 * 3 + axes[0]) >= v_size) ||
+            ((vi1 * 3 + axes[1]) >= v_size))
+        {
+            // Invalid index.
+            continue;
+        }
+        real_t v0x = v[vi0 * 3 + axes[0]];
+        real_t v0y = v[vi0 * 3 + axes[1]];
+        real_t v1x = v[vi1 * 3 + axes[0]];
+        real_t v1y = v[vi1 * 3 + axes[1]];
+        area += (v0x * v1y - v0y * v1x) * static_cast<real_t>(0.5);
+    }
+
+    // Fast paths need every corner to have a finite position
+    std::vector<real_t> xy(2 * npolys);
+    bool projected = true;
+    for (size_t k = 0; k < npolys && projected; ++k)
+    {
+        size_t vi = size_t(face[k].vertex_index);
+        projected = (vi * 3 + 2) < v_size;
+        if (projected)
+        {
+            xy[2 * k] = v[vi * 3 + axes[0]];
+            xy[2 * k + 1] = v[vi * 3 + axes[1]];
+            projected = std::isfinite(xy[2 * k]) && std::isfinite(xy[2 * k + 1]);
+        }
+    }
+
+    if (projected && area != 0)
+    {
+        if (IsConvexPolygon(xy.data(), npolys, area))
+        {
+            // What the clipping loop below produces for a convex polygon
+            for (size_t k = 1; k + 1 < npolys; ++k)
+            {
+                triangles->push_back(face[0]);
+                triangles->push_back(face[k]);
+                triangles->push_back(face[k + 1]);
+            }
+            return npolys - 2;
+        }
+
+        if (npolys > kMaxLegacyTriangulationCorners)
+        {
+            std::vector<size_t> corners;
+            corners.reserve(3 * (npolys - 2));
+            ear_clipper_t(xy.data(), npolys, area).Clip(&corners);
+            for (size_t k = 0; k < corners.size(); ++k)
+            {
+                triangles->push_back(face[corners[k]]);
+            }
+            return corners.size() / 3;
+        }
+    }
+
+
+    std::vector<index_t> remainingFace(face, face + num_indices); // copy
+    size_t guess_vert = 0;
+    index_t ind[3];
+    real_t vx[3];
+    real_t vy[3];
+
+    // How many iterations can we do without decreasing the remaining
+    // vertices.
+    size_t remainingIterations = num_indices;
+    size_t previousRemainingVertices = remainingFace.size();
+
+    while (remainingFace.size() > 3 && remainingIterations > 0)
+    {
+        npolys = remainingFace.size();
+        if (guess_vert >= npolys)
+        {
+            guess_vert -= npolys;
+        }
+
+        if (previousRemainingVertices != npolys)
+        {
+            // The number of remaining vertices decreased. Reset counters.
+            previousRemainingVertices = npolys;
+            remainingIterations = npolys;
+        }
+        else
+        {
+            // We didn't consume a vertex on previous iteration, reduce the
+            // available iterations.
+            remainingIterations--;
+        }
+
+        for (size_t k = 0; k < 3; k++)
+        {
+            ind[k] = remainingFace[(guess_vert + k) % npolys];
+            size_t vi = size_t(ind[k].vertex_index);
+            if (((vi * 3 + axes[0]) >= v_size) || ((vi * 3 + axes[1]) >= v_size))
+            {
+                // ???
+                vx[k] = static_cast<real_t>(0.0);
+                vy[k] = static_cast<real_t>(0.0);
+            }
+            else
+            {
+                vx[k] = v[vi * 3 + axes[0]];
+                vy[k] = v[vi * 3 + axes[1]];
+            }
+        }
+        real_t e0x = vx[1] - vx[0];
+        real_t e0y = vy[1] - vy[0];
+        real_t e1x = vx[2] - vx[1];
+        real_t e1y = vy[2] - vy[1];
+        real_t cross = e0x * e1y - e0y * e1x;
+        // if an internal angle
+        if (cross * area < static_cast<real_t>(0.0))
+        {
+            guess_vert += 1;
+            continue;
+        }
+
+        // check all other verts in case they are inside this triangle
+        bool overlap = false;
+        for (size_t otherVert = 3; otherVert < npolys; ++otherVert)
+        {
+            size_t idx = (guess_vert + otherVert) % npolys;
+
+            if (idx >= remainingFace.size())
+            {
+                // ???
+                continue;
+            }
+
+            size_t ovi = size_t(remainingFace[idx].vertex_index);
+
+            if (((ovi * 3 + axes[0]) >= v_size) || ((ovi * 3 + axes[1]) >= v_size))
+            {
+                // ???
+                continue;
+            }
+            real_t tx = v[ovi * 3 + axes[0]];
+            real_t ty = v[ovi * 3 + axes[1]];
+            if (pnpoly(3, vx, vy, tx, ty))
+            {
+                overlap = true;
+                break;
+            }
+        }
+
+        if (overlap)
+        {
+            guess_vert += 1;
+            continue;
+        }
+
+        // this triangle is an ear
+        triangles->push_back(ind[0]);
+        triangles->push_back(ind[1]);
+        triangles->push_back(ind[2]);
+        num_triangles++;
+
+        // remove v1 from the list
+        size_t removed_vert_index = (guess_vert + 1) % npolys;
+        while (removed_vert_index + 1 < npolys)
+        {
+            remainingFace[removed_vert_index] = remainingFace[removed_vert_index + 1];
+            removed_vert_index += 1;
+        }
+        remainingFace.pop_back();
+    }
+
+    if (remainingFace.size() == 3)
+    {
+        triangles->push_back(remainingFace[0]);
+        triangles->push_back(remainingFace[1]);
+        triangles->push_back(remainingFace[2]);
+        num_triangles++;
+    }
+
+    return num_triangles;
+}
+
+// TODO(syoyo): refactor function.
+static bool
+exportGroupsToShape(shape_t* shape, const face_group_t& faceGroup, std::vector<int>& lineGroup, const std::vector<tag_t>& tags,
+                    const int material_id, const std::string& name, bool triangulate, const std::vector<real_t>& v)
+{
+    if (faceGroup.empty() && lineGroup.empty())
+    {
+        return false;
+    }
+
+    if (!faceGroup.empty())
+    {
+        std::vector<index_t> polygon;
+
+        // Flatten vertices and indices
+        for (size_t i = 0; i < faceGroup.size(); i++)
+        {
+            const face_t& face = faceGroup[i];
+
+            size_t npolys = face.vertex_indices.size();
+
+            if (npolys < 3)
+            {
+                // Face must have 3+ vertices.
+                continue;
+            }
+
+            if (triangulate)
+            {
+                polygon.resize(npolys);
+                for (size_t k = 0; k < npolys; k++)
+                {
+                    polygon[k].vertex_index = face.vertex_indices[k].v_idx;
+                    polygon[k].normal_index = face.vertex_indices[k].vn_idx;
+                    polygon[k].texcoord_index = face.vertex_indices[k].vt_idx;
                 }
 
-                if (remainingFace.vertex_indices.size() == 3)
+                size_t num_triangles = TriangulateFace(&polygon.at(0), npolys, v.data(), v.size(), &shape->mesh.indices);
+                for (size_t k = 0; k < num_triangles; k++)
                 {
-                    i0 = remainingFace.vertex_indices[0];
-                    i1 = remainingFace.vertex_indices[1];
-                    i2 = remainingFace.vertex_indices[2];
-                    {
-                        index_t idx0, idx1, idx2;
-                        idx0.vertex_index = i0.v_idx;
-                        idx0.normal_index = i0.vn_idx;
-                        idx0.texcoord_index = i0.vt_idx;
-                        idx1.vertex_index = i1.v_idx;
-                        idx1.normal_index = i1.vn_idx;
-                        idx1.texcoord_index = i1.vt_idx;
-                        idx2.vertex_index = i2.v_idx;
-                        idx2.normal_index = i2.vn_idx;
-                        idx2.texcoord_index = i2.vt_idx;
-
-                        shape->mesh.indices.push_back(idx0);
-                        shape->mesh.indices.push_back(idx1);
-                        shape->mesh.indices.push_back(idx2);
-
-                        shape->mesh.num_face_vertices.push_back(3);
-                        shape->mesh.material_ids.push_back(material_id);
-                        shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
-                    }
+                    shape->mesh.num_face_vertices.push_back(3);
+                    shape->mesh.material_ids.push_back(material_id);
+                    shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
                 }
             }
             else
@@ -1509,9 +2558,12 @@ LoadMtl(std::map<std::string, int>* material_map, std::vector<material_t>* mater
 
     size_t line_no = 0;
     std::string linebuf;
-    while (inStream->peek() != -1)
+    StreamLineReader lineReader(*inStream);
+    const char* line = NULL;
+    size_t line_len = 0;
+    while (lineReader.next(&line, &line_len))
     {
-        safeGetline(*inStream, linebuf);
+        linebuf.assign(line, line_len);
         line_no++;
 
         // Trim trailing whitespace.
@@ -1948,6 +3000,76 @@ MaterialStreamReader::operator()(const std::string& matId, std::vector<material_
     return true;
 }
 
+void
+MaterialCacheReader::AddLibrary(const std::string& name, const char* buf, size_t buf_len)
+{
+    std::shared_ptr<entry_t> entry = std::make_shared<entry_t>();
+    entry->source.assign(buf, buf_len);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_libraries[name] = entry;
+}
+
+std::shared_ptr<const material_library_t>
+MaterialCacheReader::GetLibrary(const std::string& name)
+{
+    std::shared_ptr<entry_t> entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::map<std::string, std::shared_ptr<entry_t> >::const_iterator it = m_libraries.find(name);
+        if (it == m_libraries.end())
+        {
+            return std::shared_ptr<const material_library_t>();
+        }
+        entry = it->second;
+    }
+
+    // Parsed outside the lock, loads of other libraries are not held up.
+    // Concurrent first uses of the same library wait for a single parse.
+    std::call_once(entry->parsed_flag,
+                   [&entry]()
+                   {
+                       std::shared_ptr<material_library_t> library = std::make_shared<material_library_t>();
+                       std::istringstream stream(entry->source);
+                       // Only the parsed form is used from now on
+                       std::string().swap(entry->source);
+                       LoadMtl(&library->material_map, &library->materials, &stream, &library->warn, NULL);
+                       entry->parsed = library;
+                   });
+    return entry->parsed;
+}
+
+bool
+MaterialCacheReader::operator()(const std::string& matId, std::vector<material_t>* materials, std::map<std::string, int>* matMap,
+                                std::string* warn, std::string* err)
+{
+    (void)err;
+    std::shared_ptr<const material_library_t> library = GetLibrary(matId);
+    if (!library)
+    {
+        if (warn)
+        {
+            (*warn) += "Material library [ " + matId + " ] not found.\n";
+        }
+        return false;
+    }
+
+    // Same result as LoadMtl on the text: indices follow the materials
+    // already loaded and earlier names win.
+    const int offset = static_cast<int>(materials->size());
+    materials->insert(materials->end(), library->materials.begin(), library->materials.end());
+    for (std::map<std::string, int>::const_iterator it = library->material_map.begin(); it != library->material_map.end(); ++it)
+    {
+        matMap->insert(std::pair<std::string, int>(it->first, it->second + offset));
+    }
+    if (warn)
+    {
+        (*warn) += library->warn;
+    }
+
+    return true;
+}
+
 bool
 LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn, std::string* err,
         const char* filename, const char* mtl_basedir, bool trianglulate, bool default_vcols_fallback)
@@ -1987,482 +3109,537 @@ LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>*
     return LoadObj(attrib, shapes, materials, warn, err, &ifs, &matFileReader, trianglulate, default_vcols_fallback);
 }
 
-bool
-LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn, std::string* err,
-        std::istream* inStream, MaterialReader* readMatFn /*= NULL*/, bool triangulate, bool default_vcols_fallback)
+// Parser state shared by LoadObj, LoadObjFromBuffer and the merge step of
+// LoadObjFromBufferParallel.
+struct obj_load_state
 {
-    std::stringstream errss;
+    obj_load_state(std::vector<shape_t>* shapes_, std::vector<material_t>* materials_, std::string* warn_, std::string* err_,
+                   MaterialReader* readMatFn_, bool triangulate_, bool default_vcols_fallback_)
+        : material(-1),
+          current_smoothing_id(0),
+          greatest_v_idx(-1),
+          greatest_vn_idx(-1),
+          greatest_vt_idx(-1),
+          found_all_colors(true),
+          line_num(0),
+          shapes(shapes_),
+          materials(materials_),
+          warn(warn_),
+          err(err_),
+          readMatFn(readMatFn_),
+          triangulate(triangulate_),
+          default_vcols_fallback(default_vcols_fallback_)
+    {
+    }
 
     std::vector<real_t> v;
     std::vector<real_t> vn;
     std::vector<real_t> vt;
     std::vector<real_t> vc;
     std::vector<tag_t> tags;
-    std::vector<face_t> faceGroup;
+    face_group_t faceGroup;
     std::vector<int> lineGroup;
     std::string name;
 
     // material
     std::map<std::string, int> material_map;
-    int material = -1;
+    int material;
 
     // smoothing group id
-    unsigned int current_smoothing_id = 0; // Initial value. 0 means no smoothing.
+    unsigned int current_smoothing_id; // Initial value. 0 means no smoothing.
 
-    int greatest_v_idx = -1;
-    int greatest_vn_idx = -1;
-    int greatest_vt_idx = -1;
+    int greatest_v_idx;
+    int greatest_vn_idx;
+    int greatest_vt_idx;
 
     shape_t shape;
 
-    bool found_all_colors = true;
+    bool found_all_colors;
 
-    size_t line_num = 0;
-    std::string linebuf;
-    while (inStream->peek() != -1)
-    {
-        safeGetline(*inStream, linebuf);
+    // Number of the line being parsed, for messages.
+    size_t line_num;
 
-        line_num++;
+    std::vector<shape_t>* shapes;
+    std::vector<material_t>* materials;
+    std::string* warn;
+    std::string* err;
+    MaterialReader* readMatFn;
+    bool triangulate;
+    bool default_vcols_fallback;
+};
 
-        // Trim newline '\r\n' or '\n'
-        if (linebuf.size() > 0)
+// Parses the argument of an 's' line, token points past the "s ". Leaves
+// *smoothing_id unchanged if the line has no argument.
+static void
+parseSmoothingGroup(const char* token, const char* line_end, unsigned int* smoothing_id)
+{
+    // skip space.
+    token += strspn(token, " \t"); // skip space
+
+    if (IS_NEW_LINE(token[0]))
+    {
+        return;
+    }
+
+    if ((line_end - token) >= 3)
+    {
+        if (token[0] == 'o' && token[1] == 'f' && token[2] == 'f')
         {
-            if (linebuf[linebuf.size() - 1] == '\n')
-                linebuf.erase(linebuf.size() - 1);
+            (*smoothing_id) = 0;
         }
-        if (linebuf.size() > 0)
+    }
+    else
+    {
+        // assume number
+        int smGroupId = parseInt(&token);
+        if (smGroupId < 0)
         {
-            if (linebuf[linebuf.size() - 1] == '\r')
-                linebuf.erase(linebuf.size() - 1);
+            // parse error. force set to 0.
+            // FIXME(syoyo): Report warning.
+            (*smoothing_id) = 0;
         }
-
-        // Skip if empty line.
-        if (linebuf.empty())
+        else
         {
-            continue;
+            (*smoothing_id) = static_cast<unsigned int>(smGroupId);
         }
+    }
+}
 
-        // Skip leading space.
-        const char* token = linebuf.c_str();
-        token += strspn(token, " \t");
+// Parses a single line, given without its line ending. Returns false on a
+// fatal parse error, which has already been appended to st->err.
+static bool
+parseObjLine(obj_load_state* st, const char* line, size_t line_len)
+{
+    std::vector<real_t>& v = st->v;
+    std::vector<real_t>& vn = st->vn;
+    std::vector<real_t>& vt = st->vt;
+    std::vector<real_t>& vc = st->vc;
+    std::vector<tag_t>& tags = st->tags;
+    face_group_t& faceGroup = st->faceGroup;
+    std::vector<int>& lineGroup = st->lineGroup;
+    std::string& name = st->name;
+    std::map<std::string, int>& material_map = st->material_map;
+    int& material = st->material;
+    unsigned int& current_smoothing_id = st->current_smoothing_id;
+    int& greatest_v_idx = st->greatest_v_idx;
+    int& greatest_vn_idx = st->greatest_vn_idx;
+    int& greatest_vt_idx = st->greatest_vt_idx;
+    shape_t& shape = st->shape;
+    bool& found_all_colors = st->found_all_colors;
+
+    std::vector<shape_t>* shapes = st->shapes;
+    std::vector<material_t>* materials = st->materials;
+    std::string* warn = st->warn;
+    std::string* err = st->err;
+    MaterialReader* readMatFn = st->readMatFn;
+    const bool triangulate = st->triangulate;
+    const bool default_vcols_fallback = st->default_vcols_fallback;
+    const size_t line_num = st->line_num;
+
+    // Skip if empty line.
+    if (line_len == 0)
+    {
+        return true;
+    }
 
-        assert(token);
-        if (token[0] == '\0')
-            continue; // empty line
+    // The line is not necessarily NUL-terminated, use line_end instead of
+    // reading up to '\0'.
+    const char* line_end = line + line_len;
 
-        if (token[0] == '#')
-            continue; // comment line
+    // Skip leading space.
+    const char* token = line;
+    token += strspn(token, " \t");
 
-        // vertex
-        if (token[0] == 'v' && IS_SPACE((token[1])))
-        {
-            token += 2;
-            real_t x, y, z;
-            real_t r, g, b;
+    assert(token);
+    if (IS_NEW_LINE(token[0]))
+        return true; // empty line
 
-            found_all_colors &= parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+    if (token[0] == '#')
+        return true; // comment line
 
-            v.push_back(x);
-            v.push_back(y);
-            v.push_back(z);
+    // vertex
+    if (token[0] == 'v' && IS_SPACE((token[1])))
+    {
+        token += 2;
+        real_t x, y, z;
+        real_t r, g, b;
 
-            if (found_all_colors || default_vcols_fallback)
-            {
-                vc.push_back(r);
-                vc.push_back(g);
-                vc.push_back(b);
-            }
+        found_all_colors &= parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
 
-            continue;
-        }
+        v.push_back(x);
+        v.push_back(y);
+        v.push_back(z);
 
-        // normal
-        if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2])))
+        if (found_all_colors || default_vcols_fallback)
         {
-            token += 3;
-            real_t x, y, z;
-            parseReal3(&x, &y, &z, &token);
-            vn.push_back(x);
-            vn.push_back(y);
-            vn.push_back(z);
-            continue;
+            vc.push_back(r);
+            vc.push_back(g);
+            vc.push_back(b);
         }
 
-        // texcoord
-        if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2])))
-        {
-            token += 3;
-            real_t x, y;
-            parseReal2(&x, &y, &token);
-            vt.push_back(x);
-            vt.push_back(y);
-            continue;
-        }
-
-        // line
-        if (token[0] == 'l' && IS_SPACE((token[1])))
-        {
-            token += 2;
+        return true;
+    }
 
-            line_t line_cache;
-            bool end_line_bit = 0;
-            while (!IS_NEW_LINE(token[0]))
-            {
-                // get index from string
-                int idx;
-                fixIndex(parseInt(&token), 0, &idx);
+    // normal
+    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2])))
+    {
+        token += 3;
+        real_t x, y, z;
+        parseReal3(&x, &y, &z, &token);
+        vn.push_back(x);
+        vn.push_back(y);
+        vn.push_back(z);
+        return true;
+    }
 
-                size_t n = strspn(token, " \t\r");
-                token += n;
+    // texcoord
+    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2])))
+    {
+        token += 3;
+        real_t x, y;
+        parseReal2(&x, &y, &token);
+        vt.push_back(x);
+        vt.push_back(y);
+        return true;
+    }
 
-                if (!end_line_bit)
-                {
-                    line_cache.idx0 = idx;
-                }
-                else
-                {
-                    line_cache.idx1 = idx;
-                    lineGroup.push_back(line_cache.idx0);
-                    lineGroup.push_back(line_cache.idx1);
-                    line_cache = line_t();
-                }
-                end_line_bit = !end_line_bit;
-            }
+    // line
+    if (token[0] == 'l' && IS_SPACE((token[1])))
+    {
+        token += 2;
 
-            continue;
-        }
-        // face
-        if (token[0] == 'f' && IS_SPACE((token[1])))
+        line_t line_cache;
+        bool end_line_bit = 0;
+        while (!IS_NEW_LINE(token[0]))
         {
-            token += 2;
-            token += strspn(token, " \t");
-
-            face_t face;
+            // get index from string
+            int idx;
+            const bool valid = fixIndex(parseInt(&token), 0, &idx);
 
-            face.smoothing_group_id = current_smoothing_id;
-            face.vertex_indices.reserve(3);
+            size_t n = strspn(token, " \t");
+            token += n;
 
-            while (!IS_NEW_LINE(token[0]))
+            if (!valid)
             {
-                vertex_index_t vi;
-                if (!parseTriple(&token, static_cast<int>(v.size() / 3), static_cast<int>(vn.size() / 3), static_cast<int>(vt.size() / 2),
-                                 &vi))
-                {
-                    if (err)
-                    {
-                        std::stringstream ss;
-                        ss << "Failed parse `f' line(e.g. zero value for face index. line " << line_num << ".)\n";
-                        (*err) += ss.str();
-                    }
-                    return false;
-                }
-
-                greatest_v_idx = greatest_v_idx > vi.v_idx ? greatest_v_idx : vi.v_idx;
-                greatest_vn_idx = greatest_vn_idx > vi.vn_idx ? greatest_vn_idx : vi.vn_idx;
-                greatest_vt_idx = greatest_vt_idx > vi.vt_idx ? greatest_vt_idx : vi.vt_idx;
-
-                face.vertex_indices.push_back(vi);
-                size_t n = strspn(token, " \t\r");
-                token += n;
+                // Zero, or no number at all, is not an index. Skip it
+                // instead of storing an unset value.
+                continue;
             }
 
-            // replace with emplace_back + std::move on C++11
-            faceGroup.push_back(face);
-
-            continue;
-        }
-
-        // use mtl
-        if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6])))
-        {
-            token += 7;
-            std::stringstream ss;
-            ss << token;
-            std::string namebuf = ss.str();
-
-            int newMaterialId = -1;
-            if (material_map.find(namebuf) != material_map.end())
+            if (!end_line_bit)
             {
-                newMaterialId = material_map[namebuf];
+                line_cache.idx0 = idx;
             }
             else
             {
-                // { error!! material not found }
-            }
-
-            if (newMaterialId != material)
-            {
-                // Create per-face material. Thus we don't add `shape` to `shapes` at
-                // this time.
-                // just clear `faceGroup` after `exportGroupsToShape()` call.
-                exportGroupsToShape(&shape, faceGroup, lineGroup, tags, material, name, triangulate, v);
-                faceGroup.clear();
-                material = newMaterialId;
+                line_cache.idx1 = idx;
+                lineGroup.push_back(line_cache.idx0);
+                lineGroup.push_back(line_cache.idx1);
+                line_cache = line_t();
             }
-
-            continue;
+            end_line_bit = !end_line_bit;
         }
 
-        // load mtl
-        if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6])))
-        {
-            if (readMatFn)
-            {
-                token += 7;
+        return true;
+    }
+    // face
+    if (token[0] == 'f' && IS_SPACE((token[1])))
+    {
+        token += 2;
+        token += strspn(token, " \t");
 
-                std::vector<std::string> filenames;
-                SplitString(std::string(token), ' ', filenames);
+        // Built in place, a copy would allocate its indices a second time.
+        faceGroup.push_back(face_t());
+        face_t& face = faceGroup.back();
 
-                if (filenames.empty())
-                {
-                    if (warn)
-                    {
-                        std::stringstream ss;
-                        ss << "Looks like empty filename for mtllib. Use default "
-                              "material (line "
-                           << line_num << ".)\n";
+        face.smoothing_group_id = current_smoothing_id;
+        face.vertex_indices.reserve(3);
 
-                        (*warn) += ss.str();
-                    }
-                }
-                else
+        while (!IS_NEW_LINE(token[0]))
+        {
+            vertex_index_t vi;
+            if (!parseTriple(&token, static_cast<int>(v.size() / 3), static_cast<int>(vn.size() / 3), static_cast<int>(vt.size() / 2),
+                             &vi))
+            {
+                if (err)
                 {
-                    bool found = false;
-                    for (size_t s = 0; s < filenames.size(); s++)
-                    {
-                        std::string warn_mtl;
-                        std::string err_mtl;
-                        bool ok = (*readMatFn)(filenames[s].c_str(), materials, &material_map, &warn_mtl, &err_mtl);
-                        if (warn && (!warn_mtl.empty()))
-                        {
-                            (*warn) += warn_mtl;
-                        }
-
-                        if (err && (!err_mtl.empty()))
-                        {
-                            (*err) += err_mtl;
-                        }
-
-                        if (ok)
-                        {
-                            found = true;
-                            break;
-                        }
-                    }
-
-                    if (!found)
-                    {
-                        if (warn)
-                        {
-                            (*warn) += "Failed to load material file(s). Use default "
-                                       "material.\n";
-                        }
-                    }
+                    std::stringstream ss;
+                    ss << "Failed parse `f' line(e.g. zero value for face index. line " << line_num << ".)\n";
+                    (*err) += ss.str();
                 }
+                return false;
             }
 
-            continue;
+            greatest_v_idx = greatest_v_idx > vi.v_idx ? greatest_v_idx : vi.v_idx;
+            greatest_vn_idx = greatest_vn_idx > vi.vn_idx ? greatest_vn_idx : vi.vn_idx;
+            greatest_vt_idx = greatest_vt_idx > vi.vt_idx ? greatest_vt_idx : vi.vt_idx;
+
+            face.vertex_indices.push_back(vi);
+            size_t n = strspn(token, " \t");
+            token += n;
         }
 
-        // group name
-        if (token[0] == 'g' && IS_SPACE((token[1])))
-        {
-            // flush previous face group.
-            bool ret = exportGroupsToShape(&shape, faceGroup, lineGroup, tags, material, name, triangulate, v);
-            (void)ret; // return value not used.
+        return true;
+    }
 
-            if (shape.mesh.indices.size() > 0)
-            {
-                shapes->push_back(shape);
-            }
+    // use mtl
+    if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6])))
+    {
+        token += 7;
+        std::string namebuf(token, line_end);
 
-            shape = shape_t();
+        int newMaterialId = -1;
+        if (material_map.find(namebuf) != material_map.end())
+        {
+            newMaterialId = material_map[namebuf];
+        }
+        else
+        {
+            // { error!! material not found }
+        }
 
-            // material = -1;
+        if (newMaterialId != material)
+        {
+            // Create per-face material. Thus we don't add `shape` to `shapes` at
+            // this time.
+            // just clear `faceGroup` after `exportGroupsToShape()` call.
+            exportGroupsToShape(&shape, faceGroup, lineGroup, tags, material, name, triangulate, v);
             faceGroup.clear();
+            material = newMaterialId;
+        }
 
-            std::vector<std::string> names;
+        return true;
+    }
 
-            while (!IS_NEW_LINE(token[0]))
-            {
-                std::string str = parseString(&token);
-                names.push_back(str);
-                token += strspn(token, " \t\r"); // skip tag
-            }
+    // load mtl
+    if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6])))
+    {
+        if (readMatFn)
+        {
+            token += 7;
 
-            // names[0] must be 'g'
+            std::vector<std::string> filenames;
+            SplitString(std::string(token, line_end), ' ', filenames);
 
-            if (names.size() < 2)
+            if (filenames.empty())
             {
-                // 'g' with empty names
                 if (warn)
                 {
                     std::stringstream ss;
-                    ss << "Empty group name. line: " << line_num << "\n";
+                    ss << "Looks like empty filename for mtllib. Use default "
+                          "material (line "
+                       << line_num << ".)\n";
+
                     (*warn) += ss.str();
-                    name = "";
                 }
             }
             else
             {
-                std::stringstream ss;
-                ss << names[1];
+                bool found = false;
+                for (size_t s = 0; s < filenames.size(); s++)
+                {
+                    std::string warn_mtl;
+                    std::string err_mtl;
+                    bool ok = (*readMatFn)(filenames[s].c_str(), materials, &material_map, &warn_mtl, &err_mtl);
+                    if (warn && (!warn_mtl.empty()))
+                    {
+                        (*warn) += warn_mtl;
+                    }
 
-                // tinyobjloader does not support multiple groups for a primitive.
-                // Currently we concatinate multiple group names with a space to get
-                // single group name.
+                    if (err && (!err_mtl.empty()))
+                    {
+                        (*err) += err_mtl;
+                    }
 
-                for (size_t i = 2; i < names.size(); i++)
-                {
-                    ss << " " << names[i];
+                    if (ok)
+                    {
+                        found = true;
+                        break;
+                    }
                 }
 
-                name = ss.str();
+                if (!found)
+                {
+                    if (warn)
+                    {
+                        (*warn) += "Failed to load material file(s). Use default "
+                                   "material.\n";
+                    }
+                }
             }
+        }
 
-            continue;
+        return true;
+    }
+
+    // group name
+    if (token[0] == 'g' && IS_SPACE((token[1])))
+    {
+        // flush previous face group.
+        bool ret = exportGroupsToShape(&shape, faceGroup, lineGroup, tags, material, name, triangulate, v);
+        (void)ret; // return value not used.
+
+        if (shape.mesh.indices.size() > 0)
+        {
+            shapes->push_back(shape);
         }
 
-        // object name
-        if (token[0] == 'o' && IS_SPACE((token[1])))
+        shape = shape_t();
+
+        // material = -1;
+        faceGroup.clear();
+
+        std::vector<std::string> names;
+
+        while (!IS_NEW_LINE(token[0]))
+        {
+            std::string str = parseString(&token);
+            names.push_back(str);
+            token += strspn(token, " \t"); // skip tag
+        }
+
+        // names[0] must be 'g'
+
+        if (names.size() < 2)
         {
-            // flush previous face group.
-            bool ret = exportGroupsToShape(&shape, faceGroup, lineGroup, tags, material, name, triangulate, v);
-            if (ret)
+            // 'g' with empty names
+            if (warn)
             {
-                shapes->push_back(shape);
+                std::stringstream ss;
+                ss << "Empty group name. line: " << line_num << "\n";
+                (*warn) += ss.str();
+                name = "";
             }
+        }
+        else
+        {
+            std::stringstream ss;
+            ss << names[1];
 
-            // material = -1;
-            faceGroup.clear();
-            shape = shape_t();
+            // tinyobjloader does not support multiple groups for a primitive.
+            // Currently we concatinate multiple group names with a space to get
+            // single group name.
 
-            // @todo { multiple object name? }
-            token += 2;
-            std::stringstream ss;
-            ss << token;
-            name = ss.str();
+            for (size_t i = 2; i < names.size(); i++)
+            {
+                ss << " " << names[i];
+            }
 
-            continue;
+            name = ss.str();
         }
 
-        if (token[0] == 't' && IS_SPACE(token[1]))
+        return true;
+    }
+
+    // object name
+    if (token[0] == 'o' && IS_SPACE((token[1])))
+    {
+        // flush previous face group.
+        bool ret = exportGroupsToShape(&shape, faceGroup, lineGroup, tags, material, name, triangulate, v);
+        if (ret)
         {
-            const int max_tag_nums = 8192; // FIXME(syoyo): Parameterize.
-            tag_t tag;
+            shapes->push_back(shape);
+        }
 
-            token += 2;
+        // material = -1;
+        faceGroup.clear();
+        shape = shape_t();
 
-            tag.name = parseString(&token);
+        // @todo { multiple object name? }
+        token += 2;
+        name = std::string(token, line_end);
 
-            tag_sizes ts = parseTagTriple(&token);
+        return true;
+    }
 
-            if (ts.num_ints < 0)
-            {
-                ts.num_ints = 0;
-            }
-            if (ts.num_ints > max_tag_nums)
-            {
-                ts.num_ints = max_tag_nums;
-            }
+    if (token[0] == 't' && IS_SPACE(token[1]))
+    {
+        const int max_tag_nums = 8192; // FIXME(syoyo): Parameterize.
+        tag_t tag;
 
-            if (ts.num_reals < 0)
-            {
-                ts.num_reals = 0;
-            }
-            if (ts.num_reals > max_tag_nums)
-            {
-                ts.num_reals = max_tag_nums;
-            }
+        token += 2;
 
-            if (ts.num_strings < 0)
-            {
-                ts.num_strings = 0;
-            }
-            if (ts.num_strings > max_tag_nums)
-            {
-                ts.num_strings = max_tag_nums;
-            }
+        tag.name = parseString(&token);
 
-            tag.intValues.resize(static_cast<size_t>(ts.num_ints));
+        tag_sizes ts = parseTagTriple(&token);
 
-            for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i)
-            {
-                tag.intValues[i] = parseInt(&token);
-            }
+        if (ts.num_ints < 0)
+        {
+            ts.num_ints = 0;
+        }
+        if (ts.num_ints > max_tag_nums)
+        {
+            ts.num_ints = max_tag_nums;
+        }
 
-            tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
-            for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i)
-            {
-                tag.floatValues[i] = parseReal(&token);
-            }
+        if (ts.num_reals < 0)
+        {
+            ts.num_reals = 0;
+        }
+        if (ts.num_reals > max_tag_nums)
+        {
+            ts.num_reals = max_tag_nums;
+        }
 
-            tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
-            for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i)
-            {
-                tag.stringValues[i] = parseString(&token);
-            }
+        if (ts.num_strings < 0)
+        {
+            ts.num_strings = 0;
+        }
+        if (ts.num_strings > max_tag_nums)
+        {
+            ts.num_strings = max_tag_nums;
+        }
 
-            tags.push_back(tag);
+        tag.intValues.resize(static_cast<size_t>(ts.num_ints));
 
-            continue;
+        for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i)
+        {
+            tag.intValues[i] = parseInt(&token);
         }
 
-        if (token[0] == 's' && IS_SPACE(token[1]))
+        tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
+        for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i)
         {
-            // smoothing group id
-            token += 2;
+            tag.floatValues[i] = parseReal(&token);
+        }
 
-            // skip space.
-            token += strspn(token, " \t"); // skip space
+        tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
+        for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i)
+        {
+            tag.stringValues[i] = parseString(&token);
+        }
 
-            if (token[0] == '\0')
-            {
-                continue;
-            }
+        tags.push_back(tag);
 
-            if (token[0] == '\r' || token[1] == '\n')
-            {
-                continue;
-            }
+        return true;
+    }
 
-            if (strlen(token) >= 3)
-            {
-                if (token[0] == 'o' && token[1] == 'f' && token[2] == 'f')
-                {
-                    current_smoothing_id = 0;
-                }
-            }
-            else
-            {
-                // assume number
-                int smGroupId = parseInt(&token);
-                if (smGroupId < 0)
-                {
-                    // parse error. force set to 0.
-                    // FIXME(syoyo): Report warning.
-                    current_smoothing_id = 0;
-                }
-                else
-                {
-                    current_smoothing_id = static_cast<unsigned int>(smGroupId);
-                }
-            }
+    if (token[0] == 's' && IS_SPACE(token[1]))
+    {
+        // smoothing group id
+        parseSmoothingGroup(token + 2, line_end, &current_smoothing_id);
+        return true;
+    }
 
-            continue;
-        } // smoothing group id
+    // Ignore unknown command.
 
-        // Ignore unknown command.
-    }
+    return true;
+}
+
+// Flushes the last shape and moves the parsed attributes into attrib.
+static void
+finishObjLoad(obj_load_state* st, attrib_t* attrib)
+{
+    std::string* warn = st->warn;
+    const size_t line_num = st->line_num;
 
     // not all vertices have colors, no default colors desired? -> clear colors
-    if (!found_all_colors && !default_vcols_fallback)
+    if (!st->found_all_colors && !st->default_vcols_fallback)
     {
-        vc.clear();
+        st->vc.clear();
     }
 
-    if (greatest_v_idx >= static_cast<int>(v.size() / 3))
+    if (st->greatest_v_idx >= static_cast<int>(st->v.size() / 3))
     {
         if (warn)
         {
@@ -2471,7 +3648,7 @@ LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>*
             (*warn) += ss.str();
         }
     }
-    if (greatest_vn_idx >= static_cast<int>(vn.size() / 3))
+    if (st->greatest_vn_idx >= static_cast<int>(st->vn.size() / 3))
     {
         if (warn)
         {
@@ -2480,7 +3657,7 @@ LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>*
             (*warn) += ss.str();
         }
     }
-    if (greatest_vt_idx >= static_cast<int>(vt.size() / 2))
+    if (st->greatest_vt_idx >= static_cast<int>(st->vt.size() / 2))
     {
         if (warn)
         {
@@ -2490,34 +3667,398 @@ LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>*
         }
     }
 
-    bool ret = exportGroupsToShape(&shape, faceGroup, lineGroup, tags, material, name, triangulate, v);
+    bool ret = exportGroupsToShape(&st->shape, st->faceGroup, st->lineGroup, st->tags, st->material, st->name, st->triangulate, st->v);
     // exportGroupsToShape return false when `usemtl` is called in the last
     // line.
     // we also add `shape` to `shapes` when `shape.mesh` has already some
     // faces(indices)
-    if (ret || shape.mesh.indices.size())
+    if (ret || st->shape.mesh.indices.size())
     {
-        shapes->push_back(shape);
+        st->shapes->push_back(st->shape);
     }
-    faceGroup.clear(); // for safety
+    st->faceGroup.clear(); // for safety
 
-    if (err)
+    attrib->vertices.swap(st->v);
+    attrib->normals.swap(st->vn);
+    attrib->texcoords.swap(st->vt);
+    attrib->colors.swap(st->vc);
+}
+
+template <typename LineReader>
+static bool
+LoadObjInternal(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn, std::string* err,
+                LineReader& lineReader, MaterialReader* readMatFn, bool triangulate, bool default_vcols_fallback)
+{
+    obj_load_state st(shapes, materials, warn, err, readMatFn, triangulate, default_vcols_fallback);
+
+    const char* line = NULL;
+    size_t line_len = 0;
+    while (lineReader.next(&line, &line_len))
     {
-        (*err) += errss.str();
+        st.line_num++;
+
+        if (!parseObjLine(&st, line, line_len))
+        {
+            return false;
+        }
     }
 
-    attrib->vertices.swap(v);
-    attrib->normals.swap(vn);
-    attrib->texcoords.swap(vt);
-    attrib->colors.swap(vc);
+    finishObjLoad(&st, attrib);
 
     return true;
 }
 
 bool
-LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* user_data /*= NULL*/, MaterialReader* readMatFn /*= NULL*/,
-                    std::string* warn, /* = NULL*/
-                    std::string* err /*= NULL*/)
+LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn, std::string* err,
+        std::istream* inStream, MaterialReader* readMatFn /*= NULL*/, bool triangulate, bool default_vcols_fallback)
+{
+    StreamLineReader lineReader(*inStream);
+    return LoadObjInternal(attrib, shapes, materials, warn, err, lineReader, readMatFn, triangulate, default_vcols_fallback);
+}
+
+bool
+LoadObjFromBuffer(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn, std::string* err,
+                  const char* buf, size_t buf_len, MaterialReader* readMatFn /*= NULL*/, bool triangulate, bool default_vcols_fallback)
+{
+    BufferLineReader lineReader(buf, buf_len);
+    return LoadObjInternal(attrib, shapes, materials, warn, err, lineReader, readMatFn, triangulate, default_vcols_fallback);
+}
+
+void
+CountObjElements(const char* buf, size_t buf_len, obj_counts_t* counts)
+{
+    counts->num_vertices = 0;
+    counts->num_normals = 0;
+    counts->num_texcoords = 0;
+    counts->num_faces = 0;
+    counts->num_face_corners = 0;
+
+    BufferLineReader lineReader(buf, buf_len);
+    const char* line = NULL;
+    size_t line_len = 0;
+    while (lineReader.next(&line, &line_len))
+    {
+        const char* token = line + strspn(line, " \t");
+        if (token[0] == 'v')
+        {
+            if (IS_SPACE(token[1]))
+            {
+                counts->num_vertices++;
+            }
+            else if (token[1] == 'n' && IS_SPACE(token[2]))
+            {
+                counts->num_normals++;
+            }
+            else if (token[1] == 't' && IS_SPACE(token[2]))
+            {
+                counts->num_texcoords++;
+            }
+        }
+        else if (token[0] == 'f' && IS_SPACE(token[1]))
+        {
+            counts->num_faces++;
+
+            // One corner per run of non-space characters
+            bool in_corner = false;
+            for (token += 2; !IS_NEW_LINE(token[0]); token++)
+            {
+                const bool is_space = IS_SPACE(token[0]);
+                if (!is_space && !in_corner)
+                {
+                    counts->num_face_corners++;
+                }
+                in_corner = !is_space;
+            }
+        }
+    }
+}
+
+// A face parsed by a worker of LoadObjFromBufferParallel. Its indices are
+// kept as written, relative ones depend on the vertices of earlier chunks.
+struct obj_chunk_face
+{
+    face_t face;
+    size_t line_num; // line number within the chunk
+    int num_v;       // v, vn and vt lines before the face within the chunk
+    int num_vn;
+    int num_vt;
+    bool valid;
+};
+
+// Any other command of a chunk, replayed in file order by the merge step.
+struct obj_chunk_command
+{
+    std::string line;
+    size_t line_num;  // line number within the chunk
+    size_t num_faces; // faces before the command within the chunk
+    size_t num_v;     // v lines before the command within the chunk
+};
+
+struct obj_chunk
+{
+    obj_chunk(const char* buf_, size_t buf_len_) : buf(buf_), buf_len(buf_len_), num_lines(0), found_all_colors(true) { }
+
+    const char* buf;
+    size_t buf_len;
+
+    size_t num_lines;
+    std::vector<real_t> v;
+    std::vector<real_t> vn;
+    std::vector<real_t> vt;
+    std::vector<real_t> vc;
+    bool found_all_colors;
+    std::vector<obj_chunk_face> faces;
+    std::vector<obj_chunk_command> commands;
+};
+
+// Parses the vertex data and faces of one chunk. Everything else only depends
+// on state that is known after the previous chunks, so it is recorded for the
+// merge step.
+static void
+parseObjChunk(obj_chunk* chunk, bool default_vcols_fallback)
+{
+    obj_load_state st(NULL, NULL, NULL, NULL, NULL, false, default_vcols_fallback);
+
+    BufferLineReader lineReader(chunk->buf, chunk->buf_len);
+    const char* line = NULL;
+    size_t line_len = 0;
+    while (lineReader.next(&line, &line_len))
+    {
+        st.line_num++;
+
+        const char* token = line + strspn(line, " \t");
+
+        // face
+        if (line_len > 0 && token[0] == 'f' && IS_SPACE((token[1])))
+        {
+            token += 2;
+            token += strspn(token, " \t");
+
+            chunk->faces.push_back(obj_chunk_face());
+            obj_chunk_face& face = chunk->faces.back();
+            face.line_num = st.line_num;
+            face.num_v = static_cast<int>(st.v.size() / 3);
+            face.num_vn = static_cast<int>(st.vn.size() / 3);
+            face.num_vt = static_cast<int>(st.vt.size() / 2);
+            face.valid = true;
+            face.face.vertex_indices.reserve(3);
+
+            while (!IS_NEW_LINE(token[0]))
+            {
+                vertex_index_t vi;
+                if (!parseUnresolvedTriple(&token, &vi))
+                {
+                    face.valid = false;
+                    break;
+                }
+
+                face.face.vertex_indices.push_back(vi);
+                token += strspn(token, " \t");
+            }
+
+            if (!face.valid)
+            {
+                // The merge step stops loading at this line.
+                break;
+            }
+
+            continue;
+        }
+
+        // vertex, normal, texcoord, empty and comment lines
+        const bool is_vertex_data =
+            token[0] == 'v' && (IS_SPACE((token[1])) || ((token[1] == 'n' || token[1] == 't') && IS_SPACE((token[2]))));
+        if (line_len == 0 || is_vertex_data || IS_NEW_LINE(token[0]) || token[0] == '#')
+        {
+            parseObjLine(&st, line, line_len);
+            continue;
+        }
+
+        chunk->commands.push_back(obj_chunk_command());
+        obj_chunk_command& command = chunk->commands.back();
+        command.line.assign(line, line_len);
+        command.line_num = st.line_num;
+        command.num_faces = chunk->faces.size();
+        command.num_v = st.v.size() / 3;
+    }
+
+    chunk->num_lines = st.line_num;
+    chunk->found_all_colors = st.found_all_colors;
+    chunk->v.swap(st.v);
+    chunk->vn.swap(st.vn);
+    chunk->vt.swap(st.vt);
+    chunk->vc.swap(st.vc);
+}
+
+// Resolves the indices of a chunk face against the vertex counts at its line
+// and appends it to the current face group, as parseObjLine does for `f'.
+static bool
+mergeObjChunkFace(obj_load_state* st, obj_chunk_face* chunkFace, int v_base, int vn_base, int vt_base)
+{
+    if (!chunkFace->valid)
+    {
+        if (st->err)
+        {
+            std::stringstream ss;
+            ss << "Failed parse `f' line(e.g. zero value for face index. line " << st->line_num << ".)\n";
+            (*st->err) += ss.str();
+        }
+        return false;
+    }
+
+    std::vector<vertex_index_t>& indices = chunkFace->face.vertex_indices;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        vertex_index_t& vi = indices[i];
+        fixIndex(vi.v_idx, v_base + chunkFace->num_v, &vi.v_idx);
+        if (vi.vt_idx == 0 || !fixIndex(vi.vt_idx, vt_base + chunkFace->num_vt, &vi.vt_idx))
+        {
+            vi.vt_idx = -1;
+        }
+        if (vi.vn_idx == 0 || !fixIndex(vi.vn_idx, vn_base + chunkFace->num_vn, &vi.vn_idx))
+        {
+            vi.vn_idx = -1;
+        }
+
+        st->greatest_v_idx = st->greatest_v_idx > vi.v_idx ? st->greatest_v_idx : vi.v_idx;
+        st->greatest_vn_idx = st->greatest_vn_idx > vi.vn_idx ? st->greatest_vn_idx : vi.vn_idx;
+        st->greatest_vt_idx = st->greatest_vt_idx > vi.vt_idx ? st->greatest_vt_idx : vi.vt_idx;
+    }
+
+    st->faceGroup.push_back(face_t());
+    face_t& face = st->faceGroup.back();
+    face.smoothing_group_id = st->current_smoothing_id;
+    face.vertex_indices.swap(indices);
+
+    return true;
+}
+
+bool
+LoadObjFromBufferParallel(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials, std::string* warn,
+                          std::string* err, const char* buf, size_t buf_len, MaterialReader* readMatFn /*= NULL*/, bool triangulate,
+                          bool default_vcols_fallback, unsigned int num_threads, size_t min_chunk_size)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::thread::hardware_concurrency();
+    }
+
+    if (min_chunk_size == 0)
+    {
+        min_chunk_size = 1;
+    }
+
+    size_t num_chunks = num_threads;
+    if (num_chunks > buf_len / min_chunk_size)
+    {
+        num_chunks = buf_len / min_chunk_size;
+    }
+
+    // Split at '\n' only, so that a chunk never starts in the middle of a
+    // '\r\n' line ending.
+    std::vector<obj_chunk> chunks;
+    const char* chunk_begin = buf;
+    const char* buf_end = buf + buf_len;
+    for (size_t i = 1; i <= num_chunks && chunk_begin < buf_end; i++)
+    {
+        const char* chunk_end = buf_end;
+        if (i < num_chunks)
+        {
+            const char* split = buf + (buf_len / num_chunks) * i;
+            if (split < chunk_begin)
+            {
+                split = chunk_begin;
+            }
+            const void* newline = memchr(split, '\n', static_cast<size_t>(buf_end - split));
+            chunk_end = newline ? static_cast<const char*>(newline) + 1 : buf_end;
+        }
+
+        chunks.push_back(obj_chunk(chunk_begin, static_cast<size_t>(chunk_end - chunk_begin)));
+        chunk_begin = chunk_end;
+    }
+
+    if (chunks.size() <= 1)
+    {
+        return LoadObjFromBuffer(attrib, shapes, materials, warn, err, buf, buf_len, readMatFn, triangulate, default_vcols_fallback);
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(chunks.size() - 1);
+    for (size_t i = 1; i < chunks.size(); i++)
+    {
+        workers.push_back(std::thread(parseObjChunk, &chunks[i], default_vcols_fallback));
+    }
+    parseObjChunk(&chunks[0], default_vcols_fallback);
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+
+    // Merge in file order. Vertices are appended up to each replayed command,
+    // so that exportGroupsToShape sees the same vertices as the serial loader.
+    obj_load_state st(shapes, materials, warn, err, readMatFn, triangulate, default_vcols_fallback);
+
+    size_t line_base = 0;
+    for (size_t c = 0; c < chunks.size(); c++)
+    {
+        obj_chunk& chunk = chunks[c];
+        const int v_base = static_cast<int>(st.v.size() / 3);
+        const int vn_base = static_cast<int>(st.vn.size() / 3);
+        const int vt_base = static_cast<int>(st.vt.size() / 2);
+
+        size_t face_idx = 0;
+        size_t v_merged = 0;
+        for (size_t i = 0; i <= chunk.commands.size(); i++)
+        {
+            const bool at_end = (i == chunk.commands.size());
+            const size_t num_faces = at_end ? chunk.faces.size() : chunk.commands[i].num_faces;
+            for (; face_idx < num_faces; face_idx++)
+            {
+                st.line_num = line_base + chunk.faces[face_idx].line_num;
+                if (!mergeObjChunkFace(&st, &chunk.faces[face_idx], v_base, vn_base, vt_base))
+                {
+                    return false;
+                }
+            }
+
+            const size_t num_v = at_end ? chunk.v.size() / 3 : chunk.commands[i].num_v;
+            st.v.insert(st.v.end(), chunk.v.begin() + static_cast<std::ptrdiff_t>(3 * v_merged),
+                        chunk.v.begin() + static_cast<std::ptrdiff_t>(3 * num_v));
+            v_merged = num_v;
+
+            if (!at_end)
+            {
+                obj_chunk_command& command = chunk.commands[i];
+                st.line_num = line_base + command.line_num;
+                if (!parseObjLine(&st, command.line.c_str(), command.line.size()))
+                {
+                    return false;
+                }
+            }
+        }
+
+        st.vn.insert(st.vn.end(), chunk.vn.begin(), chunk.vn.end());
+        st.vt.insert(st.vt.end(), chunk.vt.begin(), chunk.vt.end());
+        st.vc.insert(st.vc.end(), chunk.vc.begin(), chunk.vc.end());
+        st.found_all_colors &= chunk.found_all_colors;
+
+        line_base += chunk.num_lines;
+        std::vector<real_t>().swap(chunk.v);
+        std::vector<real_t>().swap(chunk.vn);
+        std::vector<real_t>().swap(chunk.vt);
+        std::vector<real_t>().swap(chunk.vc);
+    }
+    st.line_num = line_base;
+
+    finishObjLoad(&st, attrib);
+
+    return true;
+}
+
+template <typename LineReader>
+static bool
+LoadObjWithCallbackInternal(LineReader& lineReader, const callback_t& callback, void* user_data, MaterialReader* readMatFn,
+                            std::string* warn, std::string* err)
 {
     std::stringstream errss;
 
@@ -2525,41 +4066,38 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
     std::map<std::string, int> material_map;
     int material_id = -1; // -1 = invalid
 
+    // smoothing group, 0 = off
+    unsigned int smoothing_id = 0;
+
     std::vector<index_t> indices;
     std::vector<material_t> materials;
     std::vector<std::string> names;
     names.reserve(2);
     std::vector<const char*> names_out;
 
-    std::string linebuf;
-    while (inStream.peek() != -1)
+    size_t line_num = 0;
+    const char* line = NULL;
+    size_t line_len = 0;
+    while (lineReader.next(&line, &line_len))
     {
-        safeGetline(inStream, linebuf);
-
-        // Trim newline '\r\n' or '\n'
-        if (linebuf.size() > 0)
-        {
-            if (linebuf[linebuf.size() - 1] == '\n')
-                linebuf.erase(linebuf.size() - 1);
-        }
-        if (linebuf.size() > 0)
-        {
-            if (linebuf[linebuf.size() - 1] == '\r')
-                linebuf.erase(linebuf.size() - 1);
-        }
+        line_num++;
 
         // Skip if empty line.
-        if (linebuf.empty())
+        if (line_len == 0)
         {
             continue;
         }
 
+        // The line is not necessarily NUL-terminated, use line_end instead of
+        // reading up to '\0'.
+        const char* line_end = line + line_len;
+
         // Skip leading space.
-        const char* token = linebuf.c_str();
+        const char* token = line;
         token += strspn(token, " \t");
 
         assert(token);
-        if (token[0] == '\0')
+        if (IS_NEW_LINE(token[0]))
             continue; // empty line
 
         if (token[0] == '#')
@@ -2614,7 +4152,18 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
             indices.clear();
             while (!IS_NEW_LINE(token[0]))
             {
-                vertex_index_t vi = parseRawTriple(&token);
+                // Indices not given are 0, one written as 0 is an error as in LoadObj
+                vertex_index_t vi;
+                if (!parseUnresolvedTriple(&token, &vi))
+                {
+                    if (err)
+                    {
+                        std::stringstream ss;
+                        ss << "Failed parse `f' line(e.g. zero value for face index. line " << line_num << ".)\n";
+                        (*err) += errss.str() + ss.str();
+                    }
+                    return false;
+                }
 
                 index_t idx;
                 idx.vertex_index = vi.v_idx;
@@ -2622,7 +4171,7 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
                 idx.texcoord_index = vi.vt_idx;
 
                 indices.push_back(idx);
-                size_t n = strspn(token, " \t\r");
+                size_t n = strspn(token, " \t");
                 token += n;
             }
 
@@ -2638,9 +4187,7 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
         if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6])))
         {
             token += 7;
-            std::stringstream ss;
-            ss << token;
-            std::string namebuf = ss.str();
+            std::string namebuf(token, line_end);
 
             int newMaterialId = -1;
             if (material_map.find(namebuf) != material_map.end())
@@ -2673,7 +4220,7 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
                 token += 7;
 
                 std::vector<std::string> filenames;
-                SplitString(std::string(token), ' ', filenames);
+                SplitString(std::string(token, line_end), ' ', filenames);
 
                 if (filenames.empty())
                 {
@@ -2739,7 +4286,7 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
             {
                 std::string str = parseString(&token);
                 names.push_back(str);
-                token += strspn(token, " \t\r"); // skip tag
+                token += strspn(token, " \t"); // skip tag
             }
 
             assert(names.size() > 0);
@@ -2771,9 +4318,7 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
             // @todo { multiple object name? }
             token += 2;
 
-            std::stringstream ss;
-            ss << token;
-            std::string object_name = ss.str();
+            std::string object_name(token, line_end);
 
             if (callback.object_cb)
             {
@@ -2783,6 +4328,18 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
             continue;
         }
 
+        // smoothing group id
+        if (token[0] == 's' && IS_SPACE((token[1])))
+        {
+            parseSmoothingGroup(token + 2, line_end, &smoothing_id);
+            if (callback.smoothing_group_cb)
+            {
+                callback.smoothing_group_cb(user_data, smoothing_id);
+            }
+
+            continue;
+        }
+
 #if 0 // @todo
     if (token[0] == 't' && IS_SPACE(token[1])) {
       tag_t tag;
@@ -2832,6 +4389,23 @@ LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* us
     return true;
 }
 
+bool
+LoadObjWithCallback(std::istream& inStream, const callback_t& callback, void* user_data /*= NULL*/, MaterialReader* readMatFn /*= NULL*/,
+                    std::string* warn, /* = NULL*/
+                    std::string* err /*= NULL*/)
+{
+    StreamLineReader lineReader(inStream);
+    return LoadObjWithCallbackInternal(lineReader, callback, user_data, readMatFn, warn, err);
+}
+
+bool
+LoadObjWithCallbackFromBuffer(const char* buf, size_t buf_len, const callback_t& callback, void* user_data /*= NULL*/,
+                              MaterialReader* readMatFn /*= NULL*/, std::string* warn /*= NULL*/, std::string* err /*= NULL*/)
+{
+    BufferLineReader lineReader(buf, buf_len);
+    return LoadObjWithCallbackInternal(lineReader, callback, user_data, readMatFn, warn, err);
+}
+
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
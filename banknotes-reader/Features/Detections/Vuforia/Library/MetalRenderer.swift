@@ -18,6 +18,13 @@ class MetalRenderer {
     private var mAxisPipelineState:MTLRenderPipelineState!
     private var mUniformColorShaderPipelineState:MTLRenderPipelineState!
     private var mTexturedVertexShaderPipelineState:MTLRenderPipelineState!
+    private var mTexturedInterleavedPipelineState:MTLRenderPipelineState!
+    private var mTexturedQuantizedPipelineState:MTLRenderPipelineState!
+
+    // Models are loaded with position and texture coordinate interleaved in one buffer
+    private let mModelVertexLayout = vertexLayoutInterleaved(false)
+    // Models whose texture coordinates stay within [0, 1] can be loaded in a third of the size
+    private let mQuantizedModelVertexLayout = vertexLayoutQuantized(false)
 
     private var mDefaultSamplerState:MTLSamplerState?
     private var mWrappingSamplerState:MTLSamplerState?
@@ -57,13 +64,19 @@ class MetalRenderer {
     private var mGuideViewTexture:MTLTexture!
     
     private var mAstronautVertices:MTLBuffer!
-    private var mAstronautTextureCoordinates:MTLBuffer!
+    private var mAstronautTextureCoordinates:MTLBuffer?
     private var mAstronautVertexCount:Int = 0
+    private var mAstronautIndices:MTLBuffer?
+    private var mAstronautIndexCount:Int = 0
+    private var mAstronautIndexType:MTLIndexType = .uint16
     private var mAstronautTexture:MTLTexture!
 
     private var mLanderVertices:MTLBuffer!
-    private var mLanderTextureCoordinates:MTLBuffer!
+    private var mLanderTextureCoordinates:MTLBuffer?
     private var mLanderVertexCount:Int = 0
+    private var mLanderIndices:MTLBuffer?
+    private var mLanderIndexCount:Int = 0
+    private var mLanderIndexType:MTLIndexType = .uint16
     private var mLanderTexture:MTLTexture!
 
     private let colorRed = vector_float4(Float(0), Float(1), Float(0), Float(1))
@@ -138,6 +151,29 @@ class MetalRenderer {
             return
         }
 
+        // Create pipeline for rendering models with interleaved vertices
+        stateDescriptor.vertexFunction = library?.makeFunction(name: "texturedInterleavedVertex")
+        stateDescriptor.vertexDescriptor = MetalRenderer.vertexDescriptor(layout: mModelVertexLayout)
+        do {
+            try self.mTexturedInterleavedPipelineState = metalDevice.makeRenderPipelineState(descriptor: stateDescriptor)
+        } catch {
+            print("Failed to create model render pipeline state:", error)
+            return
+        }
+        stateDescriptor.vertexDescriptor = nil
+
+        // Create pipeline for rendering quantized models, normals are decoded if the layout has them
+        let quantizedConstants = MTLFunctionConstantValues()
+        var hasQuantizedNormals = vertexLayoutOffset(mQuantizedModelVertexLayout, VuforiaVertexAttributeNormal) >= 0
+        quantizedConstants.setConstantValue(&hasQuantizedNormals, type: .bool, index: 0)
+        do {
+            stateDescriptor.vertexFunction = try library?.makeFunction(name: "texturedQuantizedVertex", constantValues: quantizedConstants)
+            try self.mTexturedQuantizedPipelineState = metalDevice.makeRenderPipelineState(descriptor: stateDescriptor)
+        } catch {
+            print("Failed to create quantized model render pipeline state:", error)
+            return
+        }
+
         mDefaultSamplerState = MetalRenderer.defaultSampler(device: metalDevice)
         mWrappingSamplerState = MetalRenderer.wrappingSampler(device: metalDevice)
         
@@ -279,6 +315,7 @@ class MetalRenderer {
 //        // Draw the Astronaut
 //        renderModel(encoder: encoder,
 //                    vertices: mAstronautVertices, vertexCount: mAstronautVertexCount,
+//                    indices: mAstronautIndices, indexCount: mAstronautIndexCount, indexType: mAstronautIndexType,
 //                    textureCoordinates: mAstronautTextureCoordinates, texture: mAstronautTexture,
 //                    mvpBuffer: mAugmentationMVP)
     }
@@ -299,6 +336,7 @@ class MetalRenderer {
         // Draw the Lander
         renderModel(encoder: encoder,
                     vertices: mLanderVertices, vertexCount: mLanderVertexCount,
+                    indices: mLanderIndices, indexCount: mLanderIndexCount, indexType: mLanderIndexType,
                     textureCoordinates: mLanderTextureCoordinates, texture: mLanderTexture,
                     mvpBuffer: mAugmentationMVP)
     }
@@ -353,18 +391,38 @@ class MetalRenderer {
     }
 
     
+    /// quantization is positionScale then positionOffset of a model loaded in mQuantizedModelVertexLayout,
+    /// nil for the float layouts. normals are only read if that layout has them.
     private func renderModel(encoder: MTLRenderCommandEncoder?,
                              vertices: MTLBuffer, vertexCount: Int,
-                             textureCoordinates: MTLBuffer, texture: MTLTexture,
-                             mvpBuffer: MTLBuffer) {
-
-        encoder?.setRenderPipelineState(mTexturedVertexShaderPipelineState)
+                             indices: MTLBuffer?, indexCount: Int, indexType: MTLIndexType,
+                             textureCoordinates: MTLBuffer?, texture: MTLTexture,
+                             mvpBuffer: MTLBuffer, quantization: [Float]? = nil, normals: MTLBuffer? = nil) {
+
+        // Quantized vertices are in separate buffers, without separate texture coordinates
+        // the float vertices are interleaved
+        if let quantization = quantization {
+            encoder?.setRenderPipelineState(mTexturedQuantizedPipelineState)
+            encoder?.setVertexBuffer(textureCoordinates, offset: 0, index: 2)
+            encoder?.setVertexBytes(quantization, length: MemoryLayout<Float>.size * 6, index: 3)
+            if let normals = normals {
+                encoder?.setVertexBuffer(normals, offset: 0, index: 4)
+            }
+        } else if let textureCoordinates = textureCoordinates {
+            encoder?.setRenderPipelineState(mTexturedVertexShaderPipelineState)
+            encoder?.setVertexBuffer(textureCoordinates, offset: 0, index: 2)
+        } else {
+            encoder?.setRenderPipelineState(mTexturedInterleavedPipelineState)
+        }
         encoder?.setFragmentTexture(texture, index: 0)
         encoder?.setFragmentSamplerState(mWrappingSamplerState, index: 0)
-        encoder?.setVertexBuffer(textureCoordinates, offset: 0, index: 2)
         encoder?.setVertexBuffer(vertices, offset: 0, index: 0)
         encoder?.setVertexBuffer(mvpBuffer, offset: 0, index: 1)
-        encoder?.drawPrimitives(type: .triangle, vertexStart: 0, vertexCount: vertexCount)
+        if let indices = indices {
+            encoder?.drawIndexedPrimitives(type: .triangle, indexCount: indexCount, indexType: indexType, indexBuffer: indices, indexBufferOffset: 0)
+        } else {
+            encoder?.drawPrimitives(type: .triangle, vertexStart: 0, vertexCount: vertexCount)
+        }
     }
     
     
@@ -372,6 +430,8 @@ class MetalRenderer {
     private func loadModels() {
 //        let bundle = Bundle.main
 //        let loader = MTKTextureLoader(device: mMetalDevice)
+//        // The OBJ files are only parsed on first launch, later launches map the binary mesh cache
+//        let cachesDirectory = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask)[0]
 //        
 //        let astronautImage = bundle.url(forResource: "Astronaut", withExtension: "jpg")!
 //        // Load the texture, note that we specify the origin as the texture coordinates
@@ -379,23 +439,37 @@ class MetalRenderer {
 //        mAstronautTexture = try! loader.newTexture(URL: astronautImage, options: [MTKTextureLoader.Option.origin: MTKTextureLoader.Origin.bottomLeft])
 //        
 //        let astronautModelPath = bundle.path(forResource: "Astronaut", ofType: "obj")
-//        let astronautModelData = NSData(contentsOfFile: astronautModelPath!)
-//        
-//        // Copy the bytes to an array, needed for iOS 12 where using the array constructor
-//        // like this 'var astronautModelBytes = [UInt8](astronautModelData!)' doesn't work
-//        let astronautByteCount = astronautModelData!.length / MemoryLayout<Int8>.size
-//        var astronautModelBytes = [Int8](repeating: 0, count: astronautByteCount)
-//        astronautModelData!.getBytes(&astronautModelBytes, length:astronautByteCount * MemoryLayout<Int8>.size)
-//
-//        var astronautModel: VuforiaModel = loadModel(&astronautModelBytes, Int32(astronautModelBytes.count))
-//        if (astronautModel.isLoaded) {
-//            mAstronautVertexCount = Int(astronautModel.numVertices)
-//            mAstronautVertices = mMetalDevice.makeBuffer(bytes: astronautModel.vertices, length: MemoryLayout<Float>.size * 3 * Int(astronautModel.numVertices), options:[])
-//            mAstronautTextureCoordinates = mMetalDevice.makeBuffer(bytes: astronautModel.textureCoordinates, length: MemoryLayout<Float>.size * 2 * Int(astronautModel.numVertices), options:[])
+//        // The file is memory-mapped and parsed in place, no copy into Swift is needed
+//        // Shared vertices are deduplicated and drawn through an index buffer
+//        let astronautCachePath = cachesDirectory.appendingPathComponent("Astronaut.mesh").path
+//        // Only the sizes are known after the query, fillModel then writes straight into the Metal buffers
+//        var astronautQuery: VuforiaModelQuery = astronautCachePath.withCString { cachePath in
+//            var config = modelConfigDefault()
+//            config.cachePath = cachePath
+//            config.layout = mModelVertexLayout
+//            return queryModelFromFile(astronautModelPath!, config)
+//        }
+//        if (astronautQuery.isValid) {
+//            let vertexCount = Int(astronautQuery.numVertices)
+//            let indexCount = Int(astronautQuery.numIndices)
+//            let vertexStride = Int(vertexLayoutStride(mModelVertexLayout, VuforiaVertexAttributePosition))
+//            mAstronautVertices = mMetalDevice.makeBuffer(length: vertexStride * max(vertexCount, 1), options: [.storageModeShared])
+//            if (indexCount > 0) {
+//                mAstronautIndices = mMetalDevice.makeBuffer(length: Int(astronautQuery.indexSize) * indexCount, options: [.storageModeShared])
+//            }
+//            if (fillModel(&astronautQuery, mAstronautVertices.contents(), nil, nil, nil, mAstronautIndices?.contents())) {
+//                mAstronautVertexCount = vertexCount
+//                if (indexCount > 0) {
+//                    mAstronautIndexCount = indexCount
+//                    mAstronautIndexType = astronautQuery.indexSize == 2 ? .uint16 : .uint32
+//                }
+//            } else {
+//                mAstronautIndices = nil
+//                NSLog("Failed to load astronaut model")
+//            }
 //        } else {
 //            NSLog("Failed to load astronaut model")
 //        }
-//        releaseModel(&astronautModel)
 //
 //        let landerImage = bundle.url(forResource: "VikingLander", withExtension: "jpg")!
 //        // Load the texture, note that we specify the origin as the texture coordinates
@@ -403,24 +477,62 @@ class MetalRenderer {
 //        mLanderTexture = try! loader.newTexture(URL: landerImage, options: [MTKTextureLoader.Option.origin: MTKTextureLoader.Origin.bottomLeft])
 //        
 //        let landerModelPath = bundle.path(forResource: "VikingLander", ofType: "obj")
-//        let landerModelData = NSData(contentsOfFile: landerModelPath!)
-//
-//        let landerByteCount = landerModelData!.length / MemoryLayout<Int8>.size
-//        var landerModelBytes = [Int8](repeating: 0, count: landerByteCount)
-//        landerModelData!.getBytes(&landerModelBytes, length:landerByteCount * MemoryLayout<Int8>.size)
-//
-//        var landerModel: VuforiaModel = loadModel(&landerModelBytes, Int32(landerModelData!.count))
-//        if (landerModel.isLoaded) {
-//            mLanderVertexCount = Int(landerModel.numVertices)
-//            mLanderVertices = mMetalDevice.makeBuffer(bytes: landerModel.vertices, length: MemoryLayout<Float>.size * 3 * Int(landerModel.numVertices), options:[])
-//            mLanderTextureCoordinates = mMetalDevice.makeBuffer(bytes: landerModel.textureCoordinates, length: MemoryLayout<Float>.size * 2 * Int(landerModel.numVertices), options:[])
+//        let landerCachePath = cachesDirectory.appendingPathComponent("VikingLander.mesh").path
+//        var landerQuery: VuforiaModelQuery = landerCachePath.withCString { cachePath in
+//            var config = modelConfigDefault()
+//            config.cachePath = cachePath
+//            config.layout = mModelVertexLayout
+//            return queryModelFromFile(landerModelPath!, config)
+//        }
+//        if (landerQuery.isValid) {
+//            let vertexCount = Int(landerQuery.numVertices)
+//            let indexCount = Int(landerQuery.numIndices)
+//            let vertexStride = Int(vertexLayoutStride(mModelVertexLayout, VuforiaVertexAttributePosition))
+//            mLanderVertices = mMetalDevice.makeBuffer(length: vertexStride * max(vertexCount, 1), options: [.storageModeShared])
+//            if (indexCount > 0) {
+//                mLanderIndices = mMetalDevice.makeBuffer(length: Int(landerQuery.indexSize) * indexCount, options: [.storageModeShared])
+//            }
+//            if (fillModel(&landerQuery, mLanderVertices.contents(), nil, nil, nil, mLanderIndices?.contents())) {
+//                mLanderVertexCount = vertexCount
+//                if (indexCount > 0) {
+//                    mLanderIndexCount = indexCount
+//                    mLanderIndexType = landerQuery.indexSize == 2 ? .uint16 : .uint32
+//                }
+//            } else {
+//                mLanderIndices = nil
+//                NSLog("Failed to load lander model")
+//            }
 //        } else {
 //            NSLog("Failed to load lander model")
 //        }
-//        releaseModel(&landerModel)
     }
     
     
+    /// Describe an interleaved vertex layout to Metal, attribute indices follow VuforiaVertexAttribute.
+    /// The descriptor is for texturedInterleavedVertex, which reads floats only: quantized formats are
+    /// left invalid so that the pipeline fails to build, rather than draw the positions in a unit cube.
+    class func vertexDescriptor(layout: VuforiaVertexLayout) -> MTLVertexDescriptor {
+        let descriptor = MTLVertexDescriptor()
+        let elements = [layout.elements.0, layout.elements.1, layout.elements.2, layout.elements.3]
+        for element in elements.prefix(Int(layout.numElements)) {
+            let attribute = descriptor.attributes[Int(element.attribute.rawValue)]!
+            switch element.format {
+            case VuforiaVertexFormatFloat2: attribute.format = .float2
+            case VuforiaVertexFormatFloat3: attribute.format = .float3
+            case VuforiaVertexFormatFloat4: attribute.format = .float4
+            case VuforiaVertexFormatHalf2: attribute.format = .half2
+            case VuforiaVertexFormatHalf4: attribute.format = .half4
+            default: attribute.format = .invalid
+            }
+            attribute.offset = Int(vertexLayoutOffset(layout, element.attribute))
+            attribute.bufferIndex = 0
+        }
+        descriptor.layouts[0].stride = Int(vertexLayoutStride(layout, VuforiaVertexAttributePosition))
+        descriptor.layouts[0].stepFunction = .perVertex
+        return descriptor
+    }
+
+
     class func defaultSampler(device: MTLDevice) -> MTLSamplerState? {
         let sampler = MTLSamplerDescriptor()
         sampler.minFilter             = MTLSamplerMinMagFilter.linear
@@ -232,28 +232,33 @@ class VuforiaView:UIView {
 //                mRenderer.renderWorldOrigin(encoder: encoder, projectionMatrix: worldOriginProjectionMatrix, modelViewMatrix: worldOriginModelViewMatrix)
 //            }
 
-            var trackableProjection = matrix_float4x4()
-            var trackableModelView = matrix_float4x4()
-            var trackableScaledModelView = matrix_float4x4()
-            
-            // Render image target bounding box if detected
-            if (getImageTargetResult(&trackableProjection.columns, &trackableModelView.columns, &trackableScaledModelView.columns)) {
-                mRenderer.renderImageTarget(encoder: encoder,
-                                            projectionMatrix: trackableProjection,
-                                            modelViewMatrix: trackableModelView,
-                                            scaledModelViewMatrix: trackableScaledModelView)
+            // Every pose of the frame in one call
+            let frame = captureFrame()
+            var modelTargetTracked = false
+            withUnsafeBytes(of: frame.targets) { buffer in
+                let targets = buffer.bindMemory(to: VuforiaFrameTarget.self)
+                for target in targets.prefix(Int(frame.numTargets)) where target.poseStatus != VU_OBSERVATION_POSE_STATUS_NO_POSE {
+                    // Render image target bounding box if detected
+                    if (target.targetType == getImageTargetId()) {
+                        mRenderer.renderImageTarget(encoder: encoder,
+                                                    projectionMatrix: frame.projection,
+                                                    modelViewMatrix: target.modelView,
+                                                    scaledModelViewMatrix: target.scaledModelView)
+                    } else if (target.targetType == getModelTargetId()) {
+                        // Render model target bounding box if detected
+                        mRenderer.renderModelTarget(encoder: encoder,
+                                                    projectionMatrix: frame.projection,
+                                                    modelViewMatrix: target.modelView,
+                                                    scaledModelViewMatrix: target.scaledModelView)
+                        modelTargetTracked = true
+                    }
+                }
             }
 
             var guideViewImageInfo: VuImageInfo = VuImageInfo()
             var guideViewImageHasChanged: VuBool = VuBool();
-            // Render model target bounding box if detected, if not render guide view
-            if (getModelTargetResult(&trackableProjection.columns, &trackableModelView.columns, &trackableScaledModelView.columns)) {
-                mRenderer.renderModelTarget(encoder: encoder,
-                                            projectionMatrix: trackableProjection,
-                                            modelViewMatrix: trackableModelView,
-                                            scaledModelViewMatrix: trackableScaledModelView)
-                
-            } else if (getModelTargetGuideView(mGuideViewModelViewProjectionBuffer.contents(), &guideViewImageInfo, &guideViewImageHasChanged)) {
+            // If the model target is not tracked render its guide view
+            if (!modelTargetTracked && getModelTargetGuideView(mGuideViewModelViewProjectionBuffer.contents(), &guideViewImageInfo, &guideViewImageHasChanged)) {
                 mRenderer.renderModelTargetGuideView(encoder: encoder, modelViewProjectionMatrix: mGuideViewModelViewProjectionBuffer, guideViewImageInfo: &guideViewImageInfo, guideViewImageHasChanged: guideViewImageHasChanged)
             }
             
@@ -29,6 +29,77 @@ vertex VertexTextureOut texturedVertex(constant packed_float3* pPosition   [[ bu
     return out;
 }
 
+// Quantized model vertices from vertexLayoutQuantized, in separate buffers
+// like texturedVertex. Positions are normalized to the model bounds and
+// mapped back with the position scale and offset of the model.
+struct PositionQuantization
+{
+    packed_float3 m_Scale;
+    packed_float3 m_Offset;
+};
+
+// Set when the layout has OctSnorm16x2 normals, bound at buffer 4
+constant bool hasQuantizedNormals [[ function_constant(0) ]];
+
+struct VertexTextureNormalOut
+{
+    float4 m_Position [[ position ]];
+    float2 m_TexCoord;
+    // Model space, zero without normals. texturedFragment does not light the model and ignores it
+    float3 m_Normal;
+};
+
+// Inverse of encodeOctNormal
+float3 octDecode(short2 encoded)
+{
+    float2 folded = max(float2(encoded) / 32767.0f, -1.0f);
+    float3 n(folded, 1.0f - abs(folded.x) - abs(folded.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += select(float2(t), float2(-t), n.xy >= 0.0f);
+    return normalize(n);
+}
+
+vertex VertexTextureNormalOut texturedQuantizedVertex(constant ushort4*               pPosition      [[ buffer(0) ]],
+                                                      constant float4x4*              pMVP           [[ buffer(1) ]],
+                                                      constant ushort2*               pTexCoords     [[ buffer(2) ]],
+                                                      constant PositionQuantization&  quantization   [[ buffer(3) ]],
+                                                      constant short2*                pNormals       [[ buffer(4), function_constant(hasQuantizedNormals) ]],
+                                                      uint                            vid            [[ vertex_id ]])
+{
+    VertexTextureNormalOut out;
+    float3 normalized = float3(pPosition[vid].xyz) / 65535.0f;
+    float4 in(float3(quantization.m_Offset) + float3(quantization.m_Scale) * normalized, 1.0f);
+
+    out.m_Position = *pMVP * in;
+    out.m_TexCoord = float2(pTexCoords[vid]) / 65535.0f;
+    out.m_Normal = float3(0.0f);
+    if (hasQuantizedNormals)
+    {
+        out.m_Normal = octDecode(pNormals[vid]);
+    }
+
+    return out;
+}
+
+// Interleaved model vertices, the pipeline's vertex descriptor maps the
+// layout from vertexLayoutInterleaved onto these attributes
+struct TexturedVertexIn
+{
+    float3 m_Position [[ attribute(0) ]];
+    float2 m_TexCoord [[ attribute(1) ]];
+};
+
+vertex VertexTextureOut texturedInterleavedVertex(TexturedVertexIn       in          [[ stage_in ]],
+                                                  constant float4x4*     pMVP        [[ buffer(1) ]])
+{
+    VertexTextureOut out;
+
+    out.m_Position = *pMVP * float4(in.m_Position, 1.0f);
+    out.m_TexCoord = in.m_TexCoord;
+
+    return out;
+}
+
 fragment half4 texturedFragment(VertexTextureOut    inFrag  [[ stage_in ]],
                                 texture2d<half>     tex2D   [[ texture(0) ]],
                                 sampler             sampler2D [[ sampler(0) ]])
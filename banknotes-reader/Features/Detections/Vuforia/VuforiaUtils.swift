@@ -17,6 +17,24 @@ private let initDoneCallback: @convention(c) (UnsafeMutableRawPointer?) -> Void
     }
 }
 
+private let recognitionCallback: @convention(c) (UnsafeMutableRawPointer?, VuforiaRecognition) -> Void = { observer, recognition in
+    guard let observer = observer else { return }
+    let instance = Unmanaged<DummyViewController>.fromOpaque(observer).takeUnretainedValue()
+    // Only called when the recognized note changes, so the main queue gets no work per frame
+    let name = recognition.name.map { String(cString: $0) }
+    DispatchQueue.main.async {
+        instance.showRecognizedNote(name)
+    }
+}
+
+func observeRecognition(_ viewController: DummyViewController?) {
+    guard let viewController = viewController else {
+        setRecognitionCallback(nil, nil)
+        return
+    }
+    setRecognitionCallback(recognitionCallback, UnsafeMutableRawPointer(Unmanaged.passUnretained(viewController).toOpaque()))
+}
+
 func startVuforia(_ viewController: UIViewController) {
     DispatchQueue.global(qos: .background).async {
         var initConfig: VuforiaInitConfig = VuforiaInitConfig()
@@ -10,6 +10,7 @@ countries.
 #import <VuforiaEngine/VuforiaEngine.h>
 
 #import <UIKit/UIOrientation.h>
+#import <simd/simd.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -27,16 +28,229 @@ typedef struct
 } VuforiaInitConfig;
 
 
+/// Most targets a VuforiaFrame holds
+#define VUFORIA_FRAME_MAX_TARGETS 16
+
+/// One target observation of a frame
+typedef struct
+{
+    /// getImageTargetId() or getModelTargetId()
+    int targetType;
+    /// Index of an image target, see getTargetName, -1 for the model target
+    int targetIndex;
+    /// Name of the target in its database, valid until deinitAR
+    const char* name;
+    VuObservationPoseStatus poseStatus;
+    /// Identity if poseStatus is VU_OBSERVATION_POSE_STATUS_NO_POSE
+    simd_float4x4 modelView;
+    simd_float4x4 scaledModelView;
+} VuforiaFrameTarget;
+
+
+/// Poses of the frame prepared by prepareToRender, see captureFrame.
+/// Holds every image target tracked in the frame, such as several notes held up together.
+typedef struct
+{
+    /// False if the latest prepareToRender had no frame or failed to update the video background,
+    /// nothing else is then filled in
+    bool isValid;
+    simd_float4x4 projection;
+    /// Model-view of the world origin, valid if devicePoseStatus is not VU_OBSERVATION_POSE_STATUS_NO_POSE
+    simd_float4x4 view;
+    simd_float4x4 videoBackgroundProjection;
+    VuObservationPoseStatus devicePoseStatus;
+    VuDevicePoseObservationStatusInfo devicePoseStatusInfo;
+    int numTargets;
+    VuforiaFrameTarget targets[VUFORIA_FRAME_MAX_TARGETS];
+} VuforiaFrame;
+
+
+/// The note the tracker recognizes, see getRecognition
+typedef struct
+{
+    /// Index of the recognized image target, see getTargetName, -1 if no note is recognized
+    int targetIndex;
+    /// Name of the recognized image target, valid until deinitAR, NULL if no note is recognized
+    const char* name;
+    /// 1 while the note is tracked, 0.5 while its pose is limited, 0 if no note is recognized
+    float confidence;
+    /// Camera timestamp of the latest frame in nanoseconds
+    int64_t timestamp;
+    /// Incremented each time the recognized note changes
+    uint32_t changeCount;
+} VuforiaRecognition;
+
+/// Called on the Vuforia camera thread each time the recognized note changes
+typedef void (*VuforiaRecognitionCallback)(void* userData, VuforiaRecognition recognition);
+
+
+/// Per vertex data of a model, see VuforiaVertexLayout
+typedef enum
+{
+    VuforiaVertexAttributePosition,
+    VuforiaVertexAttributeTextureCoordinate,
+    VuforiaVertexAttributeNormal,
+    /// xyz tangent and its handedness in w, the bitangent is w * cross(normal, tangent)
+    VuforiaVertexAttributeTangent,
+} VuforiaVertexAttribute;
+
+
+/// Storage format of a vertex attribute, missing components are 0 except the w of a position which is 1
+typedef enum
+{
+    VuforiaVertexFormatFloat2,
+    VuforiaVertexFormatFloat3,
+    VuforiaVertexFormatFloat4,
+    VuforiaVertexFormatHalf2,
+    VuforiaVertexFormatHalf4,
+    /// Position relative to the model bounds, see positionScale and positionOffset in VuforiaModel
+    VuforiaVertexFormatUnorm16x4,
+    /// Texture coordinate clamped to [0, 1]
+    VuforiaVertexFormatUnorm16x2,
+    /// Octahedron-encoded normal
+    VuforiaVertexFormatOctSnorm16x2,
+    /// Tangent with its handedness, as signed normalized shorts
+    VuforiaVertexFormatSnorm16x4,
+} VuforiaVertexFormat;
+
+
+/// Where the normals of a model come from
+typedef enum
+{
+    /// The normals of the OBJ file
+    VuforiaNormalSourceObj,
+    /// Smooth normals generated within the OBJ smoothing groups, faces outside a group are flat
+    VuforiaNormalSourceSmoothingGroups,
+    /// Smooth normals generated across all faces, for OBJ files without smoothing groups
+    VuforiaNormalSourceSmooth,
+} VuforiaNormalSource;
+
+
+typedef struct
+{
+    VuforiaVertexAttribute attribute;
+    VuforiaVertexFormat format;
+} VuforiaVertexElement;
+
+
+/// How the vertices of a model are laid out in memory.
+/// Planar layouts write each attribute to its own array, interleaved layouts
+/// write the elements of a vertex next to each other, in element order, to vertices.
+typedef struct
+{
+    VuforiaVertexElement elements[4];
+    int numElements;
+    bool interleaved;
+    /// Strides are rounded up to a multiple of this power of two, 1 for tightly packed vertices
+    int strideAlignment;
+} VuforiaVertexLayout;
+
+
+/// Range of a model's indices that draws one level of detail
+typedef struct
+{
+    int indexOffset;
+    int indexCount;
+    /// Largest distance from the full detail surface, in model units
+    float error;
+} VuforiaModelLod;
+
+
+/// Axis aligned box and bounding sphere of a model or one of its shapes, in model units.
+/// The sphere is centered on the box.
+typedef struct
+{
+    float min[3];
+    float max[3];
+    float center[3];
+    float radius;
+} VuforiaBounds;
+
+
+/// Levels of detail of a model, finest first, and the bounding sphere selectModelLod projects
+typedef struct
+{
+    /// 0 without a LOD chain, all indices are then drawn
+    int numLods;
+    VuforiaModelLod lods[4];
+    float center[3];
+    float radius;
+} VuforiaModelLods;
+
+
 /// 3D Model representation for Swift
 typedef struct
 {
     bool isLoaded;
     int numVertices;
-    const float* vertices;
-    const float* textureCoordinates;
+    /// Positions, or all attributes for an interleaved layout
+    const void* vertices;
+    /// NULL for an interleaved layout or if the layout has no such attribute
+    const void* textureCoordinates;
+    const void* normals;
+    const void* tangents;
+    /// Number of triangle list indices, 0 for a non-indexed model.
+    /// With levels of detail this covers all of them, draw the range of one level.
+    int numIndices;
+    /// Bytes per index, 2 (uint16_t) or 4 (uint32_t), 0 for a non-indexed model
+    int indexSize;
+    const void* indices;
+    VuforiaModelLods lods;
+    /// Bounds of all vertices, for isModelVisible
+    VuforiaBounds bounds;
+    /// Bounds of each OBJ shape ('g' or 'o') with triangles, in file order, see getModelShapeName
+    int numShapes;
+    const VuforiaBounds* shapeBounds;
+    /// Model space position = positionOffset + positionScale * normalized position,
+    /// a scale of 1 and offset of 0 unless positions are VuforiaVertexFormatUnorm16x4
+    float positionScale[3];
+    float positionOffset[3];
+    /// Opaque owner of the data above, released by releaseModel
+    void* storage;
 } VuforiaModel;
 
 
+/// Exact sizes of a model whose data has not been written yet, see queryModel
+typedef struct
+{
+    bool isValid;
+    int numVertices;
+    int numIndices;
+    /// Bytes per index, 2 (uint16_t) or 4 (uint32_t), 0 for a non-indexed model
+    int indexSize;
+    VuforiaBounds bounds;
+    /// Dequantization of the positions, as in VuforiaModel
+    float positionScale[3];
+    float positionOffset[3];
+    VuforiaModelLods lods;
+    /// Opaque, held until fillModel or releaseModelQuery
+    void* prepared;
+} VuforiaModelQuery;
+
+
+/// Options for building a VuforiaModel from an OBJ file
+typedef struct
+{
+    /// Share vertices between faces and return an index buffer,
+    /// otherwise every triangle corner gets its own vertex
+    bool indexed;
+    /// Binary mesh cache to load instead of parsing the OBJ, or NULL for none.
+    /// A missing, stale or damaged cache is rebuilt from the OBJ and written here.
+    const char* cachePath;
+    /// Layout of the vertex data, normals and tangents are only loaded if the layout has them
+    VuforiaVertexLayout layout;
+    /// Where the normals come from if the layout has normals or tangents
+    VuforiaNormalSource normalSource;
+    /// Reorder the triangles and vertices of an indexed model for the GPU vertex caches
+    bool optimize;
+    /// Also draw the outward facing parts of an indexed model first to reduce overdraw
+    bool optimizeOverdraw;
+    /// Levels of detail to generate for an indexed model including the full one, at most 4.
+    /// 0 or 1 generate none.
+    int numLods;
+} VuforiaModelConfig;
+
+
 int getImageTargetId();
 int getModelTargetId();
 
@@ -63,12 +277,109 @@ bool getOrigin(void* projection, void* modelView);
 bool getImageTargetResult(void* projection, void* modelView, void* scaledModelView);
 bool getModelTargetResult(void* projection, void* modelView, void* scaledModelView);
 bool getModelTargetGuideView(void* mvp, VuImageInfo* guideViewImage, VuBool* guideViewHasChanged);
+/// Render state, device pose and every target observation of the frame in one call,
+/// instead of getVideoBackgroundProjection, getOrigin and a get*TargetResult call each
+VuforiaFrame captureFrame();
+/// Number of image targets loaded from the database, valid after initAR
+int getTargetCount();
+/// Name of the image target at targetIndex, NULL if there is none
+const char* getTargetName(int targetIndex);
+/// Only a few image target observers are active at a time and the others take turns, those of
+/// targets whose name contains currency get more turns. NULL gives every target the same turns.
+void selectCurrency(const char* currency);
+/// The note the tracker recognizes in the latest camera frame. Lock-free, it can be polled
+/// from any thread at any rate without slowing tracking or rendering.
+VuforiaRecognition getRecognition();
+/// Call callback each time the recognized note changes instead of polling, NULL for none.
+/// Call from one thread at a time, never from the callback. Once this returns the previous
+/// callback is not called any more.
+void setRecognitionCallback(VuforiaRecognitionCallback callback, void* userData);
 
 VuPlatformARKitInfo getARKitInfo();
 
+/// Float3 positions and Float2 texture coordinates in separate arrays, as read by texturedVertex
+VuforiaVertexLayout vertexLayoutDefault();
+/// Float3 position, Float2 texture coordinate and optionally Float3 normal per vertex in one array,
+/// as read by texturedInterleavedVertex. Set strideAlignment to 16 to pad every vertex to 16 bytes.
+VuforiaVertexLayout vertexLayoutInterleaved(bool normals);
+/// Unorm16x4 positions, Unorm16x2 texture coordinates and optionally OctSnorm16x2 normals in separate
+/// arrays, as read by texturedQuantizedVertex. The positions map back with the position scale and offset
+/// of the model, which the shader takes at buffer index 3. Normals are read at buffer index 4 when its
+/// hasQuantizedNormals function constant is set.
+VuforiaVertexLayout vertexLayoutQuantized(bool normals);
+/// Bytes between consecutive vertices in the array holding attribute, 0 if the layout does not have it
+int vertexLayoutStride(VuforiaVertexLayout layout, VuforiaVertexAttribute attribute);
+/// Byte offset of attribute within a vertex of its array, -1 if the layout does not have it
+int vertexLayoutOffset(VuforiaVertexLayout layout, VuforiaVertexAttribute attribute);
+
+/// Default model options, indexed output in the default vertex layout without a cache or optimization
+VuforiaModelConfig modelConfigDefault();
+
+/// Load a non-indexed model
 VuforiaModel loadModel(const char* const data, int dataSize);
+VuforiaModel loadModelWithConfig(const char* const data, int dataSize, VuforiaModelConfig config);
+/// Memory-map the OBJ file at path and parse it without copying, the model is non-indexed
+VuforiaModel loadModelFromFile(const char* path);
+VuforiaModel loadModelFromFileWithConfig(const char* path, VuforiaModelConfig config);
+/// Memory-map a mesh cache file, such as one made by tools/obj2meshcache, without the OBJ source.
+/// With the default vertex layout the model uses the mapped data in place.
+VuforiaModel loadModelFromCacheFile(const char* cachePath);
+VuforiaModel loadModelFromCacheFileWithLayout(const char* cachePath, VuforiaVertexLayout layout);
+/// Shared model from the registry of resident models, keyed by the content of the OBJ data and the
+/// options in config. A model already resident, such as one loaded by a screen shown earlier, is
+/// returned without parsing it again. Release it with releaseModel like any other model.
+VuforiaModel acquireModel(const char* const data, int dataSize, VuforiaModelConfig config);
+VuforiaModel acquireModelFromFile(const char* path, VuforiaModelConfig config);
+/// Bytes the registry keeps resident, unused models are evicted least recently used first above
+/// it. Models in use are never evicted. 64 MB by default.
+void setModelMemoryBudget(size_t bytes);
+/// Evict every resident model that is not in use, for example on a memory warning
+void releaseUnusedModels();
+/// Release a loaded or acquired model, every field is then reset as for a model that failed to load
 void releaseModel(VuforiaModel* model);
 
+/// Called once for every background load that is not cancelled, on a loader thread.
+/// model.isLoaded is false if the load failed, otherwise the callee owns the model.
+typedef void (*VuforiaModelLoadCallback)(void* userData, VuforiaModel model);
+
+/// Load a non-indexed model on a background thread, see loadModelAsyncWithConfig
+int loadModelAsync(const char* const data, int dataSize, VuforiaModelLoadCallback callback, void* userData);
+/// Load a model on a background thread. The data and the strings in config are copied, so
+/// they do not need to outlive the call. Loads with a higher priority start first.
+/// Returns an id for cancelModelLoad.
+int loadModelAsyncWithConfig(const char* const data, int dataSize, VuforiaModelConfig config, int priority,
+                             VuforiaModelLoadCallback callback, void* userData);
+/// Same as loadModelAsyncWithConfig, but the file is mapped on the loader thread instead of copied
+int loadModelFromFileAsync(const char* path, VuforiaModelConfig config, int priority, VuforiaModelLoadCallback callback,
+                           void* userData);
+/// Cancel a background load. Returns true if the callback is guaranteed not to be called,
+/// false if the load has completed or is about to call it.
+bool cancelModelLoad(int loadId);
+
+/// Level of detail to draw this frame, the coarsest whose error projects to at most
+/// maxPixelError pixels given the matrices from getImageTargetResult or getModelTargetResult
+int selectModelLod(const VuforiaModelLods* lods, const void* projection, const void* scaledModelView, float viewportHeight,
+                   float maxPixelError);
+
+/// False if bounds, those of a model or of one of its shapes, are entirely outside the view
+/// frustum given the matrices from getImageTargetResult or getModelTargetResult, so drawing
+/// what they bound can be skipped. True whenever it may be visible.
+bool isModelVisible(const VuforiaBounds* bounds, const void* projection, const void* scaledModelView);
+/// Name of the 'g' or 'o' line of a shape of a loaded or acquired model, NULL if there is no such shape
+const char* getModelShapeName(const VuforiaModel* model, int shape);
+
+/// Two-phase loading into memory owned by the caller, such as MTLBuffer.contents().
+/// The query parses the model, or maps its cache, and returns the exact sizes.
+VuforiaModelQuery queryModel(const char* const data, int dataSize, VuforiaModelConfig config);
+VuforiaModelQuery queryModelFromFile(const char* path, VuforiaModelConfig config);
+/// Write the model in the layout of the config, each array needs vertexLayoutStride * numVertices bytes
+/// and indices numIndices * indexSize bytes. Arrays the layout does not use, and the indices of a
+/// non-indexed model, may be NULL. The query is released either way.
+bool fillModel(VuforiaModelQuery* query, void* vertices, void* textureCoordinates, void* normals, void* tangents,
+               void* indices);
+/// Release a query that is not going to be filled
+void releaseModelQuery(VuforiaModelQuery* query);
+
 typedef struct
 {
     const unsigned short NUM_SQUARE_VERTEX;
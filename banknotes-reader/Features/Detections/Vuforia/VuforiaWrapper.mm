@@ -8,10 +8,19 @@ countries.
 #include "VuforiaWrapper.h"
 
 #include "AppController.h"
-#include "MemoryStream.h"
+#include "MemoryMappedFile.h"
+#include "MeshBounds.h"
+#include "ModelRegistry.h"
 #include "Models.h"
-#include "tiny_obj_loader.h"
-
+#include "PreparedModel.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 AppController controller;
@@ -21,12 +30,58 @@ struct
     void* callbackClass = nullptr;
     void (*errorCallbackMethod)(void*, const char*) = nullptr;
     void (*initDoneCallbackMethod)(void*) = nullptr;
+    /// Only changed while no recognition callback is registered with the controller
+    VuforiaRecognitionCallback recognitionCallbackMethod = nullptr;
+    void* recognitionUserData = nullptr;
 
 } gWrapperData;
 
 
-/// Method to load obj model files, uses C++ so outside extern block
-bool loadObjModel(const char* const data, int dataSize, int& numVertices, float** vertices, float** texCoords);
+/// Methods to load obj model files and mesh caches, use C++ so outside extern block
+/// The data is parsed in place and does not need to outlive the call
+bool prepareModel(const char* const data, size_t dataSize, const VuforiaModelConfig& config, PreparedModel& prepared);
+VuforiaModel loadModelFromData(const char* const data, size_t dataSize, const VuforiaModelConfig& config);
+VuforiaModel acquireModelFromData(const char* const data, size_t dataSize, const VuforiaModelConfig& config);
+VuforiaModel makeModel(ModelHandle resident);
+VuforiaModelQuery makeModelQuery(std::unique_ptr<PreparedModel> prepared);
+VuforiaModelLods makeModelLods(const std::vector<MeshLod>& levels, const MeshBounds& bounds);
+ModelLoadOptions toModelLoadOptions(const VuforiaModelConfig& config);
+ModelRegistry& getModelRegistry();
+int submitModelLoad(std::function<VuforiaModel()> load, int priority, VuforiaModelLoadCallback callback, void* userData);
+WorkerPool& getModelLoadPool();
+VertexLayout toVertexLayout(const VuforiaVertexLayout& layout);
+VuforiaRecognition toVuforiaRecognition(const AppController::Recognition& recognition);
+
+static_assert(static_cast<int>(VertexAttribute::Position) == VuforiaVertexAttributePosition &&
+              static_cast<int>(VertexAttribute::TextureCoordinate) == VuforiaVertexAttributeTextureCoordinate &&
+              static_cast<int>(VertexAttribute::Normal) == VuforiaVertexAttributeNormal &&
+              static_cast<int>(VertexAttribute::Tangent) == VuforiaVertexAttributeTangent,
+              "VuforiaVertexAttribute must match VertexAttribute");
+static_assert(sizeof(VuforiaBounds) == sizeof(MeshBounds) && offsetof(VuforiaBounds, min) == offsetof(MeshBounds, min) &&
+              offsetof(VuforiaBounds, max) == offsetof(MeshBounds, max) &&
+              offsetof(VuforiaBounds, center) == offsetof(MeshBounds, center) &&
+              offsetof(VuforiaBounds, radius) == offsetof(MeshBounds, radius),
+              "VuforiaBounds must match MeshBounds");
+static_assert(sizeof(VuforiaFrame::targets) / sizeof(VuforiaFrameTarget) == AppController::MAX_SNAPSHOT_TARGETS,
+              "VuforiaFrame must hold every target of a FrameSnapshot");
+static_assert(static_cast<int>(VertexFormat::Float2) == VuforiaVertexFormatFloat2 &&
+              static_cast<int>(VertexFormat::Float3) == VuforiaVertexFormatFloat3 &&
+              static_cast<int>(VertexFormat::Float4) == VuforiaVertexFormatFloat4 &&
+              static_cast<int>(VertexFormat::Half2) == VuforiaVertexFormatHalf2 &&
+              static_cast<int>(VertexFormat::Half4) == VuforiaVertexFormatHalf4 &&
+              static_cast<int>(VertexFormat::Unorm16x4) == VuforiaVertexFormatUnorm16x4 &&
+              static_cast<int>(VertexFormat::Unorm16x2) == VuforiaVertexFormatUnorm16x2 &&
+              static_cast<int>(VertexFormat::OctSnorm16x2) == VuforiaVertexFormatOctSnorm16x2 &&
+              static_cast<int>(VertexFormat::Snorm16x4) == VuforiaVertexFormatSnorm16x4,
+              "VuforiaVertexFormat must match VertexFormat");
+static_assert(static_cast<int>(MeshNormalSource::Obj) == VuforiaNormalSourceObj &&
+              static_cast<int>(MeshNormalSource::SmoothingGroups) == VuforiaNormalSourceSmoothingGroups &&
+              static_cast<int>(MeshNormalSource::Smooth) == VuforiaNormalSourceSmooth,
+              "VuforiaNormalSource must match MeshNormalSource");
+static_assert(sizeof(VuforiaVertexLayout::elements) / sizeof(VuforiaVertexElement) == VERTEX_ATTRIBUTE_COUNT,
+              "VuforiaVertexLayout must hold an element per attribute");
+static_assert(sizeof(VuforiaModelLods::lods) / sizeof(VuforiaModelLod) == MESH_MAX_LODS,
+              "VuforiaModelLods must hold every level a mesh can have");
 
 
 extern "C"
@@ -254,9 +309,95 @@ getModelTargetGuideView(void* mvp, VuImageInfo* guideViewImage, VuBool* guideVie
 }
 
 
+VuforiaFrame
+captureFrame()
+{
+    VuforiaFrame frame{};
+    if (!controller.isARStarted())
+    {
+        return frame;
+    }
+
+    // A copy of the snapshot prepareToRender took, no observation is queried here
+    const AppController::FrameSnapshot& snapshot = controller.getFrameSnapshot();
+    if (!snapshot.isValid)
+    {
+        return frame;
+    }
+    frame.isValid = true;
+    memcpy(&frame.projection, snapshot.projectionMatrix.data, sizeof(snapshot.projectionMatrix.data));
+    memcpy(&frame.view, snapshot.viewMatrix.data, sizeof(snapshot.viewMatrix.data));
+    memcpy(&frame.videoBackgroundProjection, snapshot.vbProjectionMatrix.data, sizeof(snapshot.vbProjectionMatrix.data));
+    frame.devicePoseStatus = snapshot.devicePoseStatus;
+    frame.devicePoseStatusInfo = snapshot.devicePoseStatusInfo;
+    frame.numTargets = snapshot.numTargets;
+    for (int i = 0; i < snapshot.numTargets; ++i)
+    {
+        const AppController::TargetSnapshot& target = snapshot.targets[i];
+        frame.targets[i].targetType = target.targetType;
+        frame.targets[i].targetIndex = target.targetIndex;
+        frame.targets[i].name = target.name;
+        frame.targets[i].poseStatus = target.poseStatus;
+        memcpy(&frame.targets[i].modelView, target.modelViewMatrix.data, sizeof(target.modelViewMatrix.data));
+        memcpy(&frame.targets[i].scaledModelView, target.scaledModelViewMatrix.data, sizeof(target.scaledModelViewMatrix.data));
+    }
+    return frame;
+}
+
+
+int
+getTargetCount()
+{
+    return controller.getTargetCount();
+}
+
+
+const char*
+getTargetName(int targetIndex)
+{
+    return controller.getTargetName(targetIndex);
+}
+
+
+void
+selectCurrency(const char* currency)
+{
+    controller.selectCurrency(currency);
+}
+
+
+VuforiaRecognition
+getRecognition()
+{
+    return toVuforiaRecognition(controller.getRecognition());
+}
+
+
+void
+setRecognitionCallback(VuforiaRecognitionCallback callback, void* userData)
+{
+    // No call is in progress once the controller has none, so the fields can change
+    controller.setRecognitionCallback(nullptr, nullptr);
+    gWrapperData.recognitionCallbackMethod = callback;
+    gWrapperData.recognitionUserData = userData;
+    if (callback == nullptr)
+    {
+        return;
+    }
+
+    controller.setRecognitionCallback(
+        [](void*, const AppController::Recognition& recognition) {
+            gWrapperData.recognitionCallbackMethod(gWrapperData.recognitionUserData, toVuforiaRecognition(recognition));
+        },
+        nullptr);
+}
+
+
 VuPlatformARKitInfo
 getARKitInfo()
 {
+    // The camera thread makes engine calls too
+    auto lock = controller.lockEngine();
     auto platformController = controller.getPlatformController();
     assert(platformController);
 
@@ -280,33 +421,354 @@ getARKitInfo()
 }
 
 
+VuforiaVertexLayout
+vertexLayoutDefault()
+{
+    VuforiaVertexLayout layout{};
+    layout.elements[0] = { VuforiaVertexAttributePosition, VuforiaVertexFormatFloat3 };
+    layout.elements[1] = { VuforiaVertexAttributeTextureCoordinate, VuforiaVertexFormatFloat2 };
+    layout.numElements = 2;
+    layout.interleaved = false;
+    layout.strideAlignment = 1;
+    return layout;
+}
+
+
+VuforiaVertexLayout
+vertexLayoutInterleaved(bool normals)
+{
+    VuforiaVertexLayout layout = vertexLayoutDefault();
+    layout.interleaved = true;
+    if (normals)
+    {
+        layout.elements[2] = { VuforiaVertexAttributeNormal, VuforiaVertexFormatFloat3 };
+        layout.numElements = 3;
+    }
+    return layout;
+}
+
+
+VuforiaVertexLayout
+vertexLayoutQuantized(bool normals)
+{
+    VuforiaVertexLayout layout = vertexLayoutDefault();
+    layout.elements[0].format = VuforiaVertexFormatUnorm16x4;
+    layout.elements[1].format = VuforiaVertexFormatUnorm16x2;
+    if (normals)
+    {
+        layout.elements[2] = { VuforiaVertexAttributeNormal, VuforiaVertexFormatOctSnorm16x2 };
+        layout.numElements = 3;
+    }
+    return layout;
+}
+
+
+int
+vertexLayoutStride(VuforiaVertexLayout layout, VuforiaVertexAttribute attribute)
+{
+    const VertexLayout vertexLayout = toVertexLayout(layout);
+    std::string err;
+    if (!vertexLayout.isValid(err))
+    {
+        NSLog(@"Invalid vertex layout: %s", err.c_str());
+        return 0;
+    }
+    return static_cast<int>(vertexLayout.getStride(static_cast<VertexAttribute>(attribute)));
+}
+
+
+int
+vertexLayoutOffset(VuforiaVertexLayout layout, VuforiaVertexAttribute attribute)
+{
+    const VertexLayout vertexLayout = toVertexLayout(layout);
+    const VertexAttribute vertexAttribute = static_cast<VertexAttribute>(attribute);
+    std::string err;
+    if (!vertexLayout.isValid(err) || !vertexLayout.contains(vertexAttribute))
+    {
+        return -1;
+    }
+    return static_cast<int>(vertexLayout.getOffset(vertexAttribute));
+}
+
+
+VuforiaModelConfig
+modelConfigDefault()
+{
+    VuforiaModelConfig config;
+    config.indexed = true;
+    config.cachePath = nullptr;
+    config.layout = vertexLayoutDefault();
+    config.normalSource = VuforiaNormalSourceObj;
+    config.optimize = false;
+    config.optimizeOverdraw = false;
+    config.numLods = 0;
+    return config;
+}
+
+
 VuforiaModel
 loadModel(const char* const data, int dataSize)
 {
-    int numVertices = 0;
-    float* rawVertices = nullptr;
-    float* rawTexCoords = nullptr;
+    VuforiaModelConfig config = modelConfigDefault();
+    config.indexed = false;
+    return loadModelWithConfig(data, dataSize, config);
+}
 
-    bool ret = loadObjModel(data, dataSize, numVertices, &rawVertices, &rawTexCoords);
 
-    return VuforiaModel{
-        ret,
-        numVertices,
-        rawVertices,
-        rawTexCoords,
-    };
+VuforiaModel
+loadModelWithConfig(const char* const data, int dataSize, VuforiaModelConfig config)
+{
+    return loadModelFromData(data, dataSize, config);
+}
+
+
+VuforiaModel
+loadModelFromFile(const char* path)
+{
+    VuforiaModelConfig config = modelConfigDefault();
+    config.indexed = false;
+    return loadModelFromFileWithConfig(path, config);
+}
+
+
+VuforiaModel
+loadModelFromFileWithConfig(const char* path, VuforiaModelConfig config)
+{
+    // Parse straight from the mapped pages, the mapping is released on return
+    MemoryMappedFile file(path);
+    if (!file.isOpen())
+    {
+        NSLog(@"Failed to map model file %s", path);
+        return VuforiaModel{};
+    }
+
+    return loadModelFromData(file.data(), file.size(), config);
+}
+
+
+VuforiaModel
+loadModelFromCacheFile(const char* cachePath)
+{
+    return loadModelFromCacheFileWithLayout(cachePath, vertexLayoutDefault());
+}
+
+
+VuforiaModel
+loadModelFromCacheFileWithLayout(const char* cachePath, VuforiaVertexLayout layout)
+{
+    // Whatever the cache holds is used, there is no source to compare against
+    std::unique_ptr<PreparedModel> prepared(new PreparedModel());
+    std::string err;
+    if (!prepared->prepareFromCache(cachePath, toVertexLayout(layout), err))
+    {
+        NSLog(@"Failed to load mesh cache: %s", err.c_str());
+        return VuforiaModel{};
+    }
+
+    return makeModel(ModelHandle(new ResidentModel(std::move(prepared))));
+}
+
+
+VuforiaModel
+acquireModel(const char* const data, int dataSize, VuforiaModelConfig config)
+{
+    return acquireModelFromData(data, dataSize, config);
+}
+
+
+VuforiaModel
+acquireModelFromFile(const char* path, VuforiaModelConfig config)
+{
+    // Hashing the mapped file is far cheaper than parsing it again
+    MemoryMappedFile file(path);
+    if (!file.isOpen())
+    {
+        NSLog(@"Failed to map model file %s", path);
+        return VuforiaModel{};
+    }
+
+    return acquireModelFromData(file.data(), file.size(), config);
+}
+
+
+void
+setModelMemoryBudget(size_t bytes)
+{
+    getModelRegistry().setMemoryBudget(bytes);
+}
+
+
+void
+releaseUnusedModels()
+{
+    getModelRegistry().trim();
 }
 
 
 void
 releaseModel(VuforiaModel* model)
 {
-    model->isLoaded = false;
-    model->numVertices = 0;
-    delete[] model->vertices;
-    model->vertices = nullptr;
-    delete[] model->textureCoordinates;
-    model->textureCoordinates = nullptr;
+    // Frees the data, or for a shared model drops this reference to it
+    delete static_cast<ModelHandle*>(model->storage);
+
+    // Every pointer, the shape bounds included, pointed into the storage. The
+    // model is left as a failed load returns it, so queries on it find nothing.
+    *model = VuforiaModel{};
+}
+
+
+int
+loadModelAsync(const char* const data, int dataSize, VuforiaModelLoadCallback callback, void* userData)
+{
+    VuforiaModelConfig config = modelConfigDefault();
+    config.indexed = false;
+    return loadModelAsyncWithConfig(data, dataSize, config, 0, callback, userData);
+}
+
+
+int
+loadModelAsyncWithConfig(const char* const data, int dataSize, VuforiaModelConfig config, int priority,
+                         VuforiaModelLoadCallback callback, void* userData)
+{
+    // The caller's buffers are only valid during this call
+    auto source = std::make_shared<std::string>(data, dataSize);
+    auto cachePath = std::make_shared<std::string>(config.cachePath != nullptr ? config.cachePath : "");
+    const bool hasCache = config.cachePath != nullptr;
+    return submitModelLoad(
+        [source, cachePath, hasCache, config]() mutable
+        {
+            config.cachePath = hasCache ? cachePath->c_str() : nullptr;
+            return loadModelFromData(source->data(), source->size(), config);
+        },
+        priority, callback, userData);
+}
+
+
+int
+loadModelFromFileAsync(const char* path, VuforiaModelConfig config, int priority, VuforiaModelLoadCallback callback,
+                       void* userData)
+{
+    auto modelPath = std::make_shared<std::string>(path);
+    auto cachePath = std::make_shared<std::string>(config.cachePath != nullptr ? config.cachePath : "");
+    const bool hasCache = config.cachePath != nullptr;
+    return submitModelLoad(
+        [modelPath, cachePath, hasCache, config]() mutable
+        {
+            config.cachePath = hasCache ? cachePath->c_str() : nullptr;
+            return loadModelFromFileWithConfig(modelPath->c_str(), config);
+        },
+        priority, callback, userData);
+}
+
+
+bool
+cancelModelLoad(int loadId)
+{
+    return loadId > 0 && getModelLoadPool().cancel(static_cast<uint64_t>(loadId));
+}
+
+
+int
+selectModelLod(const VuforiaModelLods* lods, const void* projection, const void* scaledModelView, float viewportHeight,
+               float maxPixelError)
+{
+    MeshLod levels[MESH_MAX_LODS];
+    const int numLods = std::min(std::max(lods->numLods, 0), MESH_MAX_LODS);
+    for (int i = 0; i < numLods; ++i)
+    {
+        levels[i].error = lods->lods[i].error;
+    }
+    return selectMeshLod(levels, numLods, lods->center, lods->radius, static_cast<const float*>(scaledModelView),
+                         static_cast<const float*>(projection), viewportHeight, maxPixelError);
+}
+
+
+bool
+isModelVisible(const VuforiaBounds* bounds, const void* projection, const void* scaledModelView)
+{
+    return isMeshBoundsVisible(*reinterpret_cast<const MeshBounds*>(bounds), static_cast<const float*>(scaledModelView),
+                               static_cast<const float*>(projection));
+}
+
+
+const char*
+getModelShapeName(const VuforiaModel* model, int shape)
+{
+    if (model->storage == nullptr || shape < 0 || shape >= model->numShapes)
+    {
+        return nullptr;
+    }
+    const ModelHandle& resident = *static_cast<const ModelHandle*>(model->storage);
+    return resident->getShapeNames()[shape].c_str();
+}
+
+
+VuforiaModelQuery
+queryModel(const char* const data, int dataSize, VuforiaModelConfig config)
+{
+    std::unique_ptr<PreparedModel> prepared(new PreparedModel());
+    if (!prepareModel(data, dataSize, config, *prepared))
+    {
+        return VuforiaModelQuery{};
+    }
+
+    return makeModelQuery(std::move(prepared));
+}
+
+
+VuforiaModelQuery
+queryModelFromFile(const char* path, VuforiaModelConfig config)
+{
+    // The mapping is only needed while the model is prepared, a cache stays mapped in the query
+    MemoryMappedFile file(path);
+    if (!file.isOpen())
+    {
+        NSLog(@"Failed to map model file %s", path);
+        return VuforiaModelQuery{};
+    }
+
+    std::unique_ptr<PreparedModel> prepared(new PreparedModel());
+    if (!prepareModel(file.data(), file.size(), config, *prepared))
+    {
+        return VuforiaModelQuery{};
+    }
+
+    return makeModelQuery(std::move(prepared));
+}
+
+
+bool
+fillModel(VuforiaModelQuery* query, void* vertices, void* textureCoordinates, void* normals, void* tangents, void* indices)
+{
+    PreparedModel* prepared = static_cast<PreparedModel*>(query->prepared);
+    void* const buffers[VERTEX_ATTRIBUTE_COUNT] = { vertices, textureCoordinates, normals, tangents };
+
+    bool canFill = prepared != nullptr && (indices != nullptr || prepared->getIndexCount() == 0);
+    if (canFill)
+    {
+        // Every array the layout writes to has to be there
+        const VertexLayout& layout = prepared->getLayout();
+        for (int i = 0; i < (layout.interleaved ? 1 : layout.numElements); ++i)
+        {
+            canFill = canFill && buffers[layout.interleaved ? 0 : static_cast<int>(layout.elements[i].attribute)] != nullptr;
+        }
+    }
+    if (canFill)
+    {
+        prepared->write(buffers, indices);
+    }
+
+    releaseModelQuery(query);
+    return canFill;
+}
+
+
+void
+releaseModelQuery(VuforiaModelQuery* query)
+{
+    delete static_cast<PreparedModel*>(query->prepared);
+    query->prepared = nullptr;
+    query->isValid = false;
 }
 
 
@@ -338,69 +800,209 @@ Models_t Models = {
 
 
 bool
-loadObjModel(const char* const data, int dataSize, int& numVertices, float** vertices, float** texCoords)
+prepareModel(const char* const data, size_t dataSize, const VuforiaModelConfig& config, PreparedModel& prepared)
 {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-
     std::string warn;
     std::string err;
+    const bool ret = prepared.prepare(data, dataSize, toModelLoadOptions(config), warn, err);
+    if (!warn.empty())
+    {
+        NSLog(@"%s", warn.c_str());
+    }
+    if (!ret)
+    {
+        NSLog(@"Failed to load model: %s", err.c_str());
+    }
+    else if (prepared.getOptimizeStats().acmrBefore > 0.f)
+    {
+        NSLog(@"Optimized model, ACMR %.3f -> %.3f", prepared.getOptimizeStats().acmrBefore, prepared.getOptimizeStats().acmrAfter);
+    }
+    return ret;
+}
+
+
+VuforiaModel
+loadModelFromData(const char* const data, size_t dataSize, const VuforiaModelConfig& config)
+{
+    std::unique_ptr<PreparedModel> prepared(new PreparedModel());
+    if (!prepareModel(data, dataSize, config, *prepared))
+    {
+        return VuforiaModel{};
+    }
+
+    // Not shared, the model is the only owner of its data
+    return makeModel(ModelHandle(new ResidentModel(std::move(prepared))));
+}
 
-    MemoryInputStream aFileDataStream(data, dataSize);
-    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &aFileDataStream);
-    if (ret && err.empty())
+
+VuforiaModel
+acquireModelFromData(const char* const data, size_t dataSize, const VuforiaModelConfig& config)
+{
+    std::string warn;
+    std::string err;
+    ModelHandle resident = getModelRegistry().acquire(data, dataSize, toModelLoadOptions(config), warn, err);
+    if (!warn.empty())
     {
-        numVertices = 0;
-        std::vector<float> vecVertices;
-        std::vector<float> vecTexCoords;
+        NSLog(@"%s", warn.c_str());
+    }
+    if (resident == nullptr)
+    {
+        NSLog(@"Failed to load model: %s", err.c_str());
+        return VuforiaModel{};
+    }
+
+    return makeModel(std::move(resident));
+}
+
+
+VuforiaModel
+makeModel(ModelHandle resident)
+{
+    VuforiaModel model{};
+    model.isLoaded = true;
+    model.numVertices = static_cast<int>(resident->getVertexCount());
+    model.numIndices = static_cast<int>(resident->getIndexCount());
+    model.indexSize = static_cast<int>(resident->getIndexSize());
+    const MeshBounds& bounds = resident->getBounds();
+    memcpy(&model.bounds, &bounds, sizeof(model.bounds));
+    model.numShapes = static_cast<int>(resident->getShapeBounds().size());
+    model.shapeBounds =
+        model.numShapes > 0 ? reinterpret_cast<const VuforiaBounds*>(resident->getShapeBounds().data()) : nullptr;
+    const PositionQuantization& quantization = resident->getPositionQuantization();
+    memcpy(model.positionScale, quantization.scale, sizeof(model.positionScale));
+    memcpy(model.positionOffset, quantization.offset, sizeof(model.positionOffset));
+    model.lods = makeModelLods(resident->getLods(), bounds);
+
+    // The model holds its own reference until releaseModel
+    model.vertices = resident->getVertices(VertexAttribute::Position);
+    model.textureCoordinates = resident->getVertices(VertexAttribute::TextureCoordinate);
+    model.normals = resident->getVertices(VertexAttribute::Normal);
+    model.tangents = resident->getVertices(VertexAttribute::Tangent);
+    model.indices = resident->getIndices();
+    model.storage = new ModelHandle(std::move(resident));
+    return model;
+}
+
+
+VuforiaModelQuery
+makeModelQuery(std::unique_ptr<PreparedModel> prepared)
+{
+    VuforiaModelQuery query{};
+    query.isValid = true;
+    query.numVertices = static_cast<int>(prepared->getVertexCount());
+    query.numIndices = static_cast<int>(prepared->getIndexCount());
+    query.indexSize = static_cast<int>(prepared->getIndexSize());
+    const MeshBounds& bounds = prepared->getBounds();
+    memcpy(&query.bounds, &bounds, sizeof(query.bounds));
+    const PositionQuantization quantization = prepared->getPositionQuantization();
+    memcpy(query.positionScale, quantization.scale, sizeof(query.positionScale));
+    memcpy(query.positionOffset, quantization.offset, sizeof(query.positionOffset));
+    query.lods = makeModelLods(prepared->getLods(), bounds);
+    query.prepared = prepared.release();
+    return query;
+}
+
 
-        // Loop over shapes
-        // s is the index into the shapes vector
-        // f is the index of the current face
-        // v is the index of the current vertex
-        for (size_t s = 0; s < shapes.size(); ++s)
+int
+submitModelLoad(std::function<VuforiaModel()> load, int priority, VuforiaModelLoadCallback callback, void* userData)
+{
+    // Filled in by run and handed to the callback, or released if the load was cancelled meanwhile
+    auto model = std::make_shared<VuforiaModel>();
+    const uint64_t id = getModelLoadPool().submit(
+        priority, [model, load]() { *model = load(); },
+        [model, callback, userData](bool cancelled)
         {
-            // Loop over faces(polygon)
-            size_t index_offset = 0;
-            for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); ++f)
+            if (cancelled)
             {
-                int fv = shapes[s].mesh.num_face_vertices[f];
-                numVertices += fv;
-
-                // Loop over vertices in the face.
-                for (size_t v = 0; v < fv; ++v)
+                if (model->isLoaded)
                 {
-                    // access to vertex
-                    tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-                    vecVertices.push_back(attrib.vertices[3 * idx.vertex_index + 0]);
-                    vecVertices.push_back(attrib.vertices[3 * idx.vertex_index + 1]);
-                    vecVertices.push_back(attrib.vertices[3 * idx.vertex_index + 2]);
-
-                    // The model may not have texture coordinates for every vertex
-                    // If a texture coordinate is missing we just set it to 0,0
-                    // This may not be suitable for rendering some OBJ model files
-                    if (idx.texcoord_index < 0)
-                    {
-                        vecTexCoords.push_back(0.f);
-                        vecTexCoords.push_back(0.f);
-                    }
-                    else
-                    {
-                        vecTexCoords.push_back(attrib.texcoords[2 * idx.texcoord_index + 0]);
-                        vecTexCoords.push_back(attrib.texcoords[2 * idx.texcoord_index + 1]);
-                    }
+                    releaseModel(model.get());
                 }
-                index_offset += fv;
+                return;
             }
-        }
+            callback(userData, *model);
+        });
+    return static_cast<int>(id);
+}
+
 
-        *vertices = new float[vecVertices.size() * 3];
-        memcpy(*vertices, vecVertices.data(), vecVertices.size() * sizeof(float));
-        *texCoords = new float[vecTexCoords.size() * 2];
-        memcpy(*texCoords, vecTexCoords.data(), vecTexCoords.size() * sizeof(float));
+WorkerPool&
+getModelLoadPool()
+{
+    // Two loaders keep a large model from holding up the small ones,
+    // without taking cores from tracking and rendering
+    static WorkerPool pool(2);
+    return pool;
+}
+
+
+VuforiaModelLods
+makeModelLods(const std::vector<MeshLod>& levels, const MeshBounds& bounds)
+{
+    VuforiaModelLods lods{};
+    lods.numLods = static_cast<int>(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        lods.lods[i] = { static_cast<int>(levels[i].indexOffset), static_cast<int>(levels[i].indexCount), levels[i].error };
     }
 
-    return ret;
+    // selectModelLod measures the distance to the near side of the bounding sphere
+    memcpy(lods.center, bounds.center, sizeof(lods.center));
+    lods.radius = bounds.radius;
+    return lods;
+}
+
+
+ModelLoadOptions
+toModelLoadOptions(const VuforiaModelConfig& config)
+{
+    ModelLoadOptions options;
+    options.indexed = config.indexed;
+    options.layout = toVertexLayout(config.layout);
+    options.normalSource = static_cast<MeshNormalSource>(config.normalSource);
+    options.cachePath = config.cachePath;
+    options.optimize.vertexCache = config.optimize;
+    options.optimize.vertexFetch = config.optimize;
+    options.optimize.overdraw = config.optimizeOverdraw;
+    options.lods.numLevels = config.numLods;
+    return options;
+}
+
+
+ModelRegistry&
+getModelRegistry()
+{
+    // Outlives the screens, so returning to one reuses the models it loaded
+    static ModelRegistry registry;
+    return registry;
+}
+
+
+VertexLayout
+toVertexLayout(const VuforiaVertexLayout& layout)
+{
+    // Out of range values are kept so that VertexLayout::isValid reports them
+    VertexLayout vertexLayout;
+    vertexLayout.numElements = layout.numElements;
+    for (int i = 0; i < VERTEX_ATTRIBUTE_COUNT; ++i)
+    {
+        vertexLayout.elements[i].attribute = static_cast<VertexAttribute>(layout.elements[i].attribute);
+        vertexLayout.elements[i].format = static_cast<VertexFormat>(layout.elements[i].format);
+    }
+    vertexLayout.interleaved = layout.interleaved;
+    vertexLayout.strideAlignment = static_cast<uint32_t>(layout.strideAlignment);
+    return vertexLayout;
+}
+
+
+VuforiaRecognition
+toVuforiaRecognition(const AppController::Recognition& recognition)
+{
+    VuforiaRecognition result;
+    result.targetIndex = recognition.targetIndex;
+    result.name = controller.getTargetName(recognition.targetIndex);
+    result.confidence = recognition.confidence;
+    result.timestamp = recognition.timestamp;
+    result.changeCount = recognition.changeCount;
+    return result;
 }
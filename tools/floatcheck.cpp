@@ -0,0 +1,295 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Checks the number parser of tiny_obj_loader against strtod. Random and
+// boundary decimal strings go through tryParseDouble, which must give the
+// same bits as strtod wherever it promises a correctly rounded result: up to
+// 19 digits with a decimal exponent within the power of five table, both
+// edges included. Other strings must still parse to the same token end and a
+// nearby value. A mismatch aborts with the string that caused it.
+//
+// Build on Linux or macOS from the repository root:
+//
+//   CP=banknotes-reader/Features/Detections/Vuforia/Library/CrossPlatform
+//   g++ -std=c++17 -O2 -I$CP -o floatcheck tools/floatcheck.cpp
+//
+// Usage:
+//
+//   floatcheck [--count N] [--seed N] [number ...]
+//
+// --count is the number of random strings of each kind, 1000000 by default.
+// Numbers given on the command line are checked before the generated ones.
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+
+namespace
+{
+
+/// Decimal exponents of the mantissa digits that the Eisel-Lemire table covers
+constexpr int MIN_EXACT_EXPONENT = tinyobj::power_of_five_min;
+constexpr int MAX_EXACT_EXPONENT = tinyobj::power_of_five_max;
+constexpr int MAX_EXACT_DIGITS = 19;
+
+/// Bounds the error of the digit-by-digit parser that handles everything else,
+/// within the magnitudes it reaches without flushing to 0 or overflowing
+constexpr double SLOW_PATH_TOLERANCE = 1e-9;
+constexpr double SLOW_PATH_MIN = 1e-300;
+constexpr double SLOW_PATH_MAX = 1e300;
+
+
+struct Stats
+{
+    uint64_t exact{ 0 };
+    uint64_t approximate{ 0 };
+};
+
+
+[[noreturn]] void
+fail(const std::string& text, const char* what, double expected, double actual)
+{
+    fprintf(stderr, "floatcheck: %s for \"%s\": strtod %.17g, tryParseDouble %.17g\n", what, text.c_str(), expected, actual);
+    abort();
+}
+
+
+uint64_t
+toBits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+/// Whether tryParseDouble promises the strtod result for text, given in the
+/// grammar of tryParseDouble: its digits without leading zeros, and the
+/// decimal exponent of the last digit.
+bool
+isExactInput(const std::string& text)
+{
+    const char* curr = text.c_str();
+    if (*curr == '+' || *curr == '-')
+    {
+        curr++;
+    }
+
+    int numDigits = 0;
+    int64_t exponent = 0;
+    bool fraction = false;
+    for (; *curr != '\0' && *curr != 'e' && *curr != 'E'; curr++)
+    {
+        if (*curr == '.')
+        {
+            fraction = true;
+            continue;
+        }
+        // Leading zeros do not count, as they do not change the mantissa
+        numDigits += (numDigits > 0 || *curr != '0') ? 1 : 0;
+        exponent -= fraction ? 1 : 0;
+    }
+    if (*curr != '\0')
+    {
+        exponent += strtoll(curr + 1, nullptr, 10);
+    }
+    // Mantissas that are 0 have no digits, and so no exponent to check
+    return numDigits == 0 ||
+           (numDigits <= MAX_EXACT_DIGITS && exponent >= MIN_EXACT_EXPONENT && exponent <= MAX_EXACT_EXPONENT);
+}
+
+
+void
+checkNumber(const std::string& text, Stats& stats)
+{
+    const double expected = strtod(text.c_str(), nullptr);
+
+    double actual = 0.0;
+    const char* tokenEnd = nullptr;
+    if (!tinyobj::tryParseDouble(text.c_str(), &tokenEnd, &actual))
+    {
+        fail(text, "rejected", expected, actual);
+    }
+    if (tokenEnd != text.c_str() + text.size())
+    {
+        fail(text, "token end", expected, actual);
+    }
+
+    if (isExactInput(text))
+    {
+        if (toBits(expected) != toBits(actual))
+        {
+            fail(text, "not bit identical", expected, actual);
+        }
+        stats.exact++;
+        return;
+    }
+
+    const bool close = expected == actual || std::fabs(expected - actual) <= SLOW_PATH_TOLERANCE * std::fabs(expected);
+    if (!close && std::fabs(expected) >= SLOW_PATH_MIN && std::fabs(expected) <= SLOW_PATH_MAX)
+    {
+        fail(text, "too far", expected, actual);
+    }
+    stats.approximate++;
+}
+
+
+std::string
+digitString(std::mt19937_64& random, int numDigits)
+{
+    std::string digits;
+    digits.reserve(numDigits);
+    for (int i = 0; i < numDigits; ++i)
+    {
+        digits.push_back(static_cast<char>('0' + random() % 10));
+    }
+    return digits;
+}
+
+
+/// Digits with the decimal point after pointPosition of them, if within
+/// them, and an exponent part if exponent is not 0
+std::string
+decimalString(const std::string& digits, int pointPosition, int exponent, bool negative)
+{
+    std::string text = negative ? "-" : "";
+    if (pointPosition > 0 && pointPosition < static_cast<int>(digits.size()))
+    {
+        text += digits.substr(0, pointPosition);
+        text += '.';
+        text += digits.substr(pointPosition);
+    }
+    else
+    {
+        text += digits;
+    }
+    if (exponent != 0)
+    {
+        text += 'e';
+        text += std::to_string(exponent);
+    }
+    return text;
+}
+
+
+/// Mantissa digit counts and exponents around the edges of Clinger's fast
+/// path (2^53, 10^22), the 19 digits that fit 64 bits and the table
+void
+checkBoundaries(Stats& stats)
+{
+    const char* fixed[] = {
+        "0", "-0", "+0", "0.0", "-0.000e5", "1", "9007199254740992", "9007199254740993", "9007199254740994",
+        "9007199254740995", "18014398509481985", "18446744073709551615", "9999999999999999999",
+        "1e22", "1e23", "9007199254740993e22", "1e-22", "1e-23", "1.7976931348623157e308", "2.2250738585072014e-308",
+        "4.9406564584124654e-324", "123456789012345678e-64", "123456789012345678e64", "1e64", "1e65", "1e-64",
+        "1e-65", "0.1", "0.2", "0.3", "3.0000000000000004", "1.000000000000000111", "1.000000000000000222",
+        "2.4703282292062327e-324", "1e+5", "1E-5", "5.", "-5.e1",
+    };
+    for (const char* text : fixed)
+    {
+        checkNumber(text, stats);
+    }
+
+    // Odd integers above 2^53 are halfway between two doubles, so round to even
+    for (uint64_t w = (1ULL << 53) - 3; w < (1ULL << 53) + 64; ++w)
+    {
+        checkNumber(std::to_string(w), stats);
+    }
+    for (uint64_t w = (1ULL << 54) + 1; w < (1ULL << 54) + 64; w += 2)
+    {
+        checkNumber(std::to_string(w), stats);
+    }
+
+    // Every exponent from one beyond the table on each side, with short and 19 digit mantissas
+    std::mt19937_64 random(1);
+    for (int exponent = MIN_EXACT_EXPONENT - 2; exponent <= MAX_EXACT_EXPONENT + 2; ++exponent)
+    {
+        for (int numDigits : { 1, 2, 7, 15, 16, 17, 18, 19, 20 })
+        {
+            for (int i = 0; i < 20; ++i)
+            {
+                std::string digits = digitString(random, numDigits);
+                digits[0] = static_cast<char>('1' + random() % 9);
+                checkNumber(decimalString(digits, 0, exponent, i % 2 == 1), stats);
+            }
+        }
+    }
+}
+
+
+void
+checkRandom(uint64_t seed, uint64_t count, Stats& stats)
+{
+    std::mt19937_64 random(seed);
+    char buffer[64];
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        // Random digit strings with a point anywhere and exponents past both edges of the table
+        const int numDigits = 1 + static_cast<int>(random() % 22);
+        const int pointPosition = static_cast<int>(random() % (numDigits + 1));
+        const int exponent = static_cast<int>(random() % 171) - 85;
+        checkNumber(decimalString(digitString(random, numDigits), pointPosition, random() % 4 == 0 ? 0 : exponent,
+                                  random() % 2 == 1),
+                    stats);
+
+        // Random doubles as exporters print them, and with all the digits needed to round trip
+        double value;
+        do
+        {
+            const uint64_t bits = random();
+            memcpy(&value, &bits, sizeof(value));
+        } while (!std::isfinite(value));
+        static const char* const formats[] = { "%.17g", "%.17e", "%.6f", "%.9g", "%.15g" };
+        snprintf(buffer, sizeof(buffer), formats[random() % 5], value);
+        checkNumber(buffer, stats);
+
+        // Typical coordinates, the case Clinger's fast path serves
+        snprintf(buffer, sizeof(buffer), "%.6f", (static_cast<double>(random() % 2000001) - 1000000.0) / 1000.0);
+        checkNumber(buffer, stats);
+    }
+}
+
+} // namespace
+
+
+int
+main(int argc, char** argv)
+{
+    uint64_t count = 1000000;
+    uint64_t seed = 5489;
+    Stats stats;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+        {
+            count = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            checkNumber(argv[i], stats);
+        }
+    }
+
+    checkBoundaries(stats);
+    checkRandom(seed, count, stats);
+    printf("floatcheck: %" PRIu64 " strings identical to strtod, %" PRIu64 " outside the exact range within tolerance\n",
+           stats.exact, stats.approximate);
+    return 0;
+}
@@ -0,0 +1,523 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Throughput benchmark for the portable model code in Library/CrossPlatform,
+// so parser and pipeline changes can be measured off-device. Every stage is
+// run on a corpus of synthetic models, plus any OBJ files given, and reports
+// the best time of repeated runs with its source and vertex throughput.
+//
+// Build on Linux or macOS from the repository root:
+//
+//   CP=banknotes-reader/Features/Detections/Vuforia/Library/CrossPlatform
+//   g++ -std=c++17 -O2 -DNDEBUG -I$CP -o modelbench tools/modelbench.cpp
+//       $CP/MeshBounds.cpp $CP/MeshCache.cpp $CP/MeshLod.cpp $CP/MeshLoader.cpp $CP/MeshNormals.cpp $CP/MeshOptimizer.cpp
+//       $CP/PreparedModel.cpp $CP/VertexLayout.cpp $CP/tiny_obj_loader.cpp -lpthread
+//
+// Usage:
+//
+//   modelbench [--time seconds] [--scale N] [--no-synthetic] [model.obj ...]
+//
+// --time is the minimum time spent on each stage, 0.25 seconds by default.
+// --scale multiplies the size of the synthetic models, 1 by default.
+//
+// The materials stage loads a small model naming a large material library,
+// parsing the library on every load with MaterialStreamReader and once with
+// MaterialCacheReader, which every later load copies.
+//
+// AppController is not part of the benchmark, its pose math is the
+// VuforiaEngine matrix library. The pose stage measures selectMeshLod
+// and isMeshBoundsVisible, the per-frame matrix work of the model pipeline.
+
+#include "MemoryMappedFile.h"
+#include "MemoryStream.h"
+#include "MeshBounds.h"
+#include "MeshCache.h"
+#include "MeshLod.h"
+#include "MeshLoader.h"
+#include "MeshNormals.h"
+#include "MeshOptimizer.h"
+#include "PreparedModel.h"
+#include "VertexLayout.h"
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+struct Model
+{
+    std::string name;
+    std::string obj;
+};
+
+
+double gMinSeconds = 0.25;
+
+/// Keeps results alive so the compiler cannot drop the work producing them
+volatile size_t gSink = 0;
+
+
+/// Best wall time of one run in seconds, repeating run for at least gMinSeconds.
+/// setup is run before every run and is not timed.
+double
+measure(const std::function<void()>& setup, const std::function<void()>& run)
+{
+    double best = 1e30;
+    double total = 0.0;
+    for (int iteration = 0; iteration < 3 || total < gMinSeconds; ++iteration)
+    {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, seconds);
+        total += seconds;
+    }
+    return best;
+}
+
+
+double
+measure(const std::function<void()>& run)
+{
+    return measure([] {}, run);
+}
+
+
+/// sourceBytes 0 for stages that do not read the OBJ text, vertices 0 for stages without vertices
+void
+report(const Model& model, const char* stage, double seconds, size_t sourceBytes, size_t vertices)
+{
+    char throughput[32] = "";
+    if (sourceBytes > 0)
+    {
+        snprintf(throughput, sizeof(throughput), "%9.1f MB/s", sourceBytes / seconds / 1e6);
+    }
+    char vertexThroughput[32] = "";
+    if (vertices > 0)
+    {
+        snprintf(vertexThroughput, sizeof(vertexThroughput), "%9.2f Mvertices/s", vertices / seconds / 1e6);
+    }
+    printf("%-14s %-28s %10.3f ms %14s %20s\n", model.name.c_str(), stage, seconds * 1e3, throughput, vertexThroughput);
+}
+
+
+/// UV sphere of quads with texture coordinates and normals, shared between faces
+Model
+makeSphere(int segments)
+{
+    std::string obj;
+    char line[192];
+    for (int ring = 0; ring <= segments; ++ring)
+    {
+        const float theta = 3.14159265f * ring / segments;
+        for (int segment = 0; segment <= segments; ++segment)
+        {
+            const float phi = 2.f * 3.14159265f * segment / segments;
+            const float x = std::sin(theta) * std::cos(phi);
+            const float y = std::cos(theta);
+            const float z = std::sin(theta) * std::sin(phi);
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", x, y, z,
+                     static_cast<float>(segment) / segments, static_cast<float>(ring) / segments, x, y, z);
+            obj += line;
+        }
+    }
+    for (int ring = 0; ring < segments; ++ring)
+    {
+        for (int segment = 0; segment < segments; ++segment)
+        {
+            const int a = ring * (segments + 1) + segment + 1;
+            const int b = a + segments + 1;
+            snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1,
+                     a + 1, a + 1, a + 1);
+            obj += line;
+        }
+    }
+    return Model{ "sphere", obj };
+}
+
+
+/// Unconnected triangles at random, every corner its own vertex
+Model
+makeSoup(int triangles)
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(-1.f, 1.f);
+    std::string obj;
+    char line[192];
+    for (int i = 0; i < triangles * 3; ++i)
+    {
+        snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\n", coordinate(random), coordinate(random),
+                 coordinate(random), coordinate(random) * 0.5f + 0.5f, coordinate(random) * 0.5f + 0.5f);
+        obj += line;
+    }
+    for (int i = 0; i < triangles; ++i)
+    {
+        const int a = 3 * i + 1;
+        snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d\n", a, a, a + 1, a + 1, a + 2, a + 2);
+        obj += line;
+    }
+    return Model{ "soup", obj };
+}
+
+
+/// Flat polygons of many corners each, as CAD exports write caps and panels
+Model
+makePolygons(int polygons, int sides)
+{
+    std::string obj;
+    char line[192];
+    for (int polygon = 0; polygon < polygons; ++polygon)
+    {
+        for (int side = 0; side < sides; ++side)
+        {
+            const float angle = 2.f * 3.14159265f * side / sides;
+            // Alternating radii make the polygons concave
+            const float radius = side % 2 == 0 ? 1.f : 0.6f;
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", radius * std::cos(angle), radius * std::sin(angle),
+                     static_cast<float>(polygon));
+            obj += line;
+        }
+        obj += "f";
+        for (int side = 0; side < sides; ++side)
+        {
+            snprintf(line, sizeof(line), " %d", polygon * sides + side + 1);
+            obj += line;
+        }
+        obj += "\n";
+    }
+    return Model{ "polygons", obj };
+}
+
+
+void
+benchmarkParse(const Model& model)
+{
+    const char* data = model.obj.data();
+    const size_t size = model.obj.size();
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn;
+    std::string err;
+    const auto reset = [&]
+    {
+        attrib = tinyobj::attrib_t();
+        shapes.clear();
+        materials.clear();
+        warn.clear();
+        err.clear();
+    };
+
+    double seconds = measure(reset,
+                             [&]
+                             {
+                                 MemoryInputStream stream(data, size);
+                                 tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream);
+                             });
+    const size_t vertices = attrib.vertices.size() / 3;
+    report(model, "LoadObj (istream)", seconds, size, vertices);
+
+    seconds = measure(reset, [&] { tinyobj::LoadObjFromBuffer(&attrib, &shapes, &materials, &warn, &err, data, size); });
+    report(model, "LoadObjFromBuffer", seconds, size, vertices);
+
+    seconds = measure(reset, [&] { tinyobj::LoadObjFromBufferParallel(&attrib, &shapes, &materials, &warn, &err, data, size); });
+    report(model, "LoadObjFromBufferParallel", seconds, size, vertices);
+}
+
+
+void
+benchmarkConvert(const Model& model)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn;
+    std::string err;
+    tinyobj::LoadObjFromBuffer(&attrib, &shapes, &materials, &warn, &err, model.obj.data(), model.obj.size());
+
+    for (const bool indexed : { false, true })
+    {
+        MeshBuildOptions options;
+        options.indexed = indexed;
+        MeshData mesh;
+        double seconds = measure([&] { mesh = MeshData(); }, [&] { buildMesh(attrib, shapes, options, mesh); });
+        report(model, indexed ? "buildMesh indexed" : "buildMesh", seconds, 0, mesh.getVertexCount());
+
+        seconds = measure([&] { mesh = MeshData(); }, [&] { buildMeshFromObj(model.obj.data(), model.obj.size(), options, mesh, err); });
+        report(model, indexed ? "buildMeshFromObj indexed" : "buildMeshFromObj", seconds, model.obj.size(), mesh.getVertexCount());
+    }
+}
+
+
+void
+benchmarkWrite(const Model& model)
+{
+    const struct
+    {
+        const char* stage;
+        VertexLayout layout;
+    } layouts[] = {
+        { "write planar", VertexLayout::planar() },
+        { "write interleaved", VertexLayout::interleavedPositionTextureNormal(false) },
+        { "write quantized", VertexLayout::planarQuantized(false) },
+    };
+
+    for (const auto& entry : layouts)
+    {
+        ModelLoadOptions options;
+        options.layout = entry.layout;
+        PreparedModel prepared;
+        std::string warn;
+        std::string err;
+        if (!prepared.prepare(model.obj.data(), model.obj.size(), options, warn, err))
+        {
+            fprintf(stderr, "%s: %s\n", model.name.c_str(), err.c_str());
+            return;
+        }
+
+        std::vector<char> buffers[VERTEX_ATTRIBUTE_COUNT];
+        void* bufferPointers[VERTEX_ATTRIBUTE_COUNT] = { nullptr, nullptr, nullptr };
+        for (int i = 0; i < VERTEX_ATTRIBUTE_COUNT; ++i)
+        {
+            buffers[i].resize(entry.layout.getStride(static_cast<VertexAttribute>(i)) * prepared.getVertexCount() + 1);
+            bufferPointers[i] = buffers[i].data();
+        }
+        std::vector<char> indices(prepared.getIndexCount() * prepared.getIndexSize() + 1);
+
+        const double seconds = measure([&] { prepared.write(bufferPointers, indices.data()); });
+        report(model, entry.stage, seconds, 0, prepared.getVertexCount());
+    }
+}
+
+
+void
+benchmarkProcess(const Model& model)
+{
+    MeshBuildOptions options;
+    MeshData source;
+    std::string err;
+    if (!buildMeshFromObj(model.obj.data(), model.obj.size(), options, source, err))
+    {
+        fprintf(stderr, "%s: %s\n", model.name.c_str(), err.c_str());
+        return;
+    }
+
+    MeshData mesh;
+    double seconds = measure([&] { mesh = source; }, [&] { optimizeMesh(mesh, MeshOptimizeOptions{ true, true, true }); });
+    report(model, "optimizeMesh", seconds, 0, source.getVertexCount());
+
+    MeshLodOptions lodOptions;
+    lodOptions.numLevels = MESH_MAX_LODS;
+    seconds = measure([&] { mesh = source; }, [&] { generateLodChain(mesh, lodOptions); });
+    report(model, "generateLodChain", seconds, 0, source.getVertexCount());
+
+    // Generated normals are part of the build, so they are measured with it
+    MeshBuildOptions normalOptions;
+    normalOptions.normals = true;
+    normalOptions.normalSource = MeshNormalSource::SmoothingGroups;
+    seconds = measure([&] { mesh = MeshData(); },
+                      [&] { buildMeshFromObj(model.obj.data(), model.obj.size(), normalOptions, mesh, err); });
+    report(model, "buildMeshFromObj normals", seconds, model.obj.size(), mesh.getVertexCount());
+
+    seconds = measure([&] { mesh.tangents.clear(); }, [&] { generateTangents(mesh); });
+    report(model, "generateTangents", seconds, 0, mesh.getVertexCount());
+
+    MeshBounds bounds{};
+    seconds = measure([&] { bounds = computeMeshBounds(source.positions.data(), source.getVertexCount()); });
+    gSink = gSink + static_cast<size_t>(bounds.radius);
+    report(model, "computeMeshBounds", seconds, 0, source.getVertexCount());
+
+    seconds = measure([&] { gSink = gSink + hashMeshCacheBytes(model.obj.data(), model.obj.size()); });
+    report(model, "hashMeshCacheBytes", seconds, model.obj.size(), 0);
+}
+
+
+void
+benchmarkMaterials(int numMaterials)
+{
+    std::string mtl;
+    char line[192];
+    for (int i = 0; i < numMaterials; ++i)
+    {
+        const float shade = static_cast<float>(i) / numMaterials;
+        snprintf(line, sizeof(line),
+                 "newmtl material%d\nKa 0.1 0.1 0.1\nKd %.6f 0.5 0.5\nKs 0.2 0.2 0.2\nNs 32\nd 1\nillum 2\n"
+                 "map_Kd textures/material%d.png\n",
+                 i, shade, i);
+        mtl += line;
+    }
+    const std::string obj = "mtllib library.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl material0\nf 1 2 3\n";
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn;
+    std::string err;
+    const auto reset = [&]
+    {
+        attrib = tinyobj::attrib_t();
+        shapes.clear();
+        materials.clear();
+        warn.clear();
+        err.clear();
+    };
+
+    std::istringstream stream;
+    tinyobj::MaterialStreamReader streamReader(stream);
+    double seconds = measure(
+        [&]
+        {
+            reset();
+            stream.clear();
+            stream.str(mtl);
+        },
+        [&] { tinyobj::LoadObjFromBuffer(&attrib, &shapes, &materials, &warn, &err, obj.data(), obj.size(), &streamReader); });
+    printf("%-14s %-28s %10.3f ms\n", "materials", "MaterialStreamReader", seconds * 1e3);
+
+    // Parsed by the first load, which is not timed
+    tinyobj::MaterialCacheReader cacheReader;
+    cacheReader.AddLibrary("library.mtl", mtl.data(), mtl.size());
+    cacheReader.GetLibrary("library.mtl");
+    seconds = measure(reset,
+                      [&]
+                      {
+                          tinyobj::LoadObjFromBuffer(&attrib, &shapes, &materials, &warn, &err, obj.data(), obj.size(),
+                                                     &cacheReader);
+                      });
+    printf("%-14s %-28s %10.3f ms\n", "materials", "MaterialCacheReader", seconds * 1e3);
+    gSink = gSink + materials.size();
+}
+
+
+void
+benchmarkPose()
+{
+    // A camera circling a model at varying distances, as selectModelLod sees it every frame
+    const MeshLod lods[MESH_MAX_LODS] = { { 0, 0, 0.f }, { 0, 0, 0.004f }, { 0, 0, 0.01f }, { 0, 0, 0.02f } };
+    const float center[3] = { 0.f, 0.f, 0.f };
+    float projection[16] = {};
+    projection[0] = 1.5f;
+    projection[5] = 2.f;
+    projection[10] = -1.f;
+    projection[11] = -1.f;
+    projection[14] = -0.02f;
+
+    const int calls = 1 << 16;
+    std::vector<float> modelViews(calls * 16);
+    for (int i = 0; i < calls; ++i)
+    {
+        const float angle = 0.001f * i;
+        float* modelView = &modelViews[i * 16];
+        const float matrix[16] = { std::cos(angle), 0.f, -std::sin(angle), 0.f, 0.f, 1.f, 0.f, 0.f,
+                                   std::sin(angle), 0.f, std::cos(angle),  0.f, 0.f, 0.f, -0.5f - (i % 64) * 0.3f, 1.f };
+        memcpy(modelView, matrix, sizeof(matrix));
+    }
+
+    double seconds = measure(
+        [&]
+        {
+            size_t selected = 0;
+            for (int i = 0; i < calls; ++i)
+            {
+                selected += selectMeshLod(lods, MESH_MAX_LODS, center, 1.f, &modelViews[i * 16], projection, 1000.f, 1.f);
+            }
+            gSink = gSink + selected;
+        });
+    printf("%-14s %-28s %10.1f ns/call\n", "pose", "selectMeshLod", seconds / calls * 1e9);
+
+    const MeshBounds bounds{ { -1.f, -1.f, -1.f }, { 1.f, 1.f, 1.f }, { 0.f, 0.f, 0.f }, 1.7320508f };
+    seconds = measure(
+        [&]
+        {
+            size_t visible = 0;
+            for (int i = 0; i < calls; ++i)
+            {
+                visible += isMeshBoundsVisible(bounds, &modelViews[i * 16], projection) ? 1 : 0;
+            }
+            gSink = gSink + visible;
+        });
+    printf("%-14s %-28s %10.1f ns/call\n", "pose", "isMeshBoundsVisible", seconds / calls * 1e9);
+}
+
+} // namespace
+
+
+int
+main(int argc, char** argv)
+{
+    int scale = 1;
+    bool synthetic = true;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+        {
+            gMinSeconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+        {
+            scale = std::max(atoi(argv[++i]), 1);
+        }
+        else if (strcmp(argv[i], "--no-synthetic") == 0)
+        {
+            synthetic = false;
+        }
+        else if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "Usage: %s [--time seconds] [--scale N] [--no-synthetic] [model.obj ...]\n", argv[0]);
+            return 2;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    std::vector<Model> models;
+    if (synthetic)
+    {
+        models.push_back(makeSphere(static_cast<int>(256 * std::sqrt(static_cast<float>(scale)))));
+        models.push_back(makeSoup(50000 * scale));
+        models.push_back(makePolygons(500 * scale, 64));
+    }
+    for (const char* path : paths)
+    {
+        MemoryMappedFile file(path);
+        if (!file.isOpen())
+        {
+            fprintf(stderr, "Failed to open %s\n", path);
+            return 1;
+        }
+        const char* name = strrchr(path, '/');
+        models.push_back(Model{ name != nullptr ? name + 1 : path, std::string(file.data(), file.size()) });
+    }
+
+    for (const Model& model : models)
+    {
+        printf("%s: %.2f MB\n", model.name.c_str(), model.obj.size() / 1e6);
+        benchmarkParse(model);
+        benchmarkConvert(model);
+        benchmarkWrite(model);
+        benchmarkProcess(model);
+    }
+    benchmarkMaterials(2000 * scale);
+    benchmarkPose();
+    return 0;
+}
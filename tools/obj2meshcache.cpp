@@ -0,0 +1,167 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Offline converter from OBJ models to the binary mesh cache format read by
+// loadModelFromCacheFile and loadModelFromFileWithConfig. The output is tagged
+// with the size and hash of the OBJ so the app can detect a stale cache.
+//
+// Build on Linux or macOS from the repository root:
+//
+//   CP=banknotes-reader/Features/Detections/Vuforia/Library/CrossPlatform
+//   g++ -std=c++17 -O2 -I$CP -o obj2meshcache tools/obj2meshcache.cpp
+//       $CP/MeshBounds.cpp $CP/MeshCache.cpp $CP/MeshLod.cpp $CP/MeshLoader.cpp $CP/MeshNormals.cpp $CP/MeshOptimizer.cpp
+//       $CP/tiny_obj_loader.cpp -lpthread
+//
+// Usage:
+//
+//   obj2meshcache [--non-indexed] [--normals] [--group-normals | --smooth-normals] [--tangents]
+//                 [--optimize] [--overdraw] [--lods N] input.obj output.mesh
+//
+// Caches with --normals are needed for vertex layouts that have a normal.
+// --group-normals and --smooth-normals generate them instead of reading the
+// OBJ ones, within smoothing groups or across all faces, and --tangents adds
+// tangents for layouts that have them. The app must ask for the same normals.
+// --optimize reorders triangles and vertices for the GPU caches and
+// --overdraw also sorts triangle clusters, the app must load the cache with
+// the same optimize options or it treats the cache as stale. --lods adds
+// simplified levels up to N in total with the default targets of MeshLodOptions.
+
+#include "MemoryMappedFile.h"
+#include "MeshCache.h"
+#include "MeshLod.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "tiny_obj_loader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+int
+main(int argc, char** argv)
+{
+    MeshBuildOptions options;
+    MeshOptimizeOptions optimizeOptions{ false, false, false };
+    MeshLodOptions lodOptions;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--non-indexed") == 0)
+        {
+            options.indexed = false;
+        }
+        else if (strcmp(argv[i], "--normals") == 0)
+        {
+            options.normals = true;
+        }
+        else if (strcmp(argv[i], "--group-normals") == 0)
+        {
+            options.normals = true;
+            options.normalSource = MeshNormalSource::SmoothingGroups;
+        }
+        else if (strcmp(argv[i], "--smooth-normals") == 0)
+        {
+            options.normals = true;
+            options.normalSource = MeshNormalSource::Smooth;
+        }
+        else if (strcmp(argv[i], "--tangents") == 0)
+        {
+            options.normals = true;
+            options.tangents = true;
+        }
+        else if (strcmp(argv[i], "--optimize") == 0)
+        {
+            optimizeOptions.vertexCache = true;
+            optimizeOptions.vertexFetch = true;
+        }
+        else if (strcmp(argv[i], "--overdraw") == 0)
+        {
+            optimizeOptions.overdraw = true;
+        }
+        else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+        {
+            lodOptions.numLevels = atoi(argv[++i]);
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.size() != 2)
+    {
+        fprintf(stderr,
+                "Usage: %s [--non-indexed] [--normals] [--group-normals | --smooth-normals] [--tangents] [--optimize] "
+                "[--overdraw] [--lods N] input.obj output.mesh\n",
+                argv[0]);
+        return 2;
+    }
+
+    MemoryMappedFile source(paths[0]);
+    if (!source.isOpen())
+    {
+        fprintf(stderr, "Failed to open %s\n", paths[0]);
+        return 1;
+    }
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn;
+    std::string err;
+    if (!tinyobj::LoadObjFromBufferParallel(&attrib, &shapes, &materials, &warn, &err, source.data(), source.size()) ||
+        !err.empty())
+    {
+        fprintf(stderr, "Failed to parse %s: %s\n", paths[0], err.c_str());
+        return 1;
+    }
+    if (!warn.empty())
+    {
+        fprintf(stderr, "%s", warn.c_str());
+    }
+
+    MeshData mesh;
+    if (!buildMesh(attrib, shapes, options, mesh))
+    {
+        fprintf(stderr, "%s has faces referencing missing vertices\n", paths[0]);
+        return 1;
+    }
+
+    uint32_t lodOptionsHash = 0;
+    if (mesh.isIndexed() && lodOptions.numLevels > 1)
+    {
+        generateLodChain(mesh, lodOptions);
+        lodOptionsHash = getMeshCacheLodHash(lodOptions);
+        for (const MeshLod& lod : mesh.lods)
+        {
+            printf("LOD %u triangles, error %g\n", lod.indexCount / 3, lod.error);
+        }
+    }
+
+    uint32_t processFlags = options.normals ? getMeshCacheNormalFlags(options.normalSource) : 0;
+    if (optimizeOptions.any() && mesh.isIndexed())
+    {
+        MeshOptimizeStats stats;
+        optimizeMesh(mesh, optimizeOptions, &stats);
+        processFlags |= getMeshCacheOptimizeFlags(optimizeOptions);
+        printf("ACMR %.3f -> %.3f\n", stats.acmrBefore, stats.acmrAfter);
+    }
+
+    std::string error;
+    if (!writeMeshCache(paths[1], mesh, source.size(), hashMeshCacheBytes(source.data(), source.size()), processFlags, lodOptionsHash, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    printf("%s: %zu vertices, %zu indices, %zu shapes, bounding radius %g\n", paths[1], mesh.getVertexCount(),
+           mesh.indices.size(), mesh.shapeBounds.size(), mesh.bounds.radius);
+    return 0;
+}
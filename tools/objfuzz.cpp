@@ -0,0 +1,414 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// libFuzzer target for the OBJ parsers in Library/CrossPlatform. Every input
+// is parsed by LoadObj and each of the buffer parsers, which must agree with
+// it bit for bit. The mesh built from it must be the same whichever path
+// builds it, generated normals, tangents and bounds included. Small meshes
+// then go through optimizeMesh and generateLodChain, which must keep every
+// index in range. The input is also loaded as a material library next to two
+// fixed ones, through MaterialStreamReader and MaterialCacheReader, which must
+// resolve the same materials. A change that breaks any of this aborts with
+// the name of the check that failed.
+//
+// Build with clang from the repository root:
+//
+//   CP=banknotes-reader/Features/Detections/Vuforia/Library/CrossPlatform
+//   clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined -I$CP -o objfuzz tools/objfuzz.cpp
+//       $CP/MeshBounds.cpp $CP/MeshLod.cpp $CP/MeshLoader.cpp $CP/MeshNormals.cpp $CP/MeshOptimizer.cpp
+//       $CP/tiny_obj_loader.cpp -lpthread
+//
+//   mkdir -p corpus
+//   ./objfuzz -dict=tools/obj.dict corpus/ tools/objfuzz_corpus/
+//
+// tools/objfuzz_corpus holds the seeds, among them inputs that once broke a
+// check. Add the input of every fixed crash there.
+//
+// Without libFuzzer, such as with g++, add -DOBJFUZZ_STANDALONE and drop
+// fuzzer from -fsanitize to replay the files given on the command line:
+//
+//   ./objfuzz tools/objfuzz_corpus/*
+
+#include "MemoryStream.h"
+#include "MeshLod.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "tiny_obj_loader.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef OBJFUZZ_STANDALONE
+#include <fstream>
+#endif
+
+
+namespace
+{
+
+/// Larger meshes only go through the parsers, so the fuzzer keeps its pace
+constexpr size_t MAX_PROCESSED_VERTICES = 4096;
+
+/// Libraries next to the input, fuzz.mtl. Both define shared, whose first
+/// definition must win, and a.mtl warns about its dissolve.
+const char MATERIAL_LIBRARY_A[] = "newmtl shared\nKd 1 0 0\nnewmtl a_only\nKd 0 1 0\nd 0.5\nTr 0.25\n";
+const char MATERIAL_LIBRARY_B[] = "newmtl b_only\nKd 0 0 1\nnewmtl shared\nKd 1 1 1\nillum 2\n";
+
+/// Put before the input, so its own usemtl and mtllib lines follow these
+const char MATERIAL_OBJ_PREFIX[] = "mtllib a.mtl\n"
+                                   "mtllib missing.mtl b.mtl\n"
+                                   "mtllib fuzz.mtl\n"
+                                   "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                                   "usemtl shared\nf 1 2 3\n"
+                                   "usemtl b_only\nf 1 2 3\n"
+                                   "usemtl a_only\nf 1 2 3\n";
+
+
+void
+check(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        fprintf(stderr, "objfuzz: %s\n", what);
+        abort();
+    }
+}
+
+
+/// Bitwise, so that NaN values parsed from the input compare equal
+template <typename T>
+bool
+sameValues(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+
+bool
+sameIndices(const std::vector<tinyobj::index_t>& a, const std::vector<tinyobj::index_t>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].vertex_index != b[i].vertex_index || a[i].normal_index != b[i].normal_index ||
+            a[i].texcoord_index != b[i].texcoord_index)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+struct ParseResult
+{
+    bool ok{ false };
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn;
+    std::string err;
+};
+
+
+void
+checkSameParse(const ParseResult& expected, const ParseResult& actual, const char* what)
+{
+    check(expected.ok == actual.ok, what);
+    check(sameValues(expected.attrib.vertices, actual.attrib.vertices), what);
+    check(sameValues(expected.attrib.normals, actual.attrib.normals), what);
+    check(sameValues(expected.attrib.texcoords, actual.attrib.texcoords), what);
+    check(sameValues(expected.attrib.colors, actual.attrib.colors), what);
+    check(expected.shapes.size() == actual.shapes.size(), what);
+    for (size_t i = 0; i < expected.shapes.size(); ++i)
+    {
+        const tinyobj::shape_t& a = expected.shapes[i];
+        const tinyobj::shape_t& b = actual.shapes[i];
+        check(a.name == b.name, what);
+        check(sameIndices(a.mesh.indices, b.mesh.indices), what);
+        check(sameValues(a.mesh.num_face_vertices, b.mesh.num_face_vertices), what);
+        check(sameValues(a.mesh.material_ids, b.mesh.material_ids), what);
+        check(sameValues(a.mesh.smoothing_group_ids, b.mesh.smoothing_group_ids), what);
+        check(sameValues(a.path.indices, b.path.indices), what);
+    }
+}
+
+
+/// Bitwise for the numbers, as sameValues
+bool
+sameMaterial(const tinyobj::material_t& a, const tinyobj::material_t& b)
+{
+    const auto sameReals = [](const tinyobj::real_t* x, const tinyobj::real_t* y, size_t count)
+    { return memcmp(x, y, count * sizeof(tinyobj::real_t)) == 0; };
+    return a.name == b.name && sameReals(a.ambient, b.ambient, 3) && sameReals(a.diffuse, b.diffuse, 3) &&
+           sameReals(a.specular, b.specular, 3) && sameReals(a.transmittance, b.transmittance, 3) &&
+           sameReals(a.emission, b.emission, 3) && sameReals(&a.shininess, &b.shininess, 1) && sameReals(&a.ior, &b.ior, 1) &&
+           sameReals(&a.dissolve, &b.dissolve, 1) && a.illum == b.illum && a.diffuse_texname == b.diffuse_texname &&
+           a.bump_texname == b.bump_texname && a.normal_texname == b.normal_texname && a.unknown_parameter == b.unknown_parameter;
+}
+
+
+/// MaterialStreamReader on a stream of the named library, the reference for MaterialCacheReader
+class LibraryStreamReader : public tinyobj::MaterialReader
+{
+public:
+    void
+    addLibrary(const std::string& name, const char* buf, size_t bufLen)
+    {
+        mLibraries[name].assign(buf, bufLen);
+    }
+
+    bool
+    operator()(const std::string& matId, std::vector<tinyobj::material_t>* materials, std::map<std::string, int>* matMap,
+               std::string* warn, std::string* err) override
+    {
+        const auto found = mLibraries.find(matId);
+        if (found == mLibraries.end())
+        {
+            // The message of MaterialCacheReader, the missing library is not what is compared
+            *warn += "Material library [ " + matId + " ] not found.\n";
+            return false;
+        }
+        std::istringstream stream(found->second);
+        tinyobj::MaterialStreamReader reader(stream);
+        return reader(matId, materials, matMap, warn, err);
+    }
+
+private:
+    std::map<std::string, std::string> mLibraries;
+};
+
+
+void
+checkSameMaterials(const ParseResult& expected, const ParseResult& actual, const char* what)
+{
+    checkSameParse(expected, actual, what);
+    check(expected.warn == actual.warn && expected.err == actual.err, what);
+    check(expected.materials.size() == actual.materials.size(), what);
+    for (size_t i = 0; i < expected.materials.size(); ++i)
+    {
+        check(sameMaterial(expected.materials[i], actual.materials[i]), what);
+    }
+}
+
+
+void
+fuzzMaterials(const char* data, size_t size)
+{
+    std::string obj = MATERIAL_OBJ_PREFIX;
+    obj.append(data, size);
+
+    LibraryStreamReader streamReader;
+    streamReader.addLibrary("a.mtl", MATERIAL_LIBRARY_A, sizeof(MATERIAL_LIBRARY_A) - 1);
+    streamReader.addLibrary("b.mtl", MATERIAL_LIBRARY_B, sizeof(MATERIAL_LIBRARY_B) - 1);
+    streamReader.addLibrary("fuzz.mtl", data, size);
+    ParseResult expected;
+    expected.ok = tinyobj::LoadObjFromBuffer(&expected.attrib, &expected.shapes, &expected.materials, &expected.warn,
+                                             &expected.err, obj.data(), obj.size(), &streamReader);
+    if (expected.ok && !expected.shapes.empty() && !expected.shapes[0].mesh.material_ids.empty())
+    {
+        // The first face uses shared, red in a.mtl and white in b.mtl
+        const int shared = expected.shapes[0].mesh.material_ids[0];
+        check(shared >= 0 && static_cast<size_t>(shared) < expected.materials.size() &&
+                  expected.materials[shared].diffuse[1] == 0.f,
+              "a later library replaced an earlier material");
+    }
+
+    tinyobj::MaterialCacheReader cacheReader;
+    cacheReader.AddLibrary("a.mtl", MATERIAL_LIBRARY_A, sizeof(MATERIAL_LIBRARY_A) - 1);
+    cacheReader.AddLibrary("b.mtl", MATERIAL_LIBRARY_B, sizeof(MATERIAL_LIBRARY_B) - 1);
+    cacheReader.AddLibrary("fuzz.mtl", data, size);
+
+    // Concurrent first uses must share a single parse
+    std::shared_ptr<const tinyobj::material_library_t> first;
+    std::thread other([&] { first = cacheReader.GetLibrary("fuzz.mtl"); });
+    const std::shared_ptr<const tinyobj::material_library_t> second = cacheReader.GetLibrary("fuzz.mtl");
+    other.join();
+    check(first && first == second, "MaterialCacheReader parsed a library twice");
+    check(!cacheReader.GetLibrary("missing.mtl"), "MaterialCacheReader found a library never added");
+
+    // The first load parses a.mtl and b.mtl, the second copies every library parsed before
+    for (int load = 0; load < 2; ++load)
+    {
+        ParseResult cached;
+        cached.ok = tinyobj::LoadObjFromBuffer(&cached.attrib, &cached.shapes, &cached.materials, &cached.warn, &cached.err,
+                                               obj.data(), obj.size(), &cacheReader);
+        checkSameMaterials(expected, cached, "MaterialCacheReader differs from MaterialStreamReader");
+    }
+}
+
+
+void
+checkMesh(const MeshData& mesh)
+{
+    const size_t numVertices = mesh.getVertexCount();
+    check(mesh.textureCoordinates.size() == numVertices * 2, "texture coordinates do not match the positions");
+    check(!mesh.hasNormals() || mesh.normals.size() == numVertices * 3, "normals do not match the positions");
+    check(!mesh.hasTangents() || mesh.tangents.size() == numVertices * 4, "tangents do not match the positions");
+    for (size_t i = 3; i < mesh.tangents.size(); i += 4)
+    {
+        check(mesh.tangents[i] == 1.f || mesh.tangents[i] == -1.f, "tangent handedness is not 1 or -1");
+    }
+    check(mesh.indices.size() % 3 == 0, "indices are not a triangle list");
+    for (uint32_t index : mesh.indices)
+    {
+        check(index < numVertices, "index out of range");
+    }
+    uint32_t end = 0;
+    for (const MeshLod& lod : mesh.lods)
+    {
+        check(lod.indexOffset == end && lod.indexCount % 3 == 0, "levels of detail are not back to back");
+        end += lod.indexCount;
+    }
+    check(mesh.lods.empty() || end == mesh.indices.size(), "levels of detail do not cover the indices");
+    check(mesh.shapeBounds.size() == mesh.shapeNames.size(), "shape bounds and names do not match");
+    check(mesh.shapeBounds.empty() == (numVertices == 0), "shapes do not cover the vertices");
+
+    // NaN and infinite positions make the bounds meaningless, with finite ones they hold every position
+    bool finite = std::isfinite(mesh.bounds.radius);
+    for (float value : mesh.positions)
+    {
+        finite = finite && std::isfinite(value);
+    }
+    for (size_t i = 0; finite && i < numVertices; ++i)
+    {
+        const float* position = &mesh.positions[3 * i];
+        float distanceSquared = 0.f;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            check(position[axis] >= mesh.bounds.min[axis] && position[axis] <= mesh.bounds.max[axis], "position outside the bounds");
+            const float offset = position[axis] - mesh.bounds.center[axis];
+            distanceSquared += offset * offset;
+        }
+        check(std::sqrt(distanceSquared) <= mesh.bounds.radius * 1.0001f + 1e-30f, "position outside the bounding sphere");
+    }
+}
+
+
+void
+fuzzMesh(const char* data, size_t size, const ParseResult& parsed, bool indexed, MeshNormalSource normalSource)
+{
+    MeshBuildOptions options;
+    options.indexed = indexed;
+    options.normals = true;
+    options.normalSource = normalSource;
+    options.tangents = normalSource != MeshNormalSource::Obj;
+
+    MeshData built;
+    const bool builtOk = parsed.ok && buildMesh(parsed.attrib, parsed.shapes, options, built);
+
+    MeshData streamed;
+    std::string err;
+    const bool streamedOk = buildMeshFromObj(data, size, options, streamed, err);
+
+    // buildMeshFromObj rejects faces referencing vertices defined after them, buildMesh does not
+    if (streamedOk)
+    {
+        check(builtOk, "buildMeshFromObj accepted what buildMesh rejected");
+        check(sameValues(built.positions, streamed.positions), "buildMeshFromObj positions");
+        check(sameValues(built.textureCoordinates, streamed.textureCoordinates), "buildMeshFromObj texture coordinates");
+        check(sameValues(built.normals, streamed.normals), "buildMeshFromObj normals");
+        check(sameValues(built.tangents, streamed.tangents), "buildMeshFromObj tangents");
+        check(sameValues(built.indices, streamed.indices), "buildMeshFromObj indices");
+        check(memcmp(&built.bounds, &streamed.bounds, sizeof(MeshBounds)) == 0, "buildMeshFromObj bounds");
+        check(sameValues(built.shapeBounds, streamed.shapeBounds), "buildMeshFromObj shape bounds");
+        check(built.shapeNames.size() == streamed.shapeNames.size(), "buildMeshFromObj shape names");
+        for (size_t i = 0; i < built.shapeNames.size(); ++i)
+        {
+            // The parser hands the streaming path C strings, which end at a NUL in the name
+            check(strcmp(built.shapeNames[i].c_str(), streamed.shapeNames[i].c_str()) == 0, "buildMeshFromObj shape names");
+        }
+    }
+    if (!builtOk)
+    {
+        return;
+    }
+    checkMesh(built);
+
+    if (!indexed || built.getVertexCount() > MAX_PROCESSED_VERTICES)
+    {
+        return;
+    }
+
+    const size_t numIndices = built.indices.size();
+    MeshLodOptions lodOptions;
+    lodOptions.numLevels = MESH_MAX_LODS;
+    generateLodChain(built, lodOptions);
+    check(built.lods.empty() || built.lods[0].indexCount == numIndices, "generateLodChain changed the full level");
+    checkMesh(built);
+
+    const size_t numVertices = built.getVertexCount();
+    const size_t numChainIndices = built.indices.size();
+    optimizeMesh(built, MeshOptimizeOptions{ true, true, true });
+    check(built.getVertexCount() == numVertices && built.indices.size() == numChainIndices, "optimizeMesh changed the sizes");
+    checkMesh(built);
+}
+
+} // namespace
+
+
+extern "C" int
+LLVMFuzzerTestOneInput(const uint8_t* bytes, size_t size)
+{
+    const char* data = reinterpret_cast<const char*>(bytes);
+
+    ParseResult expected;
+    {
+        MemoryInputStream stream(data, size);
+        expected.ok = tinyobj::LoadObj(&expected.attrib, &expected.shapes, &expected.materials, &expected.warn,
+                                       &expected.err, &stream);
+    }
+
+    ParseResult buffer;
+    buffer.ok = tinyobj::LoadObjFromBuffer(&buffer.attrib, &buffer.shapes, &buffer.materials, &buffer.warn, &buffer.err,
+                                           data, size);
+    checkSameParse(expected, buffer, "LoadObjFromBuffer differs from LoadObj");
+
+    // Fuzz inputs are far below the default minimum chunk, which would parse them on one thread
+    ParseResult parallel;
+    parallel.ok = tinyobj::LoadObjFromBufferParallel(&parallel.attrib, &parallel.shapes, &parallel.materials,
+                                                     &parallel.warn, &parallel.err, data, size, nullptr, true, true, 4, 1);
+    checkSameParse(expected, parallel, "LoadObjFromBufferParallel differs from LoadObj");
+
+    fuzzMesh(data, size, buffer, false, MeshNormalSource::Obj);
+    fuzzMesh(data, size, buffer, true, MeshNormalSource::Obj);
+    fuzzMesh(data, size, buffer, false, MeshNormalSource::SmoothingGroups);
+    fuzzMesh(data, size, buffer, true, MeshNormalSource::SmoothingGroups);
+
+    fuzzMaterials(data, size);
+    return 0;
+}
+
+
+#ifdef OBJFUZZ_STANDALONE
+int
+main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        const std::string input = contents.str();
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    }
+    return 0;
+}
+#endif
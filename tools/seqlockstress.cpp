@@ -0,0 +1,170 @@
+/*===============================================================================
+Copyright (c) 2024 PTC Inc. and/or Its Subsidiary Companies. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Stress test for SeqLock in Library/CrossPlatform, as AppController uses it
+// to publish the recognized note. One writer stores records whose fields are
+// all derived from a running count, while two readers load them as fast as
+// they can. Every record a reader loads must be whole, all its fields from
+// the same store, and no older than the last it loaded. A torn or
+// out-of-order record aborts with the fields that were read.
+//
+// Build on Linux or macOS from the repository root, with ThreadSanitizer so
+// that a data race in the copies is reported too:
+//
+//   CP=banknotes-reader/Features/Detections/Vuforia/Library/CrossPlatform
+//   g++ -std=c++17 -O1 -g -fsanitize=thread -I$CP -o seqlockstress tools/seqlockstress.cpp -lpthread
+//
+// Usage:
+//
+//   seqlockstress [--stores N]
+//
+// --stores is the number of records the writer stores, 2000000 by default.
+//
+// g++ warns that ThreadSanitizer does not model the fences in SeqLock. It
+// still reports any copy that is not atomic, and a load that does not retry
+// over a concurrent store shows as a torn record, on one core too.
+
+#include "SeqLock.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+
+namespace
+{
+
+constexpr int NUM_READERS = 2;
+
+/// The layout of AppController::Recognition, which needs the Vuforia headers
+struct Record
+{
+    int targetIndex{ -1 };
+    float confidence{ 0.f };
+    int64_t timestamp{ 0 };
+    uint32_t changeCount{ 0 };
+};
+
+
+Record
+makeRecord(int64_t count)
+{
+    Record record;
+    record.targetIndex = static_cast<int>(count % 1000003);
+    record.confidence = static_cast<float>(count % 4096);
+    record.timestamp = count;
+    record.changeCount = static_cast<uint32_t>(count);
+    return record;
+}
+
+
+/// The count of the store the record came from, or -1 if its fields come from different stores
+int64_t
+getCount(const Record& record)
+{
+    const Record expected = makeRecord(record.timestamp);
+    return record.timestamp >= 0 && record.targetIndex == expected.targetIndex && record.confidence == expected.confidence &&
+                   record.changeCount == expected.changeCount
+               ? record.timestamp
+               : -1;
+}
+
+
+void
+fail(const char* what, const Record& record)
+{
+    fprintf(stderr, "seqlockstress: %s: targetIndex %d confidence %g timestamp %" PRId64 " changeCount %" PRIu32 "\n", what,
+            record.targetIndex, record.confidence, record.timestamp, record.changeCount);
+    abort();
+}
+
+} // namespace
+
+
+int
+main(int argc, char** argv)
+{
+    int64_t numStores = 2000000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--stores") == 0 && i + 1 < argc)
+        {
+            numStores = atoll(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--stores N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    SeqLock<Record> published(makeRecord(0));
+    std::atomic<bool> writing{ true };
+    std::atomic<int> numReadersStarted{ 0 };
+    uint64_t numLoads[NUM_READERS] = {};
+    uint64_t numChanges[NUM_READERS] = {};
+
+    std::thread readers[NUM_READERS];
+    for (int reader = 0; reader < NUM_READERS; ++reader)
+    {
+        readers[reader] = std::thread(
+            [&, reader]
+            {
+                numReadersStarted.fetch_add(1);
+                int64_t last = 0;
+                // The last load starts after the writer is done, so it must see the last store
+                bool done = false;
+                while (!done)
+                {
+                    done = !writing.load(std::memory_order_acquire);
+                    const Record record = published.load();
+                    const int64_t count = getCount(record);
+                    if (count < 0)
+                    {
+                        fail("torn record", record);
+                    }
+                    if (count < last)
+                    {
+                        fail("older record than the last one loaded", record);
+                    }
+                    numChanges[reader] += count != last ? 1 : 0;
+                    ++numLoads[reader];
+                    last = count;
+                }
+                if (last != numStores)
+                {
+                    fail("last store not seen", makeRecord(last));
+                }
+            });
+    }
+
+    // Stores racing with the readers from the first one
+    while (numReadersStarted.load() < NUM_READERS)
+    {
+        std::this_thread::yield();
+    }
+    for (int64_t count = 1; count <= numStores; ++count)
+    {
+        published.store(makeRecord(count));
+    }
+    writing.store(false, std::memory_order_release);
+
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+    for (int reader = 0; reader < NUM_READERS; ++reader)
+    {
+        printf("reader %d: %" PRIu64 " loads, %" PRIu64 " distinct records\n", reader, numLoads[reader], numChanges[reader]);
+    }
+    printf("%" PRId64 " stores, no torn or out-of-order records\n", numStores);
+    return 0;
+}